@@ -54,6 +54,69 @@ typedef struct CRYPT_STREAM *MCRYPT;
 	int mdecrypt_generic(MCRYPT td, void *plaintext, int len);
 	int mcrypt_generic(MCRYPT td, void *plaintext, int len);
 
+/* Like mcrypt_generic() and mdecrypt_generic(), but read len bytes from
+ * in and write the result to out. in and out may be the same buffer
+ * but must not otherwise overlap.
+ */
+	int mcrypt_generic_out(MCRYPT td, const void *in, void *out, int len);
+	int mdecrypt_generic_out(MCRYPT td, const void *in, void *out,
+				 int len);
+
+/* Like mcrypt_generic() and mdecrypt_generic(), but process the iovcnt
+ * buffers in iov in place, as if they were one contiguous buffer. Not
+ * for the sector modes.
+ */
+	struct iovec;
+	int mcrypt_generic_iov(MCRYPT td, const struct iovec *iov,
+			       int iovcnt);
+	int mdecrypt_generic_iov(MCRYPT td, const struct iovec *iov,
+				 int iovcnt);
+
+/* Authenticated modes (gcm). The additional data is given before the
+ * message; the tag ends the message. Both return a negative value on
+ * error, or for a mode without authentication; verification returns
+ * a negative value when the tag does not match.
+ */
+	int mcrypt_generic_aad(MCRYPT td, const void *aad, int len);
+	int mcrypt_generic_get_tag(MCRYPT td, void *tag, int len);
+	int mdecrypt_generic_verify_tag(MCRYPT td, const void *tag, int len);
+
+/* MAC modes (cmac, cbcmac): authenticate a message given in any
+ * number of updates. The final call returns the first len bytes of the
+ * tag and starts the next message; mdecrypt_generic_verify_tag() also
+ * ends the message. mcrypt_generic() on these modes is an update that
+ * leaves the data as it is.
+ */
+	int mcrypt_generic_mac_update(MCRYPT td, const void *data, int len);
+	int mcrypt_generic_mac_final(MCRYPT td, void *tag, int len);
+
+/* Output feedback and counter modes (ofb, nofb, ctr): compute at least
+ * len bytes of keystream ahead of time, and from then on refill the
+ * descriptor's keystream reservoir whenever a call finds it empty.
+ * A len of 0 stops the refilling. Returns the number of bytes ready,
+ * or a negative value for the other modes.
+ */
+	int mcrypt_generic_prefetch(MCRYPT td, int len);
+
+/* Sector modes (xts): process nsectors consecutive sectors of
+ * sector_size bytes in place, the first of which is number sector.
+ * mcrypt_generic() processes one sector per call on these modes.
+ */
+	int mcrypt_generic_sectors(MCRYPT td, unsigned long long sector,
+				   void *data, int sector_size, int nsectors);
+	int mdecrypt_generic_sectors(MCRYPT td, unsigned long long sector,
+				     void *data, int sector_size,
+				     int nsectors);
+
+/* Like mcrypt_generic() and mdecrypt_generic() on each of the n
+ * descriptors in td, with data[k] of len[k] bytes. Stream algorithms
+ * that support it (arcfour) interleave the streams.
+ */
+	int mcrypt_generic_streams(MCRYPT * td, void **data, const int *len,
+				   int n);
+	int mdecrypt_generic_streams(MCRYPT * td, void **data,
+				     const int *len, int n);
+
 /* extra functions */
 
 	int mcrypt_enc_set_state(MCRYPT td, void *st, int size);
@@ -74,6 +137,10 @@ typedef struct CRYPT_STREAM *MCRYPT;
  */
 	int (mcrypt_enc_is_block_mode) (MCRYPT);
 
+/* If the mode works on sectors (xts) returns 1
+ */
+	int mcrypt_enc_is_sector_mode(MCRYPT td);
+
 /* If the mode is for block algorithms it returns 1 
  */
 	int (mcrypt_enc_is_block_algorithm_mode) (MCRYPT td);
@@ -86,6 +153,16 @@ typedef struct CRYPT_STREAM *MCRYPT;
 
 	int *mcrypt_enc_get_supported_key_sizes(MCRYPT td, int *len);
 
+/* Saves the key schedule of an initialized descriptor, and initializes
+ * one from it without the key setup. Only some algorithms (blowfish)
+ * support this, and not in xts; otherwise these return a negative
+ * value.
+ */
+	int mcrypt_enc_get_schedule_size(MCRYPT td);
+	int mcrypt_generic_save_schedule(MCRYPT td, void *schedule);
+	int mcrypt_generic_init_schedule(const MCRYPT td,
+					 const void *schedule, void *IV);
+
 
 	char **mcrypt_list_algorithms(char *libdir, int *size);
 	char **mcrypt_list_modes(char *libdir, int *size);
@@ -162,6 +239,7 @@ typedef struct CRYPT_STREAM *MCRYPT;
 #define MCRYPT_RIJNDAEL_256 	"rijndael-256"
 #define MCRYPT_ENIGMA 		"enigma"
 #define MCRYPT_ARCFOUR		"arcfour"
+#define MCRYPT_ARCFOUR_DROP	"arcfour-drop"
 #define MCRYPT_WAKE		"wake"
 #define MCRYPT_IDEA		"idea"
 
@@ -172,6 +250,10 @@ typedef struct CRYPT_STREAM *MCRYPT;
 #define MCRYPT_OFB		"ofb"
 #define MCRYPT_nOFB		"nofb"
 #define MCRYPT_STREAM		"stream"
+#define MCRYPT_GCM		"gcm"
+#define MCRYPT_XTS		"xts"
+#define MCRYPT_CMAC		"cmac"
+#define MCRYPT_CBCMAC		"cbcmac"
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 1998,1999,2000,2001,2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef LIBDEFS_H
+#define LIBDEFS_H
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdio.h>
+
+#ifdef STDC_HEADERS
+# include <stdlib.h>
+# include <string.h>
+#else
+# ifdef HAVE_STDLIB_H
+#  include <stdlib.h>
+# endif
+# ifdef HAVE_STRING_H
+#  include <string.h>
+# endif
+#endif
+
+#ifdef HAVE_STRINGS_H
+# include <strings.h>
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+# include <sys/types.h>
+#endif
+
+#ifdef HAVE_BYTESWAP_H
+# include <byteswap.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
+
+#ifdef USE_DMALLOC
+# include <dmalloc.h>
+#endif
+
+#ifdef WIN32
+# define WIN32DLL_DEFINE __declspec( dllexport)
+#else
+# define WIN32DLL_DEFINE
+#endif
+
+typedef unsigned char byte;
+
+#if SIZEOF_UNSIGNED_INT == 4
+typedef unsigned int word32;
+typedef signed int sword32;
+#elif SIZEOF_UNSIGNED_LONG_INT == 4
+typedef unsigned long int word32;
+typedef signed long int sword32;
+#else
+# error "Cannot find a 32 bit integer in your system, sorry."
+#endif
+
+#if SIZEOF_UNSIGNED_SHORT_INT == 2
+typedef unsigned short int word16;
+#elif SIZEOF_UNSIGNED_INT == 2
+typedef unsigned int word16;
+#else
+# error "Cannot find a 16 bit integer in your system, sorry."
+#endif
+
+#define rotl32(x,n)   (((x) << ((word32)(n))) | ((x) >> (32 - (word32)(n))))
+#define rotr32(x,n)   (((x) >> ((word32)(n))) | ((x) << (32 - (word32)(n))))
+#define rotl16(x,n)   (((x) << ((word16)(n))) | ((x) >> (16 - (word16)(n))))
+#define rotr16(x,n)   (((x) >> ((word16)(n))) | ((x) << (16 - (word16)(n))))
+
+/* Use the system's byte swapping when there is one */
+#ifdef bswap_32
+# define byteswap32(x)	bswap_32(x)
+#else
+# define byteswap32(x)	((rotl32(x, 8) & 0x00ff00ff) | (rotr32(x, 8) & 0xff00ff00))
+#endif
+
+#ifdef bswap_16
+# define byteswap16(x)	bswap_16(x)
+#else
+# define byteswap16(x)	((rotl16(x, 8) & 0x00ff) | (rotr16(x, 8) & 0xff00))
+#endif
+
+#ifdef HAVE_MEMSET
+# define Bzero(x, y) memset(x, 0, y)
+#else
+# define Bzero(x, y) bzero(x, y)
+#endif
+
+#endif
@@ -0,0 +1,762 @@
+/*
+ * Copyright (C) 1998,1999,2000,2001,2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_internal.h>
+#include "mcrypt_probes.h"
+
+/* The generic functions. They pass the calls on to the mode module,
+ * with the algorithm's key and functions as arguments.
+ */
+
+static int mcrypt_get_size(MCRYPT td)
+{
+	int (*_mcrypt_get_size) (void);
+
+	_mcrypt_get_size = mcrypt_dlsym(td->algorithm_handle, "_mcrypt_get_size");
+	if (_mcrypt_get_size == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_get_size();
+}
+
+static int mcrypt_mode_get_size(MCRYPT td)
+{
+	int (*_mcrypt_get_size) (void);
+
+	_mcrypt_get_size = mcrypt_dlsym(td->mode_handle, "_mcrypt_mode_get_size");
+	if (_mcrypt_get_size == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_get_size();
+}
+
+static int mcrypt_set_key(MCRYPT td, void *a, const void *key, int keysize,
+			  const void *iv, int e)
+{
+	int (*__mcrypt_set_key_stream) (void *, const void *, int,
+					const void *, int);
+	int (*__mcrypt_set_key_block) (void *, const void *, int);
+
+	if (mcrypt_enc_is_block_algorithm(td) == 0) {
+		/* stream */
+		__mcrypt_set_key_stream =
+		    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_set_key");
+		if (__mcrypt_set_key_stream == NULL)
+			return MCRYPT_UNKNOWN_ERROR;
+		return __mcrypt_set_key_stream(a, key, keysize, iv, e);
+	} else {
+		__mcrypt_set_key_block =
+		    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_set_key");
+		if (__mcrypt_set_key_block == NULL)
+			return MCRYPT_UNKNOWN_ERROR;
+		return __mcrypt_set_key_block(a, key, keysize);
+	}
+}
+
+static int init_mcrypt(MCRYPT td, void *buf, void *key, int keysize,
+		       void *iv)
+{
+	int (*_init_mcrypt) (void *, void *, int, void *, int);
+
+	_init_mcrypt = mcrypt_dlsym(td->mode_handle, "_init_mcrypt");
+	if (_init_mcrypt == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+
+	return _init_mcrypt(buf, key, keysize, iv,
+			    mcrypt_enc_get_block_size(td));
+}
+
+static int end_mcrypt(MCRYPT td, void *buf)
+{
+	int (*_end_mcrypt) (void *);
+
+	_end_mcrypt = mcrypt_dlsym(td->mode_handle, "_end_mcrypt");
+	if (_end_mcrypt == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+
+	return _end_mcrypt(buf);
+}
+
+/* The algorithm's keys and the mode state share one allocation,
+ * aligned to a cache line; each starts on a line of its own.
+ */
+#define STATE_ALIGN 64
+#define STATE_ROUND(x) (((x) + STATE_ALIGN - 1) & ~(STATE_ALIGN - 1))
+
+static int key_area_size(MCRYPT td)
+{
+	int size = mcrypt_get_size(td);
+
+	return STATE_ROUND(size > 0 ? size : 1);
+}
+
+static int state_size(MCRYPT td)
+{
+	int size = mcrypt_mode_get_size(td);
+	int keys = td->m_set_tweak_key != NULL ? 2 : 1;
+
+	return keys * key_area_size(td) + (size > 0 ? size : 0);
+}
+
+/* Clears and frees the keys and the mode state */
+static void internal_end_mcrypt(MCRYPT td)
+{
+	if (td->keyword_given != NULL) {
+		Bzero(td->keyword_given, mcrypt_enc_get_key_size(td));
+		free(td->keyword_given);
+		td->keyword_given = NULL;
+	}
+
+	if (td->abuf != NULL) {
+		end_mcrypt(td, td->abuf);
+		td->abuf = NULL;
+	}
+
+	/* akey2 and abuf were part of this block */
+	td->akey2 = NULL;
+	if (td->akey != NULL) {
+		Bzero(td->akey, state_size(td));
+		free(td->akey);
+		td->akey = NULL;
+	}
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_set_state(MCRYPT td, void *iv, int size)
+{
+	int (*__mcrypt_set_state) (void *, void *, int);
+
+	__mcrypt_set_state = mcrypt_dlsym(td->mode_handle, "_mcrypt_set_state");
+	if (__mcrypt_set_state == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return __mcrypt_set_state(td->abuf, iv, size);
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_get_state(MCRYPT td, void *iv, int *size)
+{
+	int (*__mcrypt_get_state) (void *, void *, int *);
+
+	__mcrypt_get_state = mcrypt_dlsym(td->mode_handle, "_mcrypt_get_state");
+	if (__mcrypt_get_state == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return __mcrypt_get_state(td->abuf, iv, size);
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_get_block_size(MCRYPT td)
+{
+	return td->a_block_size();
+}
+
+static int mcrypt_get_algo_iv_size(MCRYPT td)
+{
+	int (*_mcrypt_get_algo_iv_size) (void);
+
+	_mcrypt_get_algo_iv_size =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_get_algo_iv_size");
+	if (_mcrypt_get_algo_iv_size == NULL)
+		return 0;
+	return _mcrypt_get_algo_iv_size();
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_get_iv_size(MCRYPT td)
+{
+	if (mcrypt_enc_is_block_algorithm_mode(td) == 1)
+		return mcrypt_enc_get_block_size(td);
+	return mcrypt_get_algo_iv_size(td);
+}
+
+/* The modes with a tweak key (XTS) take two keys of the algorithm,
+ * so their key sizes are twice the algorithm's.
+ */
+WIN32DLL_DEFINE int mcrypt_enc_get_key_size(MCRYPT td)
+{
+	int (*_mcrypt_get_key_size) (void);
+
+	_mcrypt_get_key_size =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_get_key_size");
+	if (_mcrypt_get_key_size == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	if (td->m_set_tweak_key != NULL)
+		return 2 * _mcrypt_get_key_size();
+	return _mcrypt_get_key_size();
+}
+
+WIN32DLL_DEFINE int *mcrypt_enc_get_supported_key_sizes(MCRYPT td,
+							 int *len)
+{
+	const int *(*_mcrypt_get_key_sizes) (int *);
+	const int *size;
+	int *ret, i;
+
+	*len = 0;
+	_mcrypt_get_key_sizes = mcrypt_dlsym(td->algorithm_handle,
+					     "_mcrypt_get_supported_key_sizes");
+	if (_mcrypt_get_key_sizes == NULL)
+		return NULL;
+
+	size = _mcrypt_get_key_sizes(len);
+	if (size == NULL || *len <= 0) {
+		*len = 0;
+		return NULL;
+	}
+
+	ret = malloc(sizeof(int) * (*len));
+	if (ret == NULL) {
+		*len = 0;
+		return NULL;
+	}
+	memcpy(ret, size, sizeof(int) * (*len));
+	if (td->m_set_tweak_key != NULL)
+		for (i = 0; i < *len; i++)
+			ret[i] *= 2;
+	return ret;
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_is_block_algorithm(MCRYPT td)
+{
+	int (*_is_block_algorithm) (void);
+
+	_is_block_algorithm =
+	    mcrypt_dlsym(td->algorithm_handle, "_is_block_algorithm");
+	if (_is_block_algorithm == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _is_block_algorithm();
+}
+
+WIN32DLL_DEFINE char *mcrypt_enc_get_algorithms_name(MCRYPT td)
+{
+	const char *(*_mcrypt_get_algorithms_name) (void);
+
+	_mcrypt_get_algorithms_name =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_get_algorithms_name");
+	if (_mcrypt_get_algorithms_name == NULL)
+		return NULL;
+	return strdup(_mcrypt_get_algorithms_name());
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_self_test(MCRYPT td)
+{
+	int (*_self_test) (void);
+
+	_self_test = mcrypt_dlsym(td->algorithm_handle, "_mcrypt_self_test");
+	if (_self_test == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _self_test();
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_is_block_mode(MCRYPT td)
+{
+	int (*_is_block_mode) (void);
+
+	_is_block_mode = mcrypt_dlsym(td->mode_handle, "_is_block_mode");
+	if (_is_block_mode == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _is_block_mode();
+}
+
+/* The sector modes (XTS) treat each call to mcrypt_generic() as a
+ * sector of its own, so the data must not be split.
+ */
+WIN32DLL_DEFINE int mcrypt_enc_is_sector_mode(MCRYPT td)
+{
+	if (mcrypt_dlsym(td->mode_handle, "_mcrypt_sectors") == NULL)
+		return 0;
+	return 1;
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_is_block_algorithm_mode(MCRYPT td)
+{
+	int (*_is_a_block_mode) (void);
+
+	_is_a_block_mode =
+	    mcrypt_dlsym(td->mode_handle, "_is_block_algorithm_mode");
+	if (_is_a_block_mode == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _is_a_block_mode();
+}
+
+WIN32DLL_DEFINE char *mcrypt_enc_get_modes_name(MCRYPT td)
+{
+	const char *(*_mcrypt_get_modes_name) (void);
+
+	_mcrypt_get_modes_name =
+	    mcrypt_dlsym(td->mode_handle, "_mcrypt_get_modes_name");
+	if (_mcrypt_get_modes_name == NULL)
+		return NULL;
+	return strdup(_mcrypt_get_modes_name());
+}
+
+WIN32DLL_DEFINE int mcrypt_enc_mode_has_iv(MCRYPT td)
+{
+	int (*_has_iv) (void);
+
+	_has_iv = mcrypt_dlsym(td->mode_handle, "_has_iv");
+	if (_has_iv == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _has_iv();
+}
+
+/* The algorithms that can save their key schedule (blowfish) */
+WIN32DLL_DEFINE int mcrypt_enc_get_schedule_size(MCRYPT td)
+{
+	int (*_mcrypt_get_schedule_size) (void);
+
+	_mcrypt_get_schedule_size =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_get_schedule_size");
+	if (_mcrypt_get_schedule_size == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_get_schedule_size();
+}
+
+/* Allocates the algorithm's key and the mode state and starts the
+ * mode; the key itself is set by the caller.
+ */
+static int init_buffers(MCRYPT td, void *key, int key_size, void *IV)
+{
+	int size = state_size(td);
+	int off;
+
+#ifdef HAVE_POSIX_MEMALIGN
+	if (posix_memalign((void **) &td->akey, STATE_ALIGN, size) != 0)
+		td->akey = NULL;
+#else
+	td->akey = malloc(size);
+#endif
+	if (td->akey == NULL)
+		return MCRYPT_MEMORY_ALLOCATION_ERROR;
+	memset(td->akey, 0, size);
+
+	off = key_area_size(td);
+	if (td->m_set_tweak_key != NULL) {
+		td->akey2 = td->akey + off;
+		off += key_area_size(td);
+	}
+	if (mcrypt_mode_get_size(td) > 0)
+		td->abuf = td->akey + off;
+
+	if (init_mcrypt(td, td->abuf, key, key_size, IV) != 0)
+		return MCRYPT_UNKNOWN_ERROR;
+
+	if (td->m_set_blocks != NULL && td->a_encrypt_blocks != NULL)
+		td->m_set_blocks(td->abuf, td->a_encrypt_blocks,
+				 td->a_decrypt_blocks);
+	return 0;
+}
+
+static int generic_init(const MCRYPT td, void *key, int lenofkey, void *IV)
+{
+	int *sizes = NULL;
+	int num_of_sizes, i, ok = 0;
+	int key_size = mcrypt_enc_get_key_size(td);
+	int err;
+
+	if (lenofkey > key_size || lenofkey <= 0)
+		return MCRYPT_KEY_LEN_ERROR;
+
+	sizes = mcrypt_enc_get_supported_key_sizes(td, &num_of_sizes);
+	if (sizes != NULL) {
+		for (i = 0; i < num_of_sizes; i++) {
+			if (lenofkey == sizes[i]) {
+				ok = 1;
+				break;
+			}
+		}
+	} else {
+		/* every size up to the maximum */
+		if (num_of_sizes == 0 && lenofkey <= key_size)
+			ok = 1;
+	}
+
+	if (ok == 0) {
+		/* not a supported key size; pad it with zeros to the
+		 * next one */
+		if (sizes != NULL) {
+			for (i = 0; i < num_of_sizes; i++) {
+				if (lenofkey <= sizes[i]) {
+					key_size = sizes[i];
+					break;
+				}
+			}
+		} else
+			key_size = lenofkey;
+	} else
+		key_size = lenofkey;
+	free(sizes);
+
+	/* a tweak mode splits the key in two halves; an odd size can
+	 * only come from an algorithm that takes any size, so pad it */
+	if (td->m_set_tweak_key != NULL)
+		key_size = (key_size + 1) / 2;
+
+	td->keyword_given = calloc(1, mcrypt_enc_get_key_size(td));
+	if (td->keyword_given == NULL)
+		return MCRYPT_MEMORY_ALLOCATION_ERROR;
+	memmove(td->keyword_given, key, lenofkey);
+
+	err = init_buffers(td, key, key_size, IV);
+	if (err != 0)
+		goto freeall;
+
+	if (mcrypt_set_key(td, td->akey, td->keyword_given, key_size, IV,
+			   IV != NULL ? mcrypt_enc_get_iv_size(td) : 0) !=
+	    0) {
+		err = MCRYPT_UNKNOWN_ERROR;
+		goto freeall;
+	}
+
+	if (td->m_set_tweak_key != NULL) {
+		if (mcrypt_set_key(td, td->akey2,
+				   td->keyword_given + key_size, key_size,
+				   NULL, 0) != 0) {
+			err = MCRYPT_UNKNOWN_ERROR;
+			goto freeall;
+		}
+		td->m_set_tweak_key(td->abuf, td->akey2);
+	}
+
+	return 0;
+
+      freeall:
+	internal_end_mcrypt(td);
+	return err;
+}
+
+/* Stores the key schedule set up by mcrypt_generic_init(), of
+ * mcrypt_enc_get_schedule_size() bytes, in schedule.
+ */
+WIN32DLL_DEFINE
+    int mcrypt_generic_save_schedule(MCRYPT td, void *schedule)
+{
+	int (*_mcrypt_save_schedule) (void *, void *);
+
+	/* the tweak key of XTS is not saved */
+	if (td->akey == NULL || td->m_set_tweak_key != NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	_mcrypt_save_schedule =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_save_schedule");
+	if (_mcrypt_save_schedule == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_save_schedule(td->akey, schedule);
+}
+
+/* Like mcrypt_generic_init(), with a saved key schedule instead of the
+ * key, so that the key setup is skipped.
+ */
+WIN32DLL_DEFINE
+    int mcrypt_generic_init_schedule(const MCRYPT td, const void *schedule,
+				     void *IV)
+{
+	int (*_mcrypt_load_schedule) (void *, const void *);
+	int err;
+
+	if (td->m_set_tweak_key != NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	_mcrypt_load_schedule =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_load_schedule");
+	if (_mcrypt_load_schedule == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+
+	/* the key itself is not known */
+	td->keyword_given = calloc(1, mcrypt_enc_get_key_size(td));
+	if (td->keyword_given == NULL)
+		return MCRYPT_MEMORY_ALLOCATION_ERROR;
+
+	err = init_buffers(td, NULL, 0, IV);
+	if (err == 0 && _mcrypt_load_schedule(td->akey, schedule) != 0)
+		err = MCRYPT_UNKNOWN_ERROR;
+	if (err != 0)
+		internal_end_mcrypt(td);
+	return err;
+}
+
+/* The init, encrypt and decrypt probes take td and the key or data
+ * length, and the return code when done.
+ */
+WIN32DLL_DEFINE
+    int mcrypt_generic_init(const MCRYPT td, void *key, int lenofkey,
+			    void *IV)
+{
+	int rc;
+
+	MCRYPT_PROBE2(init__start, td, lenofkey);
+	rc = generic_init(td, key, lenofkey, IV);
+	MCRYPT_PROBE3(init__done, td, lenofkey, rc);
+	return rc;
+}
+
+WIN32DLL_DEFINE int mcrypt_generic(MCRYPT td, void *plaintext, int len)
+{
+	int rc;
+
+	MCRYPT_PROBE2(encrypt__start, td, len);
+	rc = td->m_encrypt(td->abuf, plaintext, len,
+			   mcrypt_enc_get_block_size(td), td->akey,
+			   td->a_encrypt, td->a_decrypt);
+	MCRYPT_PROBE3(encrypt__done, td, len, rc);
+	return rc;
+}
+
+WIN32DLL_DEFINE int mdecrypt_generic(MCRYPT td, void *ciphertext, int len)
+{
+	int rc;
+
+	MCRYPT_PROBE2(decrypt__start, td, len);
+	rc = td->m_decrypt(td->abuf, ciphertext, len,
+			   mcrypt_enc_get_block_size(td), td->akey,
+			   td->a_encrypt, td->a_decrypt);
+	MCRYPT_PROBE3(decrypt__done, td, len, rc);
+	return rc;
+}
+
+/* The modes without _mcrypt_out() and _mdecrypt_out() work in place
+ * on a copy.
+ */
+WIN32DLL_DEFINE
+    int mcrypt_generic_out(MCRYPT td, const void *in, void *out, int len)
+{
+	if (td->m_encrypt_out != NULL)
+		return td->m_encrypt_out(td->abuf, in, out, len,
+					 mcrypt_enc_get_block_size(td),
+					 td->akey, td->a_encrypt,
+					 td->a_decrypt);
+	if (len < 0)
+		return MCRYPT_UNKNOWN_ERROR;
+	if (out != in)
+		memcpy(out, in, len);
+	return mcrypt_generic(td, out, len);
+}
+
+WIN32DLL_DEFINE
+    int mdecrypt_generic_out(MCRYPT td, const void *in, void *out, int len)
+{
+	if (td->m_decrypt_out != NULL)
+		return td->m_decrypt_out(td->abuf, in, out, len,
+					 mcrypt_enc_get_block_size(td),
+					 td->akey, td->a_encrypt,
+					 td->a_decrypt);
+	if (len < 0)
+		return MCRYPT_UNKNOWN_ERROR;
+	if (out != in)
+		memcpy(out, in, len);
+	return mdecrypt_generic(td, out, len);
+}
+
+/* The authenticated modes (GCM). The mode functions take the same
+ * trailing arguments as _mcrypt().
+ */
+WIN32DLL_DEFINE int mcrypt_generic_aad(MCRYPT td, const void *aad, int len)
+{
+	int (*_mcrypt_aad) (void *, const void *, int, int, void *, void *,
+			    void *);
+
+	_mcrypt_aad = mcrypt_dlsym(td->mode_handle, "_mcrypt_aad");
+	if (_mcrypt_aad == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_aad(td->abuf, aad, len, mcrypt_enc_get_block_size(td),
+			   td->akey, td->a_encrypt, td->a_decrypt);
+}
+
+WIN32DLL_DEFINE int mcrypt_generic_get_tag(MCRYPT td, void *tag, int len)
+{
+	int (*_mcrypt_get_tag) (void *, void *, int, int, void *, void *,
+				void *);
+
+	_mcrypt_get_tag = mcrypt_dlsym(td->mode_handle, "_mcrypt_get_tag");
+	if (_mcrypt_get_tag == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_get_tag(td->abuf, tag, len,
+			       mcrypt_enc_get_block_size(td), td->akey,
+			       td->a_encrypt, td->a_decrypt);
+}
+
+WIN32DLL_DEFINE
+    int mdecrypt_generic_verify_tag(MCRYPT td, const void *tag, int len)
+{
+	int (*_mdecrypt_verify_tag) (void *, const void *, int, int, void *,
+				     void *, void *);
+
+	_mdecrypt_verify_tag =
+	    mcrypt_dlsym(td->mode_handle, "_mdecrypt_verify_tag");
+	if (_mdecrypt_verify_tag == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mdecrypt_verify_tag(td->abuf, tag, len,
+				    mcrypt_enc_get_block_size(td), td->akey,
+				    td->a_encrypt, td->a_decrypt);
+}
+
+/* The MAC modes (CMAC, CBC-MAC); mdecrypt_generic_verify_tag() above
+ * also ends their messages.
+ */
+WIN32DLL_DEFINE
+    int mcrypt_generic_mac_update(MCRYPT td, const void *data, int len)
+{
+	int (*_mcrypt_mac_update) (void *, const void *, int, int, void *,
+				   void *, void *);
+
+	_mcrypt_mac_update =
+	    mcrypt_dlsym(td->mode_handle, "_mcrypt_mac_update");
+	if (_mcrypt_mac_update == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_mac_update(td->abuf, data, len,
+				  mcrypt_enc_get_block_size(td), td->akey,
+				  td->a_encrypt, td->a_decrypt);
+}
+
+WIN32DLL_DEFINE int mcrypt_generic_mac_final(MCRYPT td, void *tag, int len)
+{
+	int (*_mcrypt_mac_final) (void *, void *, int, int, void *, void *,
+				  void *);
+
+	_mcrypt_mac_final = mcrypt_dlsym(td->mode_handle, "_mcrypt_mac_final");
+	if (_mcrypt_mac_final == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_mac_final(td->abuf, tag, len,
+				 mcrypt_enc_get_block_size(td), td->akey,
+				 td->a_encrypt, td->a_decrypt);
+}
+
+/* The output feedback and counter modes; returns the number of bytes
+ * of keystream ready.
+ */
+WIN32DLL_DEFINE int mcrypt_generic_prefetch(MCRYPT td, int len)
+{
+	int (*_mcrypt_prefetch) (void *, int, int, void *, void *, void *);
+
+	_mcrypt_prefetch = mcrypt_dlsym(td->mode_handle, "_mcrypt_prefetch");
+	if (_mcrypt_prefetch == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_prefetch(td->abuf, len, mcrypt_enc_get_block_size(td),
+				td->akey, td->a_encrypt, td->a_decrypt);
+}
+
+WIN32DLL_DEFINE
+    int mcrypt_generic_sectors(MCRYPT td, unsigned long long sector,
+			       void *data, int sector_size, int nsectors)
+{
+	int (*_mcrypt_sectors) (void *, void *, int, int, unsigned long long,
+				int, void *, void *, void *);
+
+	_mcrypt_sectors = mcrypt_dlsym(td->mode_handle, "_mcrypt_sectors");
+	if (_mcrypt_sectors == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mcrypt_sectors(td->abuf, data, sector_size, nsectors, sector,
+			       mcrypt_enc_get_block_size(td), td->akey,
+			       td->a_encrypt, td->a_decrypt);
+}
+
+WIN32DLL_DEFINE
+    int mdecrypt_generic_sectors(MCRYPT td, unsigned long long sector,
+				 void *data, int sector_size, int nsectors)
+{
+	int (*_mdecrypt_sectors) (void *, void *, int, int,
+				  unsigned long long, int, void *, void *,
+				  void *);
+
+	_mdecrypt_sectors = mcrypt_dlsym(td->mode_handle, "_mdecrypt_sectors");
+	if (_mdecrypt_sectors == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	return _mdecrypt_sectors(td->abuf, data, sector_size, nsectors,
+				 sector, mcrypt_enc_get_block_size(td),
+				 td->akey, td->a_encrypt, td->a_decrypt);
+}
+
+/* Runs crypt() on each descriptor, or the algorithm's interleaved
+ * sym entry point on all of them when they share a stream algorithm
+ * that exports it, in the stream mode. That entry point takes a key
+ * per stream, so a descriptor given twice goes through crypt() too.
+ */
+static int generic_streams(MCRYPT * td, void **data, const int *len,
+			   int n, char *sym,
+			   int (*crypt) (MCRYPT, void *, int))
+{
+	void (*_mcrypt_streams) (void **, void **, const int *, int) = NULL;
+	void **keys;
+	int i, j, rc;
+
+	if (n < 0 || (n > 0 && (td == NULL || data == NULL || len == NULL)))
+		return MCRYPT_UNKNOWN_ERROR;
+	for (i = 0; i < n; i++)
+		if (td[i] == NULL || td[i]->akey == NULL || len[i] < 0)
+			return MCRYPT_UNKNOWN_ERROR;
+	if (n == 0)
+		return 0;
+
+	if (mcrypt_enc_is_block_algorithm_mode(td[0]) == 0)
+		_mcrypt_streams = mcrypt_dlsym(td[0]->algorithm_handle, sym);
+	for (i = 1; i < n && _mcrypt_streams != NULL; i++) {
+		if (td[i]->a_encrypt != td[0]->a_encrypt
+		    || td[i]->m_encrypt != td[0]->m_encrypt)
+			_mcrypt_streams = NULL;
+		for (j = 0; j < i && _mcrypt_streams != NULL; j++)
+			if (td[j]->akey == td[i]->akey)
+				_mcrypt_streams = NULL;
+	}
+
+	if (_mcrypt_streams == NULL) {
+		for (i = 0; i < n; i++) {
+			rc = crypt(td[i], data[i], len[i]);
+			if (rc != 0)
+				return rc;
+		}
+		return 0;
+	}
+
+	keys = malloc(n * sizeof(void *));
+	if (keys == NULL)
+		return MCRYPT_MEMORY_ALLOCATION_ERROR;
+	for (i = 0; i < n; i++)
+		keys[i] = td[i]->akey;
+	_mcrypt_streams(keys, data, len, n);
+	free(keys);
+	return 0;
+}
+
+WIN32DLL_DEFINE
+    int mcrypt_generic_streams(MCRYPT * td, void **data, const int *len,
+			       int n)
+{
+	return generic_streams(td, data, len, n, "_mcrypt_encrypt_streams",
+			       mcrypt_generic);
+}
+
+WIN32DLL_DEFINE
+    int mdecrypt_generic_streams(MCRYPT * td, void **data, const int *len,
+				 int n)
+{
+	return generic_streams(td, data, len, n, "_mcrypt_decrypt_streams",
+			       mdecrypt_generic);
+}
+
+WIN32DLL_DEFINE int mcrypt_generic_deinit(const MCRYPT td)
+{
+	if (td == NULL || td->keyword_given == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+
+	internal_end_mcrypt(td);
+	return 0;
+}
+
+/* deprecated; mcrypt_generic_deinit() and mcrypt_module_close() */
+WIN32DLL_DEFINE int mcrypt_generic_end(const MCRYPT td)
+{
+	if (td == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+
+	internal_end_mcrypt(td);
+	mcrypt_module_close(td);
+	return 0;
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 1998,1999,2000,2001,2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_internal.h>
+
+#ifdef USE_LTDL
+# ifdef HAVE_DIRENT_H
+#  include <dirent.h>
+# endif
+#endif
+
+#ifndef LIBDIR
+# define LIBDIR "/usr/local/lib/libmcrypt/"
+#endif
+
+/* Adds name to the list unless it is there already */
+static int mcrypt_list_add(char ***list, int *size, const char *name)
+{
+	char **tmp;
+	int i;
+
+	for (i = 0; i < *size; i++)
+		if (strcmp((*list)[i], name) == 0)
+			return 0;
+
+	tmp = realloc(*list, (*size + 1) * sizeof(char *));
+	if (tmp == NULL)
+		return -1;
+	*list = tmp;
+
+	(*list)[*size] = strdup(name);
+	if ((*list)[*size] == NULL)
+		return -1;
+	(*size)++;
+	return 0;
+}
+
+#ifdef USE_LTDL
+/* Whether the module file in directory exports sym. */
+static int mcrypt_module_has_sym(const char *directory, const char *file,
+				 char *sym)
+{
+	mcrypt_dlhandle handle;
+	int ret = 0;
+
+	if (mcrypt_dlopen(&handle, directory, NULL, file) == NULL)
+		return 0;
+	if (mcrypt_dlsym(handle, sym) != NULL)
+		ret = 1;
+	mcrypt_dlclose(handle);
+	return ret;
+}
+#endif
+
+/* Lists the modules compiled into the library, and those of libdir,
+ * that export sym.
+ */
+static char **mcrypt_list_modules(char *libdir, int *size, char *sym)
+{
+	char **list = NULL;
+	mcrypt_dlhandle handle;
+	int i;
+#ifdef USE_LTDL
+	DIR *pdir;
+	struct dirent *dirname;
+	char *name, *ext;
+#endif
+
+	*size = 0;
+
+	for (i = 0; mps[i].name != NULL || mps[i].address != NULL; i++) {
+		if (mps[i].name == NULL || mps[i].address != NULL)
+			continue;
+		if (strlen(mps[i].name) >= sizeof(handle.name))
+			continue;
+		strcpy(handle.name, mps[i].name);
+		handle.handle = MCRYPT_INTERNAL_HANDLER;
+		if (mcrypt_dlsym(handle, sym) == NULL)
+			continue;
+		if (mcrypt_list_add(&list, size, mps[i].name) != 0)
+			goto fail;
+	}
+
+#ifdef USE_LTDL
+	if (libdir == NULL)
+		libdir = LIBDIR;
+
+	pdir = opendir(libdir);
+	if (pdir == NULL)
+		return list;
+
+	if (lt_dlinit() != 0) {
+		closedir(pdir);
+		return list;
+	}
+
+	while ((dirname = readdir(pdir)) != NULL) {
+		ext = strrchr(dirname->d_name, '.');
+		if (ext == NULL || strcmp(ext, ".la") != 0)
+			continue;
+		name = strdup(dirname->d_name);
+		if (name == NULL)
+			break;
+		name[ext - dirname->d_name] = '\0';
+		if (mcrypt_module_has_sym(libdir, name, sym) != 0 &&
+		    mcrypt_list_add(&list, size, name) != 0) {
+			free(name);
+			break;
+		}
+		free(name);
+	}
+
+	lt_dlexit();
+	closedir(pdir);
+#endif
+
+	return list;
+
+      fail:
+	mcrypt_free_p(list, *size);
+	*size = 0;
+	return NULL;
+}
+
+WIN32DLL_DEFINE char **mcrypt_list_algorithms(char *libdir, int *size)
+{
+	return mcrypt_list_modules(libdir, size,
+				   "_mcrypt_get_algorithms_name");
+}
+
+WIN32DLL_DEFINE char **mcrypt_list_modes(char *libdir, int *size)
+{
+	return mcrypt_list_modules(libdir, size, "_mcrypt_get_modes_name");
+}
+
+WIN32DLL_DEFINE void mcrypt_free_p(char **p, int size)
+{
+	int i;
+
+	if (p == NULL)
+		return;
+	for (i = 0; i < size; i++)
+		free(p[i]);
+	free(p);
+}
+
+WIN32DLL_DEFINE void mcrypt_free(void *ptr)
+{
+	free(ptr);
+}
+
+WIN32DLL_DEFINE const char *mcrypt_strerror(int err)
+{
+	switch (err) {
+	case MCRYPT_UNKNOWN_ERROR:
+		return "Unknown error.\n";
+	case MCRYPT_ALGORITHM_MODE_INCOMPATIBILITY:
+		return "Algorithm incompatible with this mode.\n";
+	case MCRYPT_KEY_LEN_ERROR:
+		return "Key length is not legal.\n";
+	case MCRYPT_MEMORY_ALLOCATION_ERROR:
+		return "Memory allocation failed.\n";
+	case MCRYPT_UNKNOWN_MODE:
+		return "Unknown mode.\n";
+	case MCRYPT_UNKNOWN_ALGORITHM:
+		return "Unknown algorithm.\n";
+	}
+	return NULL;
+}
+
+WIN32DLL_DEFINE void mcrypt_perror(int err)
+{
+	const char *str = mcrypt_strerror(err);
+
+	if (str != NULL)
+		fprintf(stderr, "%s", str);
+}
+
+/* Parses "major.minor.micro"; returns NULL if str is not a version. */
+static const char *parse_version(const char *str, int *major, int *minor,
+				 int *micro)
+{
+	char *end;
+
+	*major = (int) strtol(str, &end, 10);
+	if (end == str || *end != '.')
+		return NULL;
+	str = end + 1;
+	*minor = (int) strtol(str, &end, 10);
+	if (end == str || *end != '.')
+		return NULL;
+	str = end + 1;
+	*micro = (int) strtol(str, &end, 10);
+	if (end == str)
+		return NULL;
+	return end;
+}
+
+/* Returns the version of the library if it is at least req_version,
+ * or NULL. A NULL req_version just returns the version.
+ */
+WIN32DLL_DEFINE const char *mcrypt_check_version(const char *req_version)
+{
+	const char *ver = LIBMCRYPT_VERSION;
+	int my_major, my_minor, my_micro;
+	int rq_major, rq_minor, rq_micro;
+
+	if (req_version == NULL)
+		return ver;
+
+	if (parse_version(ver, &my_major, &my_minor, &my_micro) == NULL)
+		return NULL;
+	if (parse_version(req_version, &rq_major, &rq_minor, &rq_micro) ==
+	    NULL)
+		return NULL;
+
+	if (my_major > rq_major
+	    || (my_major == rq_major && my_minor > rq_minor)
+	    || (my_major == rq_major && my_minor == rq_minor
+		&& my_micro >= rq_micro))
+		return ver;
+
+	return NULL;
+}
+
+/* Used by the modes, on blocks and on runs of keystream; eight bytes
+ * at a time, through memcpy() as the buffers need not be aligned.
+ */
+void memxor(unsigned char *o1, const unsigned char *o2, int length)
+{
+	word32 a[2], b[2];
+
+	for (; length >= 8; length -= 8, o1 += 8, o2 += 8) {
+		memcpy(a, o1, 8);
+		memcpy(b, o2, 8);
+		a[0] ^= b[0];
+		a[1] ^= b[1];
+		memcpy(o1, a, 8);
+	}
+	for (; length > 0; length--)
+		*o1++ ^= *o2++;
+}
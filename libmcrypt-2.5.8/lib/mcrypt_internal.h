@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 1998,1999,2000,2001,2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MCRYPT_INTERNAL_H
+#define MCRYPT_INTERNAL_H
+
+#include "libdefs.h"
+#include "mcrypt_modules.h"
+#include <mutils/mcrypt.h>
+
+#ifdef USE_LTDL
+# include <ltdl.h>
+#endif
+
+/* The symbols of the modules compiled into the library; mcrypt_symb.c
+ * is generated by the Makefile. A module starts with an entry named
+ * after it and a NULL address, followed by its symbols.
+ */
+typedef struct {
+	char *name;
+	void *address;
+} mcrypt_preloaded;
+
+extern const mcrypt_preloaded mps[];
+
+struct CRYPT_STREAM {
+	mcrypt_dlhandle algorithm_handle;
+	mcrypt_dlhandle mode_handle;
+
+	/* Holds the algorithm's internal key */
+	byte *akey;
+
+	/* The second key of the modes with a tweak key (XTS) */
+	byte *akey2;
+
+	/* holds the mode's internal buffers */
+	byte *abuf;
+
+	/* holds the key */
+	byte *keyword_given;
+
+	/* These are looked up once in mcrypt_module_open(), to keep
+	 * them out of mcrypt_generic() and mdecrypt_generic().
+	 */
+	/* ALGORITHM */
+	void *a_encrypt;
+	void *a_decrypt;
+	int (*a_block_size) (void);
+	/* The optional multi-block entry points, NULL unless both exist */
+	void *a_encrypt_blocks;
+	void *a_decrypt_blocks;
+
+	/* MODE */
+	int (*m_encrypt) (void *, void *, int, int, void *, void *,
+			  void *);
+	int (*m_decrypt) (void *, void *, int, int, void *, void *,
+			  void *);
+
+	/* The optional entry points, NULL when the mode does not export
+	 * them.
+	 */
+	int (*m_encrypt_out) (void *, const void *, void *, int, int,
+			      void *, void *, void *);
+	int (*m_decrypt_out) (void *, const void *, void *, int, int,
+			      void *, void *, void *);
+	int (*m_set_blocks) (void *, void *, void *);
+	int (*m_set_tweak_key) (void *, void *);
+};
+
+/* mcrypt_modules.c */
+const mcrypt_preloaded *_mcrypt_search_symlist_lib(const char *name);
+void *_mcrypt_search_symlist_sym(mcrypt_dlhandle handle, const char *sym);
+
+/* mcrypt_threads.c */
+void _mcrypt_mutex_lock(void);
+void _mcrypt_mutex_unlock(void);
+void _mcrypt_set_error(const char *error);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 1998,1999,2000,2001 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_internal.h>
+#include "mcrypt_probes.h"
+#include <sys/uio.h>
+#include <limits.h>
+
+/* Scatter-gather versions of mcrypt_generic() and mdecrypt_generic().
+ *
+ * The stream modes (CTR, CFB, OFB, nCFB, nOFB and stream) keep their
+ * position inside the current block in the mode state, so each
+ * fragment is simply handed to the mode in turn. The block modes
+ * (ECB and CBC) only take whole blocks; a block that straddles
+ * fragments is gathered into a bounce block, run through the mode
+ * and scattered back. The sector modes (XTS) take each call as a
+ * sector, so they are refused; see mcrypt_generic_sectors().
+ *
+ * The encrypt__iov and decrypt__iov probes take td and iovcnt, and
+ * the return code when done.
+ */
+
+#define IOV_MAX_BLOCK_SIZE 32
+
+typedef int (*iov_crypt_func) (MCRYPT, void *, int);
+
+/* mcrypt_generic() takes an int length; split larger fragments on a
+ * block boundary. */
+static int iov_run(MCRYPT td, iov_crypt_func crypt, byte * p, size_t len,
+		   int blocksize)
+{
+	size_t max = INT_MAX - INT_MAX % blocksize;
+	size_t n;
+	int rc;
+
+	while (len > 0) {
+		n = len < max ? len : max;
+		rc = crypt(td, p, (int) n);
+		if (rc != 0)
+			return rc;
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int iov_crypt(MCRYPT td, const struct iovec *iov, int iovcnt,
+		     iov_crypt_func crypt)
+{
+	byte block[IOV_MAX_BLOCK_SIZE];
+	byte *piece[IOV_MAX_BLOCK_SIZE];
+	int piece_len[IOV_MAX_BLOCK_SIZE];
+	int pieces = 0, have = 0;
+	int blocksize, i, j, n, off, rc;
+	size_t len, whole;
+	byte *p;
+
+	if (iovcnt < 0 || (iovcnt > 0 && iov == NULL))
+		return -1;
+	if (mcrypt_enc_is_sector_mode(td) != 0)
+		return -1;
+
+	if (mcrypt_enc_is_block_mode(td) != 1) {
+		for (i = 0; i < iovcnt; i++) {
+			rc = iov_run(td, crypt, iov[i].iov_base,
+				     iov[i].iov_len, 1);
+			if (rc != 0)
+				return rc;
+		}
+		return 0;
+	}
+
+	blocksize = mcrypt_enc_get_block_size(td);
+	if (blocksize <= 0 || blocksize > IOV_MAX_BLOCK_SIZE)
+		return -1;
+
+	for (i = 0; i < iovcnt; i++) {
+		p = iov[i].iov_base;
+		len = iov[i].iov_len;
+		if (len == 0)
+			continue;
+
+		/* complete the block started in the previous fragments */
+		if (have > 0) {
+			n = blocksize - have;
+			if ((size_t) n > len)
+				n = (int) len;
+			memcpy(&block[have], p, n);
+			piece[pieces] = p;
+			piece_len[pieces++] = n;
+			have += n;
+			p += n;
+			len -= n;
+			if (have < blocksize)
+				continue;
+
+			rc = crypt(td, block, blocksize);
+			if (rc != 0)
+				goto out;
+			for (j = 0, off = 0; j < pieces; j++) {
+				memcpy(piece[j], &block[off], piece_len[j]);
+				off += piece_len[j];
+			}
+			have = pieces = 0;
+		}
+
+		whole = len - len % blocksize;
+		rc = iov_run(td, crypt, p, whole, blocksize);
+		if (rc != 0)
+			goto out;
+		p += whole;
+		len -= whole;
+
+		if (len > 0) {
+			memcpy(block, p, len);
+			piece[0] = p;
+			piece_len[0] = (int) len;
+			pieces = 1;
+			have = (int) len;
+		}
+	}
+
+	/* like mcrypt_generic(), a block mode needs whole blocks */
+	rc = have > 0 ? -1 : 0;
+out:
+	memset(block, 0, sizeof(block));
+	return rc;
+}
+
+WIN32DLL_DEFINE
+    int mcrypt_generic_iov(MCRYPT td, const struct iovec *iov, int iovcnt)
+{
+	int rc;
+
+	MCRYPT_PROBE2(encrypt__iov__start, td, iovcnt);
+	rc = iov_crypt(td, iov, iovcnt, mcrypt_generic);
+	MCRYPT_PROBE3(encrypt__iov__done, td, iovcnt, rc);
+	return rc;
+}
+
+WIN32DLL_DEFINE
+    int mdecrypt_generic_iov(MCRYPT td, const struct iovec *iov,
+			     int iovcnt)
+{
+	int rc;
+
+	MCRYPT_PROBE2(decrypt__iov__start, td, iovcnt);
+	rc = iov_crypt(td, iov, iovcnt, mdecrypt_generic);
+	MCRYPT_PROBE3(decrypt__iov__done, td, iovcnt, rc);
+	return rc;
+}
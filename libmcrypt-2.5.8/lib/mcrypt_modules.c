@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 1998,1999,2000,2001,2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_internal.h>
+#include "mcrypt_probes.h"
+
+#ifndef LIBDIR
+# define LIBDIR "/usr/local/lib/libmcrypt/"
+#endif
+
+#ifndef USE_LTDL
+/* Without libltdl only the modules compiled into the library exist */
+static int lt_dlinit(void)
+{
+	return 0;
+}
+
+static int lt_dlexit(void)
+{
+	return 0;
+}
+#endif
+
+/* Module names may hold a '-', which becomes a '_' in their symbols */
+static void _mcrypt_sanitize_name(char *name)
+{
+	for (; *name != '\0'; name++)
+		if (*name == '-')
+			*name = '_';
+}
+
+const mcrypt_preloaded *_mcrypt_search_symlist_lib(const char *name)
+{
+	int i = 0;
+
+	while (mps[i].name != NULL || mps[i].address != NULL) {
+		if (mps[i].name != NULL && mps[i].address == NULL) {
+			if (strcmp(name, mps[i].name) == 0)
+				return &mps[i];
+		}
+		i++;
+	}
+	return NULL;
+}
+
+void *_mcrypt_search_symlist_sym(mcrypt_dlhandle handle, const char *sym)
+{
+	char name[MAX_MOD_SIZE];
+	int i = 0;
+
+	if (strlen(handle.name) + strlen(sym) + 6 > sizeof(name))
+		return NULL;
+
+	strcpy(name, handle.name);
+	_mcrypt_sanitize_name(name);
+	strcat(name, "_LTX_");
+	strcat(name, sym);
+
+	while (mps[i].name != NULL || mps[i].address != NULL) {
+		if (mps[i].name != NULL && mps[i].address != NULL) {
+			if (strcmp(name, mps[i].name) == 0)
+				return mps[i].address;
+		}
+		i++;
+	}
+	return NULL;
+}
+
+void *mcrypt_dlopen(mcrypt_dlhandle *handle, const char *a_directory,
+		    const char *m_directory, const char *filename)
+{
+#ifdef USE_LTDL
+	char paths[1539];
+#endif
+
+	if (filename == NULL || *filename == '\0')
+		return NULL;
+	if (strlen(filename) >= sizeof(handle->name))
+		return NULL;
+	strcpy(handle->name, filename);
+
+	if (_mcrypt_search_symlist_lib(filename) != NULL) {
+		handle->handle = MCRYPT_INTERNAL_HANDLER;
+		return handle->handle;
+	}
+
+#ifdef USE_LTDL
+	*paths = '\0';
+	if (a_directory != NULL) {
+		strncat(paths, a_directory, 512);
+		strcat(paths, ":");
+	}
+	if (m_directory != NULL) {
+		strncat(paths, m_directory, 512);
+		strcat(paths, ":");
+	}
+	strncat(paths, LIBDIR, 512);
+
+	_mcrypt_mutex_lock();
+	lt_dlsetsearchpath(paths);
+	handle->handle = lt_dlopenext(filename);
+	if (handle->handle == NULL)
+		_mcrypt_set_error(lt_dlerror());
+	_mcrypt_mutex_unlock();
+
+	return handle->handle;
+#else
+	handle->handle = NULL;
+	return NULL;
+#endif
+}
+
+void *mcrypt_dlsym(mcrypt_dlhandle handle, char *str)
+{
+	if (handle.handle == MCRYPT_INTERNAL_HANDLER)
+		return _mcrypt_search_symlist_sym(handle, str);
+#ifdef USE_LTDL
+	return lt_dlsym(handle.handle, str);
+#else
+	return NULL;
+#endif
+}
+
+void mcrypt_dlclose(mcrypt_dlhandle handle)
+{
+#ifdef USE_LTDL
+	if (handle.handle != MCRYPT_INTERNAL_HANDLER && handle.handle != NULL)
+		lt_dlclose(handle.handle);
+#endif
+}
+
+WIN32DLL_DEFINE int mcrypt_module_support_dynamic(void)
+{
+#ifdef USE_LTDL
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+WIN32DLL_DEFINE int mcrypt_module_close(MCRYPT td)
+{
+	if (td == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+
+	mcrypt_dlclose(td->algorithm_handle);
+	mcrypt_dlclose(td->mode_handle);
+	if (lt_dlexit() != 0)
+		return MCRYPT_UNKNOWN_ERROR;
+
+	free(td);
+	return 0;
+}
+
+/* Some modes only work with some block sizes (GCM and XTS with 16
+ * bytes, the others up to 32); their _init_mcrypt() fails for the
+ * rest. Try it on a scratch state, so that such a pair is refused
+ * here rather than by mcrypt_generic_init().
+ */
+static int mcrypt_mode_block_size_ok(MCRYPT td)
+{
+	int (*_init_mcrypt) (void *, void *, int, void *, int);
+	int (*_end_mcrypt) (void *);
+	int (*_mcrypt_mode_get_size) (void);
+	void *buf = NULL;
+	int size, ret;
+
+	_init_mcrypt = mcrypt_dlsym(td->mode_handle, "_init_mcrypt");
+	_end_mcrypt = mcrypt_dlsym(td->mode_handle, "_end_mcrypt");
+	_mcrypt_mode_get_size =
+	    mcrypt_dlsym(td->mode_handle, "_mcrypt_mode_get_size");
+	if (_init_mcrypt == NULL || _end_mcrypt == NULL
+	    || _mcrypt_mode_get_size == NULL)
+		return 0;
+
+	size = _mcrypt_mode_get_size();
+	if (size > 0) {
+		buf = calloc(1, size);
+		if (buf == NULL)
+			return 0;
+	}
+
+	ret = _init_mcrypt(buf, NULL, 0, NULL, td->a_block_size()) == 0;
+	if (ret)
+		_end_mcrypt(buf);
+
+	free(buf);
+	return ret;
+}
+
+static MCRYPT module_open(char *algorithm, char *a_directory, char *mode,
+			  char *m_directory)
+{
+	MCRYPT td;
+
+	td = calloc(1, sizeof(struct CRYPT_STREAM));
+	if (td == NULL)
+		return MCRYPT_FAILED;
+
+	if (lt_dlinit() != 0) {
+		free(td);
+		return MCRYPT_FAILED;
+	}
+
+	if (mcrypt_dlopen(&td->algorithm_handle, a_directory, m_directory,
+			  algorithm) == NULL) {
+		lt_dlexit();
+		free(td);
+		return MCRYPT_FAILED;
+	}
+
+	if (mcrypt_dlopen(&td->mode_handle, a_directory, m_directory,
+			  mode) == NULL) {
+		mcrypt_dlclose(td->algorithm_handle);
+		lt_dlexit();
+		free(td);
+		return MCRYPT_FAILED;
+	}
+
+	td->a_encrypt = mcrypt_dlsym(td->algorithm_handle, "_mcrypt_encrypt");
+	td->a_decrypt = mcrypt_dlsym(td->algorithm_handle, "_mcrypt_decrypt");
+	td->a_block_size =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_get_block_size");
+	td->m_encrypt = mcrypt_dlsym(td->mode_handle, "_mcrypt");
+	td->m_decrypt = mcrypt_dlsym(td->mode_handle, "_mdecrypt");
+
+	if (td->a_encrypt == NULL || td->a_decrypt == NULL
+	    || td->a_block_size == NULL || td->m_encrypt == NULL
+	    || td->m_decrypt == NULL) {
+		mcrypt_module_close(td);
+		return MCRYPT_FAILED;
+	}
+
+	td->m_encrypt_out = mcrypt_dlsym(td->mode_handle, "_mcrypt_out");
+	td->m_decrypt_out = mcrypt_dlsym(td->mode_handle, "_mdecrypt_out");
+	if (td->m_encrypt_out == NULL || td->m_decrypt_out == NULL) {
+		td->m_encrypt_out = NULL;
+		td->m_decrypt_out = NULL;
+	}
+
+	td->a_encrypt_blocks =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_encrypt_blocks");
+	td->a_decrypt_blocks =
+	    mcrypt_dlsym(td->algorithm_handle, "_mcrypt_decrypt_blocks");
+	if (td->a_encrypt_blocks == NULL || td->a_decrypt_blocks == NULL) {
+		td->a_encrypt_blocks = NULL;
+		td->a_decrypt_blocks = NULL;
+	}
+	td->m_set_blocks = mcrypt_dlsym(td->mode_handle, "_mcrypt_set_blocks");
+	td->m_set_tweak_key =
+	    mcrypt_dlsym(td->mode_handle, "_mcrypt_set_tweak_key");
+
+	if (mcrypt_enc_is_block_algorithm_mode(td) !=
+	    mcrypt_enc_is_block_algorithm(td)
+	    || mcrypt_mode_block_size_ok(td) == 0) {
+		mcrypt_module_close(td);
+		return MCRYPT_FAILED;
+	}
+
+	return td;
+}
+
+/* The module__open probes take the algorithm and mode names, and
+ * whether the descriptor could be opened when done.
+ */
+WIN32DLL_DEFINE
+    MCRYPT mcrypt_module_open(char *algorithm,
+			      char *a_directory, char *mode,
+			      char *m_directory)
+{
+	MCRYPT td;
+
+	MCRYPT_PROBE2(module__open__start, algorithm, mode);
+	td = module_open(algorithm, a_directory, mode, m_directory);
+	MCRYPT_PROBE3(module__open__done, algorithm, mode,
+		      td != MCRYPT_FAILED);
+	return td;
+}
+
+/* The functions below open a single module, look up one symbol and
+ * close it again.
+ */
+static void *mcrypt_module_sym(mcrypt_dlhandle *handle,
+			       const char *directory, const char *module,
+			       char *sym)
+{
+	void *ret;
+
+	if (lt_dlinit() != 0)
+		return NULL;
+	if (mcrypt_dlopen(handle, directory, NULL, module) == NULL) {
+		lt_dlexit();
+		return NULL;
+	}
+	ret = mcrypt_dlsym(*handle, sym);
+	if (ret == NULL) {
+		mcrypt_dlclose(*handle);
+		lt_dlexit();
+	}
+	return ret;
+}
+
+static void mcrypt_module_sym_close(mcrypt_dlhandle handle)
+{
+	mcrypt_dlclose(handle);
+	lt_dlexit();
+}
+
+WIN32DLL_DEFINE int mcrypt_module_self_test(char *algorithm,
+					    char *a_directory)
+{
+	int (*_self_test) (void);
+	mcrypt_dlhandle handle;
+	int x;
+
+	_self_test = mcrypt_module_sym(&handle, a_directory, algorithm,
+				       "_mcrypt_self_test");
+	if (_self_test == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	x = _self_test();
+	mcrypt_module_sym_close(handle);
+	return x;
+}
+
+WIN32DLL_DEFINE int mcrypt_module_algorithm_version(char *algorithm,
+						    char *a_directory)
+{
+	word32 (*_version) (void);
+	mcrypt_dlhandle handle;
+	int x;
+
+	_version = mcrypt_module_sym(&handle, a_directory, algorithm,
+				     "_mcrypt_algorithm_version");
+	if (_version == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	x = _version();
+	mcrypt_module_sym_close(handle);
+	return x;
+}
+
+WIN32DLL_DEFINE int mcrypt_module_mode_version(char *mode,
+					       char *m_directory)
+{
+	word32 (*_version) (void);
+	mcrypt_dlhandle handle;
+	int x;
+
+	_version = mcrypt_module_sym(&handle, m_directory, mode,
+				     "_mcrypt_mode_version");
+	if (_version == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	x = _version();
+	mcrypt_module_sym_close(handle);
+	return x;
+}
+
+WIN32DLL_DEFINE int mcrypt_module_is_block_algorithm(char *algorithm,
+						     char *a_directory)
+{
+	int (*_is_block) (void);
+	mcrypt_dlhandle handle;
+	int x;
+
+	_is_block = mcrypt_module_sym(&handle, a_directory, algorithm,
+				      "_is_block_algorithm");
+	if (_is_block == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	x = _is_block();
+	mcrypt_module_sym_close(handle);
+	return x;
+}
+
+WIN32DLL_DEFINE int mcrypt_module_is_block_algorithm_mode(char *mode,
+							  char *m_directory)
+{
+	int (*_is_a_block_mode) (void);
+	mcrypt_dlhandle handle;
+	int x;
+
+	_is_a_block_mode = mcrypt_module_sym(&handle, m_directory, mode,
+					     "_is_block_algorithm_mode");
+	if (_is_a_block_mode == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	x = _is_a_block_mode();
+	mcrypt_module_sym_close(handle);
+	return x;
+}
+
+WIN32DLL_DEFINE int mcrypt_module_is_block_mode(char *mode,
+						char *m_directory)
+{
+	int (*_is_block_mode) (void);
+	mcrypt_dlhandle handle;
+	int x;
+
+	_is_block_mode = mcrypt_module_sym(&handle, m_directory, mode,
+					   "_is_block_mode");
+	if (_is_block_mode == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	x = _is_block_mode();
+	mcrypt_module_sym_close(handle);
+	return x;
+}
+
+WIN32DLL_DEFINE int mcrypt_module_get_algo_block_size(char *algorithm,
+						      char *a_directory)
+{
+	int (*_get_block_size) (void);
+	mcrypt_dlhandle handle;
+	int x;
+
+	_get_block_size = mcrypt_module_sym(&handle, a_directory, algorithm,
+					    "_mcrypt_get_block_size");
+	if (_get_block_size == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	x = _get_block_size();
+	mcrypt_module_sym_close(handle);
+	return x;
+}
+
+WIN32DLL_DEFINE int mcrypt_module_get_algo_key_size(char *algorithm,
+						    char *a_directory)
+{
+	int (*_get_key_size) (void);
+	mcrypt_dlhandle handle;
+	int x;
+
+	_get_key_size = mcrypt_module_sym(&handle, a_directory, algorithm,
+					  "_mcrypt_get_key_size");
+	if (_get_key_size == NULL)
+		return MCRYPT_UNKNOWN_ERROR;
+	x = _get_key_size();
+	mcrypt_module_sym_close(handle);
+	return x;
+}
+
+WIN32DLL_DEFINE
+    int *mcrypt_module_get_algo_supported_key_sizes(char *algorithm,
+						    char *a_directory,
+						    int *len)
+{
+	const int *(*_get_key_sizes) (int *);
+	mcrypt_dlhandle handle;
+	const int *size;
+	int *ret = NULL;
+
+	*len = 0;
+	_get_key_sizes = mcrypt_module_sym(&handle, a_directory, algorithm,
+					   "_mcrypt_get_supported_key_sizes");
+	if (_get_key_sizes == NULL)
+		return NULL;
+
+	size = _get_key_sizes(len);
+	if (size != NULL && *len > 0) {
+		ret = malloc(sizeof(int) * (*len));
+		if (ret != NULL)
+			memcpy(ret, size, sizeof(int) * (*len));
+		else
+			*len = 0;
+	} else
+		*len = 0;
+
+	mcrypt_module_sym_close(handle);
+	return ret;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 1998,1999,2000,2001,2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MCRYPT_MODULES_H
+#define MCRYPT_MODULES_H
+
+/* Included by the algorithm and mode modules, and by the library. */
+
+#define MCRYPT_UNKNOWN_ERROR -1
+#define MCRYPT_ALGORITHM_MODE_INCOMPATIBILITY -2
+#define MCRYPT_KEY_LEN_ERROR -3
+#define MCRYPT_MEMORY_ALLOCATION_ERROR -4
+#define MCRYPT_UNKNOWN_MODE -5
+#define MCRYPT_UNKNOWN_ALGORITHM -6
+
+/* A loaded module. handle is MCRYPT_INTERNAL_HANDLER for the modules
+ * that are compiled into the library.
+ */
+#define MCRYPT_INTERNAL_HANDLER (void*)-1
+#define MAX_MOD_SIZE 1024
+
+typedef struct {
+	char name[64];
+	void *handle;
+} mcrypt_dlhandle;
+
+void *mcrypt_dlopen(mcrypt_dlhandle *handle, const char *a_directory,
+		    const char *m_directory, const char *filename);
+void *mcrypt_dlsym(mcrypt_dlhandle handle, char *str);
+void mcrypt_dlclose(mcrypt_dlhandle handle);
+
+/* o1 ^= o2, for length bytes */
+void memxor(unsigned char *o1, const unsigned char *o2, int length);
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 1998,1999,2000,2001 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef MCRYPT_PROBES_H
+#define MCRYPT_PROBES_H
+
+/* Static tracepoints of the libmcrypt provider, for bpftrace, perf or
+ * SystemTap. When configure finds <sys/sdt.h> each probe is a nop and
+ * an ELF note until a tracer attaches to it; otherwise the macros
+ * expand to nothing. Include this after libdefs.h, which brings in
+ * config.h.
+ *
+ * Name probes name__start and name__done around the call they time,
+ * with the same leading arguments, so that a tracer can match them up.
+ */
+
+#ifdef HAVE_SYS_SDT_H
+# include <sys/sdt.h>
+# define MCRYPT_PROBE1(name, a) DTRACE_PROBE1(libmcrypt, name, a)
+# define MCRYPT_PROBE2(name, a, b) DTRACE_PROBE2(libmcrypt, name, a, b)
+# define MCRYPT_PROBE3(name, a, b, c) \
+	DTRACE_PROBE3(libmcrypt, name, a, b, c)
+# define MCRYPT_PROBE4(name, a, b, c, d) \
+	DTRACE_PROBE4(libmcrypt, name, a, b, c, d)
+#else
+# define MCRYPT_PROBE1(name, a)
+# define MCRYPT_PROBE2(name, a, b)
+# define MCRYPT_PROBE3(name, a, b, c)
+# define MCRYPT_PROBE4(name, a, b, c, d)
+#endif
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_internal.h>
+
+/* Only the dynamic module loading needs locking; everything else in
+ * the library works on the descriptor it is given.
+ */
+
+static void (*mutex_lock) (void) = NULL;
+static void (*mutex_unlock) (void) = NULL;
+static void (*set_error) (const char *) = NULL;
+
+void _mcrypt_mutex_lock(void)
+{
+	if (mutex_lock != NULL)
+		mutex_lock();
+}
+
+void _mcrypt_mutex_unlock(void)
+{
+	if (mutex_unlock != NULL)
+		mutex_unlock();
+}
+
+void _mcrypt_set_error(const char *error)
+{
+	if (set_error != NULL && error != NULL)
+		set_error(error);
+}
+
+WIN32DLL_DEFINE
+    int mcrypt_mutex_register(void (*_mutex_lock) (void),
+			      void (*_mutex_unlock) (void),
+			      void (*_set_error) (const char *),
+			      const char *(*_get_error) (void))
+{
+	mutex_lock = _mutex_lock;
+	mutex_unlock = _mutex_unlock;
+	set_error = _set_error;
+
+#if defined(USE_LTDL) && defined(DLMUTEX)
+	return lt_dlmutex_register(_mutex_lock, _mutex_unlock, _set_error,
+				   _get_error);
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,233 @@
+/* 
+ * Copyright (C) 1998,1999,2000,2001 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it 
+ * under the terms of the GNU Library General Public License as published 
+ * by the Free Software Foundation; either version 2 of the License, or 
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* ARCFOUR with the first ARCFOUR_DROP bytes of keystream discarded
+ * (RC4-drop[n]), which are the ones most correlated with the key.
+ * Otherwise this is the same as the arcfour module.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_modules.h>
+#include <stdlib.h>
+#include "arcfour.h"
+
+#define _mcrypt_set_key arcfour_drop_LTX__mcrypt_set_key
+#define _mcrypt_encrypt arcfour_drop_LTX__mcrypt_encrypt
+#define _mcrypt_decrypt arcfour_drop_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_streams arcfour_drop_LTX__mcrypt_encrypt_streams
+#define _mcrypt_decrypt_streams arcfour_drop_LTX__mcrypt_decrypt_streams
+#define _mcrypt_get_size arcfour_drop_LTX__mcrypt_get_size
+#define _mcrypt_get_block_size arcfour_drop_LTX__mcrypt_get_block_size
+#define _is_block_algorithm arcfour_drop_LTX__is_block_algorithm
+#define _mcrypt_get_key_size arcfour_drop_LTX__mcrypt_get_key_size
+#define _mcrypt_get_algo_iv_size arcfour_drop_LTX__mcrypt_get_algo_iv_size
+#define _mcrypt_get_supported_key_sizes arcfour_drop_LTX__mcrypt_get_supported_key_sizes
+#define _mcrypt_get_algorithms_name arcfour_drop_LTX__mcrypt_get_algorithms_name
+#define _mcrypt_self_test arcfour_drop_LTX__mcrypt_self_test
+#define _mcrypt_algorithm_version arcfour_drop_LTX__mcrypt_algorithm_version
+
+/* 12 * 256, as recommended by Mironov. Build with -DARCFOUR_DROP=n
+ * for RC4-drop[n]; the self test vector only holds for 3072.
+ */
+#ifndef ARCFOUR_DROP
+#define ARCFOUR_DROP 3072
+#endif
+
+/* Discards n bytes of keystream; this is only the state update,
+ * without the output lookup.
+ */
+static void arcfour_skip(arcfour_key * key, int n)
+{
+	register word32 *s = key->state;
+	register word32 i = key->i, j = key->j, x, y;
+
+	for (; n >= 4; n -= 4) {
+		ARCFOUR_STEP(s, i, j, x, y);
+		ARCFOUR_STEP(s, i, j, x, y);
+		ARCFOUR_STEP(s, i, j, x, y);
+		ARCFOUR_STEP(s, i, j, x, y);
+	}
+	for (; n > 0; n--) {
+		ARCFOUR_STEP(s, i, j, x, y);
+	}
+
+	key->i = i;
+	key->j = j;
+}
+
+WIN32DLL_DEFINE
+    int _mcrypt_set_key(arcfour_key * key, byte * key_data, int key_len,
+			char *IV, int iv_len)
+{
+	register word32 tmp, j, i;
+	word32 *state = key->state;
+
+	for (i = 0; i < 256; i++)
+		state[i] = i;
+
+	for (j = i = 0; i < 256; i++) {
+		j = (j + state[i] + key_data[i % key_len]) & 0xff;
+		tmp = state[i];
+		state[i] = state[j];
+		state[j] = tmp;
+	}
+
+	key->i = 0;
+	key->j = 0;
+	arcfour_skip(key, ARCFOUR_DROP);
+
+	return 0;
+}
+
+WIN32DLL_DEFINE
+    void _mcrypt_encrypt(arcfour_key * key, byte * buffer_ptr,
+			 int buffer_len)
+{
+	arcfour_crypt(key, buffer_ptr, buffer_len);
+}
+
+WIN32DLL_DEFINE
+    void _mcrypt_decrypt(arcfour_key * key, byte * buffer_ptr,
+			 int buffer_len)
+{
+	arcfour_crypt(key, buffer_ptr, buffer_len);
+}
+
+/* see arcfour.c */
+WIN32DLL_DEFINE
+    void _mcrypt_encrypt_streams(arcfour_key ** key, byte ** buffer,
+				 const int *len, int n)
+{
+	arcfour_crypt_streams(key, buffer, len, n);
+}
+
+WIN32DLL_DEFINE
+    void _mcrypt_decrypt_streams(arcfour_key ** key, byte ** buffer,
+				 const int *len, int n)
+{
+	arcfour_crypt_streams(key, buffer, len, n);
+}
+
+WIN32DLL_DEFINE int _mcrypt_get_size()
+{
+	return sizeof(arcfour_key);
+}
+WIN32DLL_DEFINE int _mcrypt_get_block_size()
+{
+	return 1;
+}
+WIN32DLL_DEFINE int _mcrypt_get_algo_iv_size()
+{
+	return 0;
+}
+WIN32DLL_DEFINE int _is_block_algorithm()
+{
+	return 0;
+}
+WIN32DLL_DEFINE int _mcrypt_get_key_size()
+{
+	return 256;
+}
+WIN32DLL_DEFINE const int *_mcrypt_get_supported_key_sizes(int *len)
+{
+	*len = 0;
+	return NULL;
+}
+WIN32DLL_DEFINE const char *_mcrypt_get_algorithms_name()
+{
+return "RC4-drop";
+}
+
+#define CIPHER "ac406bb1d1f1c163a22dadab1a82ca0dad242cc3"
+
+WIN32DLL_DEFINE int _mcrypt_self_test()
+{
+	char *keyword;
+	unsigned char plaintext[20];
+	unsigned char ciphertext[20];
+	int blocksize = 20, j;
+	void *key;
+	unsigned char cipher_tmp[200];
+
+	keyword = calloc(1, _mcrypt_get_key_size());
+	if (keyword == NULL)
+		return -1;
+
+	for (j = 0; j < _mcrypt_get_key_size(); j++) {
+		keyword[j] = ((j * 2 + 10) % 256);
+	}
+
+	for (j = 0; j < blocksize; j++) {
+		plaintext[j] = j % 256;
+	}
+	key = malloc(_mcrypt_get_size());
+	if (key == NULL) {
+		free(keyword);
+		return -1;
+	}
+
+	memcpy(ciphertext, plaintext, blocksize);
+
+	_mcrypt_set_key(key, (void *) keyword, _mcrypt_get_key_size(),
+			NULL, 0);
+	_mcrypt_encrypt(key, (void *) ciphertext, blocksize);
+
+	for (j = 0; j < blocksize; j++) {
+		sprintf(&((char *) cipher_tmp)[2 * j], "%.2x",
+			ciphertext[j]);
+	}
+
+#if ARCFOUR_DROP == 3072
+	if (strcmp((char *) cipher_tmp, CIPHER) != 0) {
+		printf("failed compatibility\n");
+		printf("Expected: %s\nGot: %s\n", CIPHER,
+		       (char *) cipher_tmp);
+		free(keyword);
+		free(key);
+		return -1;
+	}
+#endif
+
+	_mcrypt_set_key(key, (void *) keyword, _mcrypt_get_key_size(),
+			NULL, 0);
+	_mcrypt_decrypt(key, (void *) ciphertext, blocksize);
+
+	free(keyword);
+	free(key);
+	if (memcmp(ciphertext, plaintext, blocksize) != 0) {
+		printf("failed internally\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+WIN32DLL_DEFINE word32 _mcrypt_algorithm_version()
+{
+	return 20261018;
+}
+
+#ifdef WIN32
+# ifdef USE_LTDL
+WIN32DLL_DEFINE int main (void)
+{
+       /* empty main function to avoid linker error (see cygwin FAQ) */
+}
+# endif
+#endif
@@ -25,6 +25,8 @@
 #define _mcrypt_set_key arcfour_LTX__mcrypt_set_key
 #define _mcrypt_encrypt arcfour_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt arcfour_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_streams arcfour_LTX__mcrypt_encrypt_streams
+#define _mcrypt_decrypt_streams arcfour_LTX__mcrypt_decrypt_streams
 #define _mcrypt_get_size arcfour_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size arcfour_LTX__mcrypt_get_block_size
 #define _is_block_algorithm arcfour_LTX__is_block_algorithm
@@ -50,8 +52,8 @@ WIN32DLL_DEFINE
     int _mcrypt_set_key(arcfour_key * key, byte * key_data, int key_len,
 			char *IV, int iv_len)
 {
-	register int tmp, j, i;
-	byte *state = STATE;
+	register word32 tmp, j, i;
+	word32 *state = STATE;
 	int ivindex;
 
 	for (i = 0; i < 256; i++)
@@ -82,24 +84,7 @@ WIN32DLL_DEFINE
     void _mcrypt_encrypt(arcfour_key * key, byte * buffer_ptr,
 			 int buffer_len)
 {
-	register int tmp;
-	register int counter;
-	register int i = I, j = J;
-	byte *state = STATE;
-
-
-	for (counter = 0; counter < buffer_len; counter++) {
-		i++;
-		i &= 0xff;
-		j += state[i];
-		j &= 0xff;
-
-		/* swap state[i] and state[j] */
-		swap_byte(state[i], state[j]);
-		buffer_ptr[counter] ^= state[(state[i] + tmp) & 0xff];
-	}
-	J = j;
-	I = i;
+	arcfour_crypt(key, buffer_ptr, buffer_len);
 }
 
 /* this is the same with mcrypt_encrypt */
@@ -110,6 +95,24 @@ WIN32DLL_DEFINE
 	_mcrypt_encrypt(key, buffer_ptr, buffer_len);
 }
 
+/* Encrypts (or decrypts) the n independent streams buffer[k], of
+ * length len[k], with key[k]. The streams are interleaved, which is
+ * much faster than one call per stream when there are several.
+ */
+WIN32DLL_DEFINE
+    void _mcrypt_encrypt_streams(arcfour_key ** key, byte ** buffer,
+				 const int *len, int n)
+{
+	arcfour_crypt_streams(key, buffer, len, n);
+}
+
+WIN32DLL_DEFINE
+    void _mcrypt_decrypt_streams(arcfour_key ** key, byte ** buffer,
+				 const int *len, int n)
+{
+	arcfour_crypt_streams(key, buffer, len, n);
+}
+
 WIN32DLL_DEFINE int _mcrypt_get_size()
 {
 	return sizeof(arcfour_key);
@@ -145,6 +148,7 @@ return "RC4";
 }
 
 #define CIPHER "3abaa03a286e24c4196d292ab72934d6854c3eee"
+#define TEST_STREAMS 6
 
 WIN32DLL_DEFINE int _mcrypt_self_test()
 {
@@ -154,6 +158,13 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	int blocksize = 20, j;
 	void *key;
 	unsigned char cipher_tmp[200];
+	arcfour_key skey[TEST_STREAMS], *keys[TEST_STREAMS];
+	byte streams[TEST_STREAMS][200], *sbuf[TEST_STREAMS];
+	int slen[TEST_STREAMS];
+
+	for (j = 0; j < TEST_STREAMS; j++) {
+		keys[j] = &skey[j];
+	}
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -194,13 +205,40 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 			NULL, 0);
 	_mcrypt_decrypt(key, (void *) ciphertext, blocksize);
 
-	free(keyword);
-	free(key);
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(keyword);
+		free(key);
 		return -1;
 	}
 
+	/* the interleaved streams must agree with separate calls */
+	for (j = 0; j < TEST_STREAMS; j++) {
+		keyword[0] = j;
+		_mcrypt_set_key(&skey[j], (void *) keyword,
+				_mcrypt_get_key_size(), NULL, 0);
+		slen[j] = 100 + 7 * j;
+		sbuf[j] = &streams[j][0];
+		memset(streams[j], j, sizeof(streams[j]));
+	}
+	_mcrypt_encrypt_streams(keys, sbuf, slen, TEST_STREAMS);
+	for (j = 0; j < TEST_STREAMS; j++) {
+		keyword[0] = j;
+		_mcrypt_set_key(key, (void *) keyword,
+				_mcrypt_get_key_size(), NULL, 0);
+		memset(cipher_tmp, j, slen[j]);
+		_mcrypt_encrypt(key, cipher_tmp, slen[j]);
+		if (memcmp(cipher_tmp, streams[j], slen[j]) != 0) {
+			printf("failed multi-stream encryption\n");
+			free(keyword);
+			free(key);
+			return -1;
+		}
+	}
+
+	free(keyword);
+	free(key);
+
 	return 0;
 }
 
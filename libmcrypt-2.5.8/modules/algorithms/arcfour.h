@@ -1,7 +1,129 @@
+/* The state is kept in words rather than bytes: the table lookups
+ * then need no zero extension and the stores no partial writes,
+ * which is what limits the byte loop on most processors.
+ */
 typedef struct arcfour_key
-{      
-   byte state[256];       
-   byte i;        
-   byte j;
+{
+   word32 state[256];
+   word32 i;
+   word32 j;
 } arcfour_key;
 
+/* The generator, shared by arcfour.c and arcfour-drop.c. */
+
+#define ARCFOUR_STEP(s, i, j, x, y) \
+	i = (i + 1) & 0xff; \
+	x = s[i]; \
+	j = (j + x) & 0xff; \
+	y = s[j]; \
+	s[i] = y; \
+	s[j] = x
+
+/* XORs the next keystream byte into b */
+#define ARCFOUR_BYTE(s, i, j, x, y, b) \
+	ARCFOUR_STEP(s, i, j, x, y); \
+	(b) ^= (byte) s[(x + y) & 0xff]
+
+static void arcfour_crypt(arcfour_key * key, byte * buf, int len)
+{
+	register word32 *s = key->state;
+	register word32 i = key->i, j = key->j, x, y;
+
+	for (; len >= 4; len -= 4, buf += 4) {
+		ARCFOUR_BYTE(s, i, j, x, y, buf[0]);
+		ARCFOUR_BYTE(s, i, j, x, y, buf[1]);
+		ARCFOUR_BYTE(s, i, j, x, y, buf[2]);
+		ARCFOUR_BYTE(s, i, j, x, y, buf[3]);
+	}
+	for (; len > 0; len--, buf++) {
+		ARCFOUR_BYTE(s, i, j, x, y, buf[0]);
+	}
+
+	key->i = i;
+	key->j = j;
+}
+
+/* Runs four independent streams side by side for len bytes. Each
+ * stream is a chain of dependent loads, so interleaving them keeps
+ * the processor busy where a single stream cannot.
+ */
+#ifdef WORDS_BIGENDIAN
+# define ARCFOUR_SHIFT(q) (24 - 8 * (q))
+#else
+# define ARCFOUR_SHIFT(q) (8 * (q))
+#endif
+
+/* The next keystream byte, put in place q of the word w */
+#define ARCFOUR_WORD(s, i, j, x, y, w, q) \
+	ARCFOUR_STEP(s, i, j, x, y); \
+	w |= s[(x + y) & 0xff] << ARCFOUR_SHIFT(q)
+
+#define ARCFOUR_XOR(b, w) \
+	memcpy(&t, b, 4); \
+	t ^= w; \
+	memcpy(b, &t, 4)
+
+static void arcfour_crypt4(arcfour_key ** key, byte ** buf, int len)
+{
+	word32 *s0 = key[0]->state, *s1 = key[1]->state;
+	word32 *s2 = key[2]->state, *s3 = key[3]->state;
+	word32 i0 = key[0]->i, j0 = key[0]->j, x0, y0, w0;
+	word32 i1 = key[1]->i, j1 = key[1]->j, x1, y1, w1;
+	word32 i2 = key[2]->i, j2 = key[2]->j, x2, y2, w2;
+	word32 i3 = key[3]->i, j3 = key[3]->j, x3, y3, w3;
+	byte *b0 = buf[0], *b1 = buf[1], *b2 = buf[2], *b3 = buf[3];
+	word32 t;
+	int k, q;
+
+	/* the keystream is collected a word at a time, so that the
+	 * stores to the buffers do not get in the way of the ones to
+	 * the states
+	 */
+	for (k = 0; k + 4 <= len; k += 4) {
+		w0 = w1 = w2 = w3 = 0;
+		for (q = 0; q < 4; q++) {
+			ARCFOUR_WORD(s0, i0, j0, x0, y0, w0, q);
+			ARCFOUR_WORD(s1, i1, j1, x1, y1, w1, q);
+			ARCFOUR_WORD(s2, i2, j2, x2, y2, w2, q);
+			ARCFOUR_WORD(s3, i3, j3, x3, y3, w3, q);
+		}
+		ARCFOUR_XOR(&b0[k], w0);
+		ARCFOUR_XOR(&b1[k], w1);
+		ARCFOUR_XOR(&b2[k], w2);
+		ARCFOUR_XOR(&b3[k], w3);
+	}
+	for (; k < len; k++) {
+		ARCFOUR_BYTE(s0, i0, j0, x0, y0, b0[k]);
+		ARCFOUR_BYTE(s1, i1, j1, x1, y1, b1[k]);
+		ARCFOUR_BYTE(s2, i2, j2, x2, y2, b2[k]);
+		ARCFOUR_BYTE(s3, i3, j3, x3, y3, b3[k]);
+	}
+
+	key[0]->i = i0; key[0]->j = j0;
+	key[1]->i = i1; key[1]->j = j1;
+	key[2]->i = i2; key[2]->j = j2;
+	key[3]->i = i3; key[3]->j = j3;
+}
+
+/* Encrypts (or decrypts) buf[k] of length len[k] with key[k], for n
+ * streams. The keys must all be different.
+ */
+static void arcfour_crypt_streams(arcfour_key ** key, byte ** buf,
+				  const int *len, int n)
+{
+	int k, m;
+
+	for (; n >= 4; n -= 4, key += 4, buf += 4, len += 4) {
+		m = len[0];
+		for (k = 1; k < 4; k++)
+			if (len[k] < m)
+				m = len[k];
+
+		arcfour_crypt4(key, buf, m);
+
+		for (k = 0; k < 4; k++)
+			arcfour_crypt(key[k], buf[k] + m, len[k] - m);
+	}
+	for (k = 0; k < n; k++)
+		arcfour_crypt(key[k], buf[k], len[k]);
+}
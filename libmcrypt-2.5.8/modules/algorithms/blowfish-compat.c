@@ -17,6 +17,11 @@
 #define _mcrypt_set_key blowfish_compat_LTX__mcrypt_set_key
 #define _mcrypt_encrypt blowfish_compat_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt blowfish_compat_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks blowfish_compat_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks blowfish_compat_LTX__mcrypt_decrypt_blocks
+#define _mcrypt_get_schedule_size blowfish_compat_LTX__mcrypt_get_schedule_size
+#define _mcrypt_save_schedule blowfish_compat_LTX__mcrypt_save_schedule
+#define _mcrypt_load_schedule blowfish_compat_LTX__mcrypt_load_schedule
 #define _mcrypt_get_size blowfish_compat_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size blowfish_compat_LTX__mcrypt_get_block_size
 #define _is_block_algorithm blowfish_compat_LTX__is_block_algorithm
@@ -37,6 +42,13 @@ typedef struct {
 #define BF_N         16
 #define KEYBYTES   8
 
+/* The blocks are stored in little endian order */
+#ifndef WORDS_BIGENDIAN
+# define SWAP(x) (x)
+#else
+# define SWAP(x) byteswap32(x)
+#endif
+
 #define F(bc, x) ( ((bc->S[0][(x >> 24) & 0xff] + bc->S[1][(x >> 16) & 0xff]) ^ bc->S[2][(x >>  8) & 0xff]) + bc->S[3][x & 0xff] )
 
 /* x should be a 64 bit integer */
@@ -154,7 +166,7 @@ static short initialize_blowfish(blf_ctx * c, byte key[], short keybytes)
 	short i, j;
 	word32 data, datarl[2];
 
-	word32 ks0[] = {
+	static const word32 ks0[] = {
 		0xd1310ba6L, 0x98dfb5acL, 0x2ffd72dbL, 0xd01adfb7L,
 		0xb8e1afedL, 0x6a267e96L,
 		0xba7c9045L, 0xf12c7f99L, 0x24a19947L, 0xb3916cf7L,
@@ -242,7 +254,7 @@ static short initialize_blowfish(blf_ctx * c, byte key[], short keybytes)
 		0x53b02d5dL, 0xa99f8fa1L, 0x08ba4799L, 0x6e85076aL
 	};
 
-	word32 ks1[] = {
+	static const word32 ks1[] = {
 		0x4b7a70e9L, 0xb5b32944L, 0xdb75092eL, 0xc4192623L,
 		0xad6ea6b0L, 0x49a7df7dL,
 		0x9cee60b8L, 0x8fedb266L, 0xecaa8c71L, 0x699a17ffL,
@@ -330,7 +342,7 @@ static short initialize_blowfish(blf_ctx * c, byte key[], short keybytes)
 		0x153e21e7L, 0x8fb03d4aL, 0xe6e39f2bL, 0xdb83adf7L
 	};
 
-	word32 ks2[] = {
+	static const word32 ks2[] = {
 		0xe93d5a68L, 0x948140f7L, 0xf64c261cL, 0x94692934L,
 		0x411520f7L, 0x7602d4f7L,
 		0xbcf46b2eL, 0xd4a20068L, 0xd4082471L, 0x3320f46aL,
@@ -418,7 +430,7 @@ static short initialize_blowfish(blf_ctx * c, byte key[], short keybytes)
 		0xd79a3234L, 0x92638212L, 0x670efa8eL, 0x406000e0L
 	};
 
-	word32 ks3[] = {
+	static const word32 ks3[] = {
 		0x3a39ce37L, 0xd3faf5cfL, 0xabc27737L, 0x5ac52d1bL,
 		0x5cb0679eL, 0x4fa33742L,
 		0xd3822740L, 0x99bc9bbeL, 0xd5118e9dL, 0xbf0f7315L,
@@ -507,7 +519,7 @@ static short initialize_blowfish(blf_ctx * c, byte key[], short keybytes)
 	};
 
 
-	word32 pi[] = {
+	static const word32 pi[] = {
 		0x243f6a88L, 0x85a308d3L, 0x13198a2eL, 0x03707344L,
 		0xa4093822L, 0x299f31d0L,
 		0x082efa98L, 0xec4e6c89L, 0x452821e6L, 0x38d01377L,
@@ -570,6 +582,77 @@ WIN32DLL_DEFINE int _mcrypt_set_key(blf_ctx * c, char *k, int len)
 	return 0;
 }
 
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the
+ * two may be the same buffer but must not otherwise overlap
+ */
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(blf_ctx * c, const word32 * in,
+					    word32 * out, int nblocks)
+{
+	word32 l[4], r[4];
+	int i;
+
+	for (; nblocks >= 4; nblocks -= 4, in += 8, out += 8) {
+		for (i = 0; i < 4; i++) {
+			l[i] = SWAP(in[2 * i]);
+			r[i] = SWAP(in[2 * i + 1]);
+		}
+		blf_encrypt4(c, l, r);
+		for (i = 0; i < 4; i++) {
+			out[2 * i] = SWAP(l[i]);
+			out[2 * i + 1] = SWAP(r[i]);
+		}
+	}
+	for (; nblocks > 0; nblocks--, in += 2, out += 2) {
+		out[0] = in[0];
+		out[1] = in[1];
+		_mcrypt_encrypt(c, out);
+	}
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(blf_ctx * c, const word32 * in,
+					    word32 * out, int nblocks)
+{
+	word32 l[4], r[4];
+	int i;
+
+	for (; nblocks >= 4; nblocks -= 4, in += 8, out += 8) {
+		for (i = 0; i < 4; i++) {
+			l[i] = SWAP(in[2 * i]);
+			r[i] = SWAP(in[2 * i + 1]);
+		}
+		blf_decrypt4(c, l, r);
+		for (i = 0; i < 4; i++) {
+			out[2 * i] = SWAP(l[i]);
+			out[2 * i + 1] = SWAP(r[i]);
+		}
+	}
+	for (; nblocks > 0; nblocks--, in += 2, out += 2) {
+		out[0] = in[0];
+		out[1] = in[1];
+		_mcrypt_decrypt(c, out);
+	}
+}
+
+/* Save the schedule set up by _mcrypt_set_key() in a portable form,
+ * or set a key from such a saved schedule.
+ */
+WIN32DLL_DEFINE int _mcrypt_get_schedule_size()
+{
+	return BLF_SCHEDULE_SIZE;
+}
+
+WIN32DLL_DEFINE int _mcrypt_save_schedule(blf_ctx * c, byte * out)
+{
+	blf_save_schedule(c, out);
+	return 0;
+}
+
+WIN32DLL_DEFINE int _mcrypt_load_schedule(blf_ctx * c, const byte * in)
+{
+	blf_load_schedule(c, in);
+	return 0;
+}
+
 WIN32DLL_DEFINE int _mcrypt_get_size()
 {
 	return sizeof(blf_ctx);
@@ -604,8 +687,10 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	unsigned char plaintext[16];
 	unsigned char ciphertext[16];
 	int blocksize = _mcrypt_get_block_size(), j;
-	void *key;
+	void *key, *key2;
 	unsigned char cipher_tmp[200];
+	word32 blocks[13 * 2];
+	byte *schedule;
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -641,10 +726,55 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* a saved and loaded schedule must give the same key */
+	schedule = malloc(_mcrypt_get_schedule_size());
+	key2 = malloc(_mcrypt_get_size());
+	if (schedule == NULL || key2 == NULL) {
+		free(schedule);
+		free(key2);
+		free(key);
+		return -1;
+	}
+	_mcrypt_save_schedule(key, schedule);
+	_mcrypt_load_schedule(key2, schedule);
+	j = memcmp(key, key2, _mcrypt_get_size());
+	free(schedule);
+	free(key2);
+	if (j != 0) {
+		printf("failed schedule\n");
+		free(key);
+		return -1;
+	}
+
+	/* the interleaved code must agree with the one above */
+	for (j = 0; j < 13 * 8; j++) {
+		((unsigned char *) blocks)[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 13 * 8);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 13 * 8) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 13 * 8) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
@@ -17,6 +17,11 @@
 #define _mcrypt_set_key blowfish_LTX__mcrypt_set_key
 #define _mcrypt_encrypt blowfish_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt blowfish_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks blowfish_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks blowfish_LTX__mcrypt_decrypt_blocks
+#define _mcrypt_get_schedule_size blowfish_LTX__mcrypt_get_schedule_size
+#define _mcrypt_save_schedule blowfish_LTX__mcrypt_save_schedule
+#define _mcrypt_load_schedule blowfish_LTX__mcrypt_load_schedule
 #define _mcrypt_get_size blowfish_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size blowfish_LTX__mcrypt_get_block_size
 #define _is_block_algorithm blowfish_LTX__is_block_algorithm
@@ -30,6 +35,13 @@
 #define BF_N         16
 #define KEYBYTES   8
 
+/* The blocks are stored in big endian order */
+#ifdef WORDS_BIGENDIAN
+# define SWAP(x) (x)
+#else
+# define SWAP(x) byteswap32(x)
+#endif
+
 #define F(bc, x) ( ((bc->S[0][(x >> 24) & 0xff] + bc->S[1][(x >> 16) & 0xff]) ^ bc->S[2][(x >>  8) & 0xff]) + bc->S[3][x & 0xff] )
 
 /* x should be a 64 bit integer */
@@ -478,6 +490,77 @@ WIN32DLL_DEFINE int _mcrypt_set_key(blf_ctx * c, char *k, int len)
 	return 0;
 }
 
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the
+ * two may be the same buffer but must not otherwise overlap
+ */
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(blf_ctx * c, const word32 * in,
+					    word32 * out, int nblocks)
+{
+	word32 l[4], r[4];
+	int i;
+
+	for (; nblocks >= 4; nblocks -= 4, in += 8, out += 8) {
+		for (i = 0; i < 4; i++) {
+			l[i] = SWAP(in[2 * i]);
+			r[i] = SWAP(in[2 * i + 1]);
+		}
+		blf_encrypt4(c, l, r);
+		for (i = 0; i < 4; i++) {
+			out[2 * i] = SWAP(l[i]);
+			out[2 * i + 1] = SWAP(r[i]);
+		}
+	}
+	for (; nblocks > 0; nblocks--, in += 2, out += 2) {
+		out[0] = in[0];
+		out[1] = in[1];
+		_mcrypt_encrypt(c, out);
+	}
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(blf_ctx * c, const word32 * in,
+					    word32 * out, int nblocks)
+{
+	word32 l[4], r[4];
+	int i;
+
+	for (; nblocks >= 4; nblocks -= 4, in += 8, out += 8) {
+		for (i = 0; i < 4; i++) {
+			l[i] = SWAP(in[2 * i]);
+			r[i] = SWAP(in[2 * i + 1]);
+		}
+		blf_decrypt4(c, l, r);
+		for (i = 0; i < 4; i++) {
+			out[2 * i] = SWAP(l[i]);
+			out[2 * i + 1] = SWAP(r[i]);
+		}
+	}
+	for (; nblocks > 0; nblocks--, in += 2, out += 2) {
+		out[0] = in[0];
+		out[1] = in[1];
+		_mcrypt_decrypt(c, out);
+	}
+}
+
+/* Save the schedule set up by _mcrypt_set_key() in a portable form,
+ * or set a key from such a saved schedule.
+ */
+WIN32DLL_DEFINE int _mcrypt_get_schedule_size()
+{
+	return BLF_SCHEDULE_SIZE;
+}
+
+WIN32DLL_DEFINE int _mcrypt_save_schedule(blf_ctx * c, byte * out)
+{
+	blf_save_schedule(c, out);
+	return 0;
+}
+
+WIN32DLL_DEFINE int _mcrypt_load_schedule(blf_ctx * c, const byte * in)
+{
+	blf_load_schedule(c, in);
+	return 0;
+}
+
 WIN32DLL_DEFINE int _mcrypt_get_size()
 {
 	return sizeof(blf_ctx);
@@ -512,8 +595,10 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	unsigned char plaintext[16];
 	unsigned char ciphertext[16];
 	int blocksize = _mcrypt_get_block_size(), j;
-	void *key;
+	void *key, *key2;
 	unsigned char cipher_tmp[200];
+	word32 blocks[13 * 2];
+	byte *schedule;
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -550,10 +635,55 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* a saved and loaded schedule must give the same key */
+	schedule = malloc(_mcrypt_get_schedule_size());
+	key2 = malloc(_mcrypt_get_size());
+	if (schedule == NULL || key2 == NULL) {
+		free(schedule);
+		free(key2);
+		free(key);
+		return -1;
+	}
+	_mcrypt_save_schedule(key, schedule);
+	_mcrypt_load_schedule(key2, schedule);
+	j = memcmp(key, key2, _mcrypt_get_size());
+	free(schedule);
+	free(key2);
+	if (j != 0) {
+		printf("failed schedule\n");
+		free(key);
+		return -1;
+	}
+
+	/* the interleaved code must agree with the one above */
+	for (j = 0; j < 13 * 8; j++) {
+		((unsigned char *) blocks)[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 13 * 8);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 13 * 8) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 13 * 8) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
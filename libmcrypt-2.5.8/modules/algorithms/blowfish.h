@@ -3,3 +3,97 @@ typedef struct {
     word32 S[4][256],P[18];
 } blf_ctx;
 
+/* The code below is shared by blowfish.c and blowfish-compat.c, which
+ * differ only in the byte order of the blocks.
+ */
+
+#define BLF_F(c, x) ( ((c->S[0][(x) >> 24] + c->S[1][((x) >> 16) & 0xff]) ^ c->S[2][((x) >> 8) & 0xff]) + c->S[3][(x) & 0xff] )
+
+/* Half a round of four blocks at once: the lookups of one block
+ * depend on each other, so the processor gets to overlap those of
+ * the others.
+ */
+#define BLF_ROUND4(c, a, b, n) \
+	a##0 ^= c->P[n]; a##1 ^= c->P[n]; \
+	a##2 ^= c->P[n]; a##3 ^= c->P[n]; \
+	b##0 ^= BLF_F(c, a##0); b##1 ^= BLF_F(c, a##1); \
+	b##2 ^= BLF_F(c, a##2); b##3 ^= BLF_F(c, a##3)
+
+#define BLF_XOR4(a, k) \
+	a##0 ^= k; a##1 ^= k; a##2 ^= k; a##3 ^= k
+
+/* l[i] and r[i] are the two halves of block i, in host order */
+static void blf_encrypt4(const blf_ctx * c, word32 * l, word32 * r)
+{
+	word32 a0 = l[0], a1 = l[1], a2 = l[2], a3 = l[3];
+	word32 b0 = r[0], b1 = r[1], b2 = r[2], b3 = r[3];
+	int i;
+
+	for (i = 0; i < 16; i += 2) {
+		BLF_ROUND4(c, a, b, i);
+		BLF_ROUND4(c, b, a, i + 1);
+	}
+	BLF_XOR4(a, c->P[16]);
+	BLF_XOR4(b, c->P[17]);
+
+	l[0] = b0; l[1] = b1; l[2] = b2; l[3] = b3;
+	r[0] = a0; r[1] = a1; r[2] = a2; r[3] = a3;
+}
+
+static void blf_decrypt4(const blf_ctx * c, word32 * l, word32 * r)
+{
+	word32 a0 = l[0], a1 = l[1], a2 = l[2], a3 = l[3];
+	word32 b0 = r[0], b1 = r[1], b2 = r[2], b3 = r[3];
+	int i;
+
+	for (i = 17; i > 1; i -= 2) {
+		BLF_ROUND4(c, a, b, i);
+		BLF_ROUND4(c, b, a, i - 1);
+	}
+	BLF_XOR4(a, c->P[1]);
+	BLF_XOR4(b, c->P[0]);
+
+	l[0] = b0; l[1] = b1; l[2] = b2; l[3] = b3;
+	r[0] = a0; r[1] = a1; r[2] = a2; r[3] = a3;
+}
+
+/* A key schedule saved as bytes: P and then the four S boxes, each
+ * word in big endian order, so that it may be stored and loaded on a
+ * different host. Setting up a key costs as much as encrypting 4 KB,
+ * which is worth avoiding when the same key is used again and again.
+ */
+#define BLF_SCHEDULE_SIZE ((18 + 4 * 256) * 4)
+
+static void blf_put_word(byte * p, word32 x)
+{
+	p[0] = x >> 24;
+	p[1] = x >> 16;
+	p[2] = x >> 8;
+	p[3] = x;
+}
+
+static word32 blf_get_word(const byte * p)
+{
+	return ((word32) p[0] << 24) | ((word32) p[1] << 16) |
+	    ((word32) p[2] << 8) | p[3];
+}
+
+static void blf_save_schedule(const blf_ctx * c, byte * out)
+{
+	int i;
+
+	for (i = 0; i < 18; i++, out += 4)
+		blf_put_word(out, c->P[i]);
+	for (i = 0; i < 4 * 256; i++, out += 4)
+		blf_put_word(out, c->S[i >> 8][i & 255]);
+}
+
+static void blf_load_schedule(blf_ctx * c, const byte * in)
+{
+	int i;
+
+	for (i = 0; i < 18; i++, in += 4)
+		c->P[i] = blf_get_word(in);
+	for (i = 0; i < 4 * 256; i++, in += 4)
+		c->S[i >> 8][i & 255] = blf_get_word(in);
+}
@@ -23,6 +23,8 @@
 #define _mcrypt_set_key cast_128_LTX__mcrypt_set_key
 #define _mcrypt_encrypt cast_128_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt cast_128_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks cast_128_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks cast_128_LTX__mcrypt_decrypt_blocks
 #define _mcrypt_get_size cast_128_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size cast_128_LTX__mcrypt_get_block_size
 #define _is_block_algorithm cast_128_LTX__is_block_algorithm
@@ -61,95 +63,213 @@
 	 ^ cast_sbox3[U8c(t)]) - cast_sbox4[U8d(t)];
 
 
+/* Get a big endian word out of a block, and put one back */
+#define GET32(p) ( ((u32) (p)[0] << 24) | ((u32) (p)[1] << 16) \
+	| ((u32) (p)[2] << 8) | (u32) (p)[3] )
+#define PUT32(p, x) \
+	(p)[0] = U8a(x); (p)[1] = U8b(x); (p)[2] = U8c(x); (p)[3] = U8d(x)
+
+/* A round on one block, or on four at once. The S box lookups of a
+ * block all depend on each other, so the processor can only overlap
+ * those of different blocks.
+ */
+#define ONE(F, l, r, i) F(l, r, i)
+#define FOUR(F, l, r, i) \
+	F(l[0], r[0], i) F(l[1], r[1], i) F(l[2], r[2], i) F(l[3], r[3], i)
+
+/* The first 12 rounds, and the 4 that are only done if the key
+ * length is > 80 bits. The choice is made once per call, so that
+ * the rounds themselves have no branches.
+ */
+#define ENCRYPT12(R, l, r) \
+	R(F1, l, r, 0); R(F2, r, l, 1); R(F3, l, r, 2); \
+	R(F1, r, l, 3); R(F2, l, r, 4); R(F3, r, l, 5); \
+	R(F1, l, r, 6); R(F2, r, l, 7); R(F3, l, r, 8); \
+	R(F1, r, l, 9); R(F2, l, r, 10); R(F3, r, l, 11)
+#define ENCRYPT_LAST4(R, l, r) \
+	R(F1, l, r, 12); R(F2, r, l, 13); R(F3, l, r, 14); R(F1, r, l, 15)
+
+#define DECRYPT_FIRST4(R, l, r) \
+	R(F1, r, l, 15); R(F3, l, r, 14); R(F2, r, l, 13); R(F1, l, r, 12)
+#define DECRYPT12(R, l, r) \
+	R(F3, r, l, 11); R(F2, l, r, 10); R(F1, r, l, 9); \
+	R(F3, l, r, 8); R(F2, r, l, 7); R(F1, l, r, 6); \
+	R(F3, r, l, 5); R(F2, l, r, 4); R(F1, r, l, 3); \
+	R(F3, l, r, 2); R(F2, r, l, 1); R(F1, l, r, 0)
+
+
 /***** Encryption Function *****/
 
-WIN32DLL_DEFINE void _mcrypt_encrypt(CAST_KEY * key, u8 * block)
+static void cast_encrypt12(CAST_KEY * key, u8 * block)
 {
 	u32 t, l, r;
 
 	/* Get inblock into l,r */
-	l = ((u32) block[0] << 24) | ((u32) block[1] << 16)
-	    | ((u32) block[2] << 8) | (u32) block[3];
-	r = ((u32) block[4] << 24) | ((u32) block[5] << 16)
-	    | ((u32) block[6] << 8) | (u32) block[7];
+	l = GET32(block);
+	r = GET32(block + 4);
 	/* Do the work */
-	F1(l, r, 0);
-	F2(r, l, 1);
-	F3(l, r, 2);
-	F1(r, l, 3);
-	F2(l, r, 4);
-	F3(r, l, 5);
-	F1(l, r, 6);
-	F2(r, l, 7);
-	F3(l, r, 8);
-	F1(r, l, 9);
-	F2(l, r, 10);
-	F3(r, l, 11);
-	/* Only do full 16 rounds if key length > 80 bits */
-	if (key->rounds > 12) {
-		F1(l, r, 12);
-		F2(r, l, 13);
-		F3(l, r, 14);
-		F1(r, l, 15);
-	}
+	ENCRYPT12(ONE, l, r);
 	/* Put l,r into outblock */
-	block[0] = U8a(r);
-	block[1] = U8b(r);
-	block[2] = U8c(r);
-	block[3] = U8d(r);
-	block[4] = U8a(l);
-	block[5] = U8b(l);
-	block[6] = U8c(l);
-	block[7] = U8d(l);
+	PUT32(block, r);
+	PUT32(block + 4, l);
 	/* Wipe clean */
 	t = l = r = 0;
 }
 
+static void cast_encrypt16(CAST_KEY * key, u8 * block)
+{
+	u32 t, l, r;
+
+	l = GET32(block);
+	r = GET32(block + 4);
+	ENCRYPT12(ONE, l, r);
+	ENCRYPT_LAST4(ONE, l, r);
+	PUT32(block, r);
+	PUT32(block + 4, l);
+	t = l = r = 0;
+}
+
+WIN32DLL_DEFINE void _mcrypt_encrypt(CAST_KEY * key, u8 * block)
+{
+	if (key->rounds > 12)
+		cast_encrypt16(key, block);
+	else
+		cast_encrypt12(key, block);
+}
+
 
 /***** Decryption Function *****/
 
-WIN32DLL_DEFINE void _mcrypt_decrypt(CAST_KEY * key, u8 * block)
+static void cast_decrypt12(CAST_KEY * key, u8 * block)
 {
 	u32 t, l, r;
 
 	/* Get inblock into l,r */
-	r = ((u32) block[0] << 24) | ((u32) block[1] << 16)
-	    | ((u32) block[2] << 8) | (u32) block[3];
-	l = ((u32) block[4] << 24) | ((u32) block[5] << 16)
-	    | ((u32) block[6] << 8) | (u32) block[7];
+	r = GET32(block);
+	l = GET32(block + 4);
 	/* Do the work */
-	/* Only do full 16 rounds if key length > 80 bits */
-	if (key->rounds > 12) {
-		F1(r, l, 15);
-		F3(l, r, 14);
-		F2(r, l, 13);
-		F1(l, r, 12);
-	}
-	F3(r, l, 11);
-	F2(l, r, 10);
-	F1(r, l, 9);
-	F3(l, r, 8);
-	F2(r, l, 7);
-	F1(l, r, 6);
-	F3(r, l, 5);
-	F2(l, r, 4);
-	F1(r, l, 3);
-	F3(l, r, 2);
-	F2(r, l, 1);
-	F1(l, r, 0);
+	DECRYPT12(ONE, l, r);
 	/* Put l,r into outblock */
-	block[0] = U8a(l);
-	block[1] = U8b(l);
-	block[2] = U8c(l);
-	block[3] = U8d(l);
-	block[4] = U8a(r);
-	block[5] = U8b(r);
-	block[6] = U8c(r);
-	block[7] = U8d(r);
+	PUT32(block, l);
+	PUT32(block + 4, r);
 	/* Wipe clean */
 	t = l = r = 0;
 }
 
+static void cast_decrypt16(CAST_KEY * key, u8 * block)
+{
+	u32 t, l, r;
+
+	r = GET32(block);
+	l = GET32(block + 4);
+	DECRYPT_FIRST4(ONE, l, r);
+	DECRYPT12(ONE, l, r);
+	PUT32(block, l);
+	PUT32(block + 4, r);
+	t = l = r = 0;
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt(CAST_KEY * key, u8 * block)
+{
+	if (key->rounds > 12)
+		cast_decrypt16(key, block);
+	else
+		cast_decrypt12(key, block);
+}
+
+
+/***** Four blocks at once *****/
+
+#define GET4(l, r, in) \
+	for (j = 0; j < 4; j++) { \
+		l[j] = GET32(in + 8 * j); \
+		r[j] = GET32(in + 8 * j + 4); \
+	}
+#define PUT4(out, l, r) \
+	for (j = 0; j < 4; j++) { \
+		PUT32(out + 8 * j, l[j]); \
+		PUT32(out + 8 * j + 4, r[j]); \
+	}
+
+static void cast_encrypt4_12(CAST_KEY * key, const u8 * in, u8 * out)
+{
+	u32 t, l[4], r[4];
+	int j;
+
+	GET4(l, r, in);
+	ENCRYPT12(FOUR, l, r);
+	PUT4(out, r, l);
+}
+
+static void cast_encrypt4_16(CAST_KEY * key, const u8 * in, u8 * out)
+{
+	u32 t, l[4], r[4];
+	int j;
+
+	GET4(l, r, in);
+	ENCRYPT12(FOUR, l, r);
+	ENCRYPT_LAST4(FOUR, l, r);
+	PUT4(out, r, l);
+}
+
+static void cast_decrypt4_12(CAST_KEY * key, const u8 * in, u8 * out)
+{
+	u32 t, l[4], r[4];
+	int j;
+
+	GET4(r, l, in);
+	DECRYPT12(FOUR, l, r);
+	PUT4(out, l, r);
+}
+
+static void cast_decrypt4_16(CAST_KEY * key, const u8 * in, u8 * out)
+{
+	u32 t, l[4], r[4];
+	int j;
+
+	GET4(r, l, in);
+	DECRYPT_FIRST4(FOUR, l, r);
+	DECRYPT12(FOUR, l, r);
+	PUT4(out, l, r);
+}
+
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the
+ * two may be the same buffer but must not otherwise overlap
+ */
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(CAST_KEY * key, const u8 * in,
+					    u8 * out, int nblocks)
+{
+	if (key->rounds > 12) {
+		for (; nblocks >= 4; nblocks -= 4, in += 32, out += 32)
+			cast_encrypt4_16(key, in, out);
+	} else {
+		for (; nblocks >= 4; nblocks -= 4, in += 32, out += 32)
+			cast_encrypt4_12(key, in, out);
+	}
+	for (; nblocks > 0; nblocks--, in += 8, out += 8) {
+		if (out != in)
+			memcpy(out, in, 8);
+		_mcrypt_encrypt(key, out);
+	}
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(CAST_KEY * key, const u8 * in,
+					    u8 * out, int nblocks)
+{
+	if (key->rounds > 12) {
+		for (; nblocks >= 4; nblocks -= 4, in += 32, out += 32)
+			cast_decrypt4_16(key, in, out);
+	} else {
+		for (; nblocks >= 4; nblocks -= 4, in += 32, out += 32)
+			cast_decrypt4_12(key, in, out);
+	}
+	for (; nblocks > 0; nblocks--, in += 8, out += 8) {
+		if (out != in)
+			memcpy(out, in, 8);
+		_mcrypt_decrypt(key, out);
+	}
+}
+
 
 /***** Key Schedual *****/
 
@@ -340,6 +460,7 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	int blocksize = _mcrypt_get_block_size(), j;
 	void *key;
 	unsigned char cipher_tmp[200];
+	unsigned char blocks[13 * 8];
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -375,10 +496,35 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* the interleaved code must agree with the one above */
+	for (j = 0; j < 13 * 8; j++) {
+		blocks[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 13 * 8);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 13 * 8) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 13 * 8) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
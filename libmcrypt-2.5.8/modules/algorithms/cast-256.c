@@ -72,6 +72,8 @@ Mean:          674 cycles =    38.0 mbits/sec
 #define _mcrypt_set_key cast_256_LTX__mcrypt_set_key
 #define _mcrypt_encrypt cast_256_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt cast_256_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks cast_256_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks cast_256_LTX__mcrypt_decrypt_blocks
 #define _mcrypt_get_size cast_256_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size cast_256_LTX__mcrypt_get_block_size
 #define _is_block_algorithm cast_256_LTX__is_block_algorithm
@@ -332,17 +334,47 @@ word32 cast256_sbox[4][256] = { {
     u -= cast256_sbox[3][byte(t,0)];   \
     y ^= u
 
-#define f_rnd(x,n)                              \
-    f1(x[2],x[3],key->l_key[n],    key->l_key[n + 4]);    \
-    f2(x[1],x[2],key->l_key[n + 1],key->l_key[n + 5]);    \
-    f3(x[0],x[1],key->l_key[n + 2],key->l_key[n + 6]);    \
-    f1(x[3],x[0],key->l_key[n + 3],key->l_key[n + 7])
-
-#define i_rnd(x, n)                             \
-    f1(x[3],x[0],key->l_key[n + 3],key->l_key[n + 7]);    \
-    f3(x[0],x[1],key->l_key[n + 2],key->l_key[n + 6]);    \
-    f2(x[1],x[2],key->l_key[n + 1],key->l_key[n + 5]);    \
-    f1(x[2],x[3],key->l_key[n],    key->l_key[n + 4])
+/* A quad-round on one block x[4], or on four at once, x[4][4]. The */
+/* S box lookups of a block all depend on each other, so the        */
+/* processor can only overlap those of different blocks.            */
+
+#define ONE(f,x,i,j,kr,km)      f(x[i],x[j],kr,km)
+#define FOUR(f,x,i,j,kr,km)     \
+    f(x[0][i],x[0][j],kr,km);   \
+    f(x[1][i],x[1][j],kr,km);   \
+    f(x[2][i],x[2][j],kr,km);   \
+    f(x[3][i],x[3][j],kr,km)
+
+#define f_rnd(R,x,n)                            \
+    R(f1,x,2,3,key->l_key[n],    key->l_key[n + 4]);    \
+    R(f2,x,1,2,key->l_key[n + 1],key->l_key[n + 5]);    \
+    R(f3,x,0,1,key->l_key[n + 2],key->l_key[n + 6]);    \
+    R(f1,x,3,0,key->l_key[n + 3],key->l_key[n + 7])
+
+#define i_rnd(R,x,n)                            \
+    R(f1,x,3,0,key->l_key[n + 3],key->l_key[n + 7]);    \
+    R(f3,x,0,1,key->l_key[n + 2],key->l_key[n + 6]);    \
+    R(f2,x,1,2,key->l_key[n + 1],key->l_key[n + 5]);    \
+    R(f1,x,2,3,key->l_key[n],    key->l_key[n + 4])
+
+#define encrypt_rounds(R,x)                     \
+    f_rnd(R,x, 0); f_rnd(R,x, 8); f_rnd(R,x,16);  \
+    f_rnd(R,x,24); f_rnd(R,x,32); f_rnd(R,x,40);  \
+    i_rnd(R,x,48); i_rnd(R,x,56); i_rnd(R,x,64);  \
+    i_rnd(R,x,72); i_rnd(R,x,80); i_rnd(R,x,88)
+
+#define decrypt_rounds(R,x)                     \
+    f_rnd(R,x,88); f_rnd(R,x,80); f_rnd(R,x,72);  \
+    f_rnd(R,x,64); f_rnd(R,x,56); f_rnd(R,x,48);  \
+    i_rnd(R,x,40); i_rnd(R,x,32); i_rnd(R,x,24);  \
+    i_rnd(R,x,16); i_rnd(R,x, 8); i_rnd(R,x, 0)
+
+/* the words of a block are little endian */
+#ifdef WORDS_BIGENDIAN
+#define io_swap(x)  byteswap32(x)
+#else
+#define io_swap(x)  (x)
+#endif
 
 #define k_rnd(k,tr,tm)          \
     f1(k[6],k[7],tr[0],tm[0]);  \
@@ -412,68 +444,83 @@ WIN32DLL_DEFINE
 /* 16 bytes */
 WIN32DLL_DEFINE void _mcrypt_encrypt(cast256_key * key, word32 * blk)
 {
-	word32 t, u;
+	word32 t, u, x[4];
 
-#ifdef WORDS_BIGENDIAN
-	blk[0] = byteswap32(blk[0]);
-	blk[1] = byteswap32(blk[1]);
-	blk[2] = byteswap32(blk[2]);
-	blk[3] = byteswap32(blk[3]);
-#endif
+	x[0] = io_swap(blk[0]);
+	x[1] = io_swap(blk[1]);
+	x[2] = io_swap(blk[2]);
+	x[3] = io_swap(blk[3]);
 
-	f_rnd(blk, 0);
-	f_rnd(blk, 8);
-	f_rnd(blk, 16);
-	f_rnd(blk, 24);
-	f_rnd(blk, 32);
-	f_rnd(blk, 40);
-	i_rnd(blk, 48);
-	i_rnd(blk, 56);
-	i_rnd(blk, 64);
-	i_rnd(blk, 72);
-	i_rnd(blk, 80);
-	i_rnd(blk, 88);
+	encrypt_rounds(ONE, x);
 
-#ifdef WORDS_BIGENDIAN
-	blk[0] = byteswap32(blk[0]);
-	blk[1] = byteswap32(blk[1]);
-	blk[2] = byteswap32(blk[2]);
-	blk[3] = byteswap32(blk[3]);
-#endif
+	blk[0] = io_swap(x[0]);
+	blk[1] = io_swap(x[1]);
+	blk[2] = io_swap(x[2]);
+	blk[3] = io_swap(x[3]);
 }
 
 /* decrypt a block of text  */
 
 WIN32DLL_DEFINE void _mcrypt_decrypt(cast256_key * key, word32 * blk)
 {
-	word32 t, u;
+	word32 t, u, x[4];
 
-#ifdef WORDS_BIGENDIAN
-	blk[0] = byteswap32(blk[0]);
-	blk[1] = byteswap32(blk[1]);
-	blk[2] = byteswap32(blk[2]);
-	blk[3] = byteswap32(blk[3]);
-#endif
-	f_rnd(blk, 88);
-	f_rnd(blk, 80);
-	f_rnd(blk, 72);
-	f_rnd(blk, 64);
-	f_rnd(blk, 56);
-	f_rnd(blk, 48);
-	i_rnd(blk, 40);
-	i_rnd(blk, 32);
-	i_rnd(blk, 24);
-	i_rnd(blk, 16);
-	i_rnd(blk, 8);
-	i_rnd(blk, 0);
+	x[0] = io_swap(blk[0]);
+	x[1] = io_swap(blk[1]);
+	x[2] = io_swap(blk[2]);
+	x[3] = io_swap(blk[3]);
 
-#ifdef WORDS_BIGENDIAN
-	blk[0] = byteswap32(blk[0]);
-	blk[1] = byteswap32(blk[1]);
-	blk[2] = byteswap32(blk[2]);
-	blk[3] = byteswap32(blk[3]);
-#endif
+	decrypt_rounds(ONE, x);
 
+	blk[0] = io_swap(x[0]);
+	blk[1] = io_swap(x[1]);
+	blk[2] = io_swap(x[2]);
+	blk[3] = io_swap(x[3]);
+}
+
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the */
+/* two may be the same buffer but must not otherwise overlap      */
+
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(cast256_key * key,
+					    const word32 * in,
+					    word32 * out, int nblocks)
+{
+	word32 t, u, x[4][4];
+	int i;
+
+	for (; nblocks >= 4; nblocks -= 4, in += 16, out += 16) {
+		for (i = 0; i < 16; i++)
+			x[i >> 2][i & 3] = io_swap(in[i]);
+		encrypt_rounds(FOUR, x);
+		for (i = 0; i < 16; i++)
+			out[i] = io_swap(x[i >> 2][i & 3]);
+	}
+	for (; nblocks > 0; nblocks--, in += 4, out += 4) {
+		if (out != in)
+			memcpy(out, in, 16);
+		_mcrypt_encrypt(key, out);
+	}
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(cast256_key * key,
+					    const word32 * in,
+					    word32 * out, int nblocks)
+{
+	word32 t, u, x[4][4];
+	int i;
+
+	for (; nblocks >= 4; nblocks -= 4, in += 16, out += 16) {
+		for (i = 0; i < 16; i++)
+			x[i >> 2][i & 3] = io_swap(in[i]);
+		decrypt_rounds(FOUR, x);
+		for (i = 0; i < 16; i++)
+			out[i] = io_swap(x[i >> 2][i & 3]);
+	}
+	for (; nblocks > 0; nblocks--, in += 4, out += 4) {
+		if (out != in)
+			memcpy(out, in, 16);
+		_mcrypt_decrypt(key, out);
+	}
 }
 
 WIN32DLL_DEFINE int _mcrypt_get_size()
@@ -518,7 +565,8 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	unsigned char ciphertext[16];
 	int blocksize = _mcrypt_get_block_size(), j;
 	void *key;
-	unsigned char cipher_tmp[200];
+	unsigned char cipher_tmp[250];
+	word32 blocks[13 * 4];
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -556,10 +604,34 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
 
-	free(key);
-
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* the interleaved code must agree with the one above */
+	for (j = 0; j < 13 * 16; j++) {
+		((unsigned char *) blocks)[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 13 * 16);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[16 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 13 * 16) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[16 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 13 * 16) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
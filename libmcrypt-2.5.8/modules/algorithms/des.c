@@ -20,10 +20,14 @@
 
 #include <mcrypt_modules.h>
 #include "des.h"
+#include "des_sp.h"
+#include "des_bitslice.h"
 
 #define _mcrypt_set_key des_LTX__mcrypt_set_key
 #define _mcrypt_encrypt des_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt des_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks des_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks des_LTX__mcrypt_decrypt_blocks
 #define _mcrypt_get_size des_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size des_LTX__mcrypt_get_block_size
 #define _is_block_algorithm des_LTX__is_block_algorithm
@@ -35,37 +39,11 @@
 
 /* #define	NULL	0 */
 
-static void permute_ip(), permute_fp(), perminit_ip(), spinit(),
-perminit_fp();
 static word32 f();
 
 
 /* Tables defined in the Data Encryption Standard documents */
 
-/* initial permutation IP */
-static char ip[] = {
-	58, 50, 42, 34, 26, 18, 10, 2,
-	60, 52, 44, 36, 28, 20, 12, 4,
-	62, 54, 46, 38, 30, 22, 14, 6,
-	64, 56, 48, 40, 32, 24, 16, 8,
-	57, 49, 41, 33, 25, 17, 9, 1,
-	59, 51, 43, 35, 27, 19, 11, 3,
-	61, 53, 45, 37, 29, 21, 13, 5,
-	63, 55, 47, 39, 31, 23, 15, 7
-};
-
-/* final permutation IP^-1 */
-static char fp[] = {
-	40, 8, 48, 16, 56, 24, 64, 32,
-	39, 7, 47, 15, 55, 23, 63, 31,
-	38, 6, 46, 14, 54, 22, 62, 30,
-	37, 5, 45, 13, 53, 21, 61, 29,
-	36, 4, 44, 12, 52, 20, 60, 28,
-	35, 3, 43, 11, 51, 19, 59, 27,
-	34, 2, 42, 10, 50, 18, 58, 26,
-	33, 1, 41, 9, 49, 17, 57, 25
-};
-
 /* expansion operation matrix
  * This is for reference only; it is unused in the code
  * as the f() function performs it implicitly for speed
@@ -113,7 +91,11 @@ static char pc2[] = {
 	46, 42, 50, 36, 29, 32
 };
 
-/* The (in)famous S-boxes */
+/* The (in)famous S-boxes and the permutation P on their output.
+ * These are for reference only; f() uses them through the combined
+ * table des_sp[][] in des_sp.h
+ */
+#ifdef notdef
 static char si[8][64] = {
 	/* S1 */
 	{14, 4, 13, 1, 2, 15, 11, 8, 3, 10, 6, 12, 5, 9, 0, 7,
@@ -176,33 +158,49 @@ static char p32i[] = {
 	19, 13, 30, 6,
 	22, 11, 4, 25
 };
+#endif
 
 /* End of DES-defined tables */
 
-/* Lookup tables initialized once only at startup by desinit() */
 
 /* bit 0 is left-most in byte */
 static int bytebit[] = {
 	0200, 0100, 040, 020, 010, 04, 02, 01
 };
 
-static int nibblebit[] = {
-	010, 04, 02, 01
-};
-
-/* Allocate space and initialize DES lookup arrays
- * mode == 0: standard Data Encryption Algorithm
+/* IP and FP as a sequence of swaps of bit groups between the two
+ * halves of the block. Each swap is its own inverse, so FP is the
+ * same sequence in reverse order.
  */
-static int _mcrypt_desinit(DES_KEY * key)
-{
-
-	spinit(key);
-	perminit_ip(key);
-	perminit_fp(key);
-
-	return 0;
-}
+#define PERM_OP(a, b, n, m) \
+	work = (((a) >> (n)) ^ (b)) & (m); \
+	(b) ^= work; \
+	(a) ^= work << (n)
+
+#define IP(left, right) \
+	PERM_OP(left, right, 4, 0x0f0f0f0fL); \
+	PERM_OP(left, right, 16, 0x0000ffffL); \
+	PERM_OP(right, left, 2, 0x33333333L); \
+	PERM_OP(right, left, 8, 0x00ff00ffL); \
+	PERM_OP(left, right, 1, 0x55555555L)
+
+#define FP(left, right) \
+	PERM_OP(left, right, 1, 0x55555555L); \
+	PERM_OP(right, left, 8, 0x00ff00ffL); \
+	PERM_OP(right, left, 2, 0x33333333L); \
+	PERM_OP(left, right, 16, 0x0000ffffL); \
+	PERM_OP(left, right, 4, 0x0f0f0f0fL)
+
+/* DES numbers the bits of the block from the most significant bit
+ * of the first byte, so the halves are read and written big endian.
+ */
+#define GET_BE32(p) \
+	(((word32) (byte) (p)[0] << 24) | ((word32) (byte) (p)[1] << 16) | \
+	 ((word32) (byte) (p)[2] << 8) | (word32) (byte) (p)[3])
 
+#define PUT_BE32(p, v) \
+	(p)[0] = (char) ((v) >> 24); (p)[1] = (char) ((v) >> 16); \
+	(p)[2] = (char) ((v) >> 8); (p)[3] = (char) (v)
 
 /* Set key (initialize key schedule array) */
 WIN32DLL_DEFINE
@@ -214,7 +212,6 @@ WIN32DLL_DEFINE
 	int m;
 
 	Bzero(dkey, sizeof(DES_KEY));
-	_mcrypt_desinit(dkey);
 
 	/* Clear key schedule */
 
@@ -248,18 +245,12 @@ WIN32DLL_DEFINE
 /* In-place encryption of 64-bit block */
 WIN32DLL_DEFINE void _mcrypt_encrypt(DES_KEY * key, char *block)
 {
-	register word32 left, right;
+	register word32 left, right, work;
 	register char *knp;
-	word32 work[2];		/* Working data storage */
-
-	permute_ip(block, key, (char *) work);	/* Initial Permutation */
-#ifndef	WORDS_BIGENDIAN
-	left = byteswap32(work[0]);
-	right = byteswap32(work[1]);
-#else
-	left = work[0];
-	right = work[1];
-#endif
+
+	left = GET_BE32(block);
+	right = GET_BE32(block + 4);
+	IP(left, right);	/* Initial Permutation */
 
 	/* Do the 16 rounds.
 	 * The rounds are numbered from 0 to 15. On even rounds
@@ -267,47 +258,42 @@ WIN32DLL_DEFINE void _mcrypt_encrypt(DES_KEY * key, char *block)
 	 * the left half; on odd rounds the reverse is done.
 	 */
 	knp = &key->kn[0][0];
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp += 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp += 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp += 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp += 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp += 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp += 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp += 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp += 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp += 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp += 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp += 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp += 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp += 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp += 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp += 8;
-	right ^= f(key, left, knp);
-
-	/* Left/right half swap, plus byte swap if little-endian */
-#ifndef	WORDS_BIGENDIAN
-	work[1] = byteswap32(left);
-	work[0] = byteswap32(right);
-#else
-	work[0] = right;
-	work[1] = left;
-#endif
-	permute_fp((char *) work, key, block);	/* Inverse initial permutation */
+	right ^= f(left, knp);
+
+	/* Left/right half swap */
+	FP(right, left);	/* Inverse initial permutation */
+	PUT_BE32(block, right);
+	PUT_BE32(block + 4, left);
 }
 
 /* In-place decryption of 64-bit block. This function is the mirror
@@ -316,126 +302,61 @@ WIN32DLL_DEFINE void _mcrypt_encrypt(DES_KEY * key, char *block)
  */
 WIN32DLL_DEFINE void _mcrypt_decrypt(DES_KEY * key, char *block)
 {
-	register word32 left, right;
+	register word32 left, right, work;
 	register char *knp;
-	word32 work[2];		/* Working data storage */
 
-	permute_ip(block, key, (char *) work);	/* Initial permutation */
+	/* Left/right half swap */
+	right = GET_BE32(block);
+	left = GET_BE32(block + 4);
+	IP(right, left);	/* Initial permutation */
 
-	/* Left/right half swap, plus byte swap if little-endian */
-#ifndef	WORDS_BIGENDIAN
-	right = byteswap32(work[0]);
-	left = byteswap32(work[1]);
-#else
-	right = work[0];
-	left = work[1];
-#endif
 	/* Do the 16 rounds in reverse order.
 	 * The rounds are numbered from 15 to 0. On even rounds
 	 * the right half is fed to f() and the result exclusive-ORs
 	 * the left half; on odd rounds the reverse is done.
 	 */
 	knp = &key->kn[15][0];
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp -= 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp -= 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp -= 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp -= 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp -= 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp -= 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp -= 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp -= 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp -= 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp -= 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp -= 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp -= 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp -= 8;
-	left ^= f(key, right, knp);
+	left ^= f(right, knp);
 	knp -= 8;
-	right ^= f(key, left, knp);
+	right ^= f(left, knp);
 	knp -= 8;
-	left ^= f(key, right, knp);
-
-#ifndef	WORDS_BIGENDIAN
-	work[0] = byteswap32(left);
-	work[1] = byteswap32(right);
-#else
-	work[0] = left;
-	work[1] = right;
-#endif
-	permute_fp((char *) work, key, block);	/* Inverse initial permutation */
-}
+	left ^= f(right, knp);
 
-/* Permute inblock with perm */
-static void permute_ip(char *inblock, DES_KEY * key, char *outblock)
-{
-	register char *ib, *ob;	/* ptr to input or output block */
-	register char *p, *q;
-	register int j;
-
-	/* Clear output block */
-	Bzero(outblock, 8);
-
-	ib = inblock;
-	for (j = 0; j < 16; j += 2, ib++) {	/* for each input nibble */
-		ob = outblock;
-		p = key->iperm[j][(*ib >> 4) & 0xf];
-		q = key->iperm[j + 1][*ib & 0xf];
-		/* and each output byte, OR the masks together */
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-	}
-}
-
-/* Permute inblock with perm */
-static void permute_fp(char *inblock, DES_KEY * key, char *outblock)
-{
-	register char *ib, *ob;	/* ptr to input or output block */
-	register char *p, *q;
-	register int j;
-
-	/* Clear output block */
-	Bzero(outblock, 8);
-
-	ib = inblock;
-	for (j = 0; j < 16; j += 2, ib++) {	/* for each input nibble */
-		ob = outblock;
-		p = key->fperm[j][(*ib >> 4) & 0xf];
-		q = key->fperm[j + 1][*ib & 0xf];
-		/* and each output byte, OR the masks together */
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-		*ob++ |= *p++ | *q++;
-	}
+	FP(left, right);	/* Inverse initial permutation */
+	PUT_BE32(block, left);
+	PUT_BE32(block + 4, right);
 }
 
 /* The nonlinear function f(r,k), the heart of DES */
-static word32 f(DES_KEY * key, register word32 r, register char *subkey)
+static word32 f(register word32 r, register char *subkey)
 {
-	register word32 *spp;
+	register const word32 *spp;
 	register word32 rval, rt;
 	register int er;
 
@@ -454,7 +375,7 @@ static word32 f(DES_KEY * key, register word32 r, register char *subkey)
 
 	/* Compute E(R) for each block of 6 bits, and run thru boxes */
 	er = ((int) r << 1) | ((r & 0x80000000) ? 1 : 0);
-	spp = &key->sp[7][0];
+	spp = &des_sp[7][0];
 	rval = spp[(er ^ *subkey--) & 0x3f];
 	spp -= 64;
 	rt = (word32) r >> 3;
@@ -484,89 +405,80 @@ static word32 f(DES_KEY * key, register word32 r, register char *subkey)
 	return rval;
 }
 
-/* initialize a perm array */
-static void perminit_ip(DES_KEY * key)
+/* Below about this many blocks a bitsliced batch, which always costs
+ * as much as a full one, is slower than running f() on each block
+ */
+#define DES_BS_MIN (DES_BS_BLOCKS * 3 / 4)
+
+/* Encrypts or decrypts n (at most DES_BS_BLOCKS) blocks bitsliced */
+static void des_bs_crypt(DES_KEY * key, const char *in, char *out,
+			 int n, int decrypt)
 {
-	register int l, j, k;
-	int i, m;
-
-	/* Clear the permutation array */
-	Bzero(key->iperm, 16 * 16 * 8);
-
-	for (i = 0; i < 16; i++)	/* each input nibble position */
-		for (j = 0; j < 16; j++)	/* each possible input nibble */
-			for (k = 0; k < 64; k++) {	/* each output bit position */
-				l = ip[k] - 1;	/* where does this bit come from */
-				if ((l >> 2) != i)	/* does it come from input posn? */
-					continue;	/* if not, bit k is 0    */
-				if (!(j & nibblebit[l & 3]))
-					continue;	/* any such bit in input? */
-				m = k & 07;	/* which bit is this in the byte */
-				key->iperm[i][j][k >> 3] |= bytebit[m];
-			}
+	des_bs_word s[64], k[16][48];
+	word32 half[2 * DES_BS_BLOCKS];
+	register word32 left, right, work;
+	int i;
+
+	for (i = 0; i < n; i++, in += 8) {
+		left = GET_BE32(in);
+		right = GET_BE32(in + 4);
+		IP(left, right);
+		half[2 * i] = left;
+		half[2 * i + 1] = right;
+	}
+	des_bs_load(s, s + 32, half, n);
+
+	des_bs_key(key->kn, k);
+	des_bs_rounds(s, s + 32, k, decrypt);
+
+	des_bs_store(half, s + 32, s, n);
+	for (i = 0; i < n; i++, out += 8) {
+		left = half[2 * i];
+		right = half[2 * i + 1];
+		FP(left, right);
+		PUT_BE32(out, left);
+		PUT_BE32(out + 4, right);
+	}
 }
 
-static void perminit_fp(DES_KEY * key)
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the
+ * two may be the same buffer but must not otherwise overlap
+ */
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(DES_KEY * key, const word32 * in,
+					    word32 * out, int nblocks)
 {
-	register int l, j, k;
-	int i, m;
-
-	/* Clear the permutation array */
-	Bzero(key->fperm, 16 * 16 * 8);
-
-	for (i = 0; i < 16; i++)	/* each input nibble position */
-		for (j = 0; j < 16; j++)	/* each possible input nibble */
-			for (k = 0; k < 64; k++) {	/* each output bit position */
-				l = fp[k] - 1;	/* where does this bit come from */
-				if ((l >> 2) != i)	/* does it come from input posn? */
-					continue;	/* if not, bit k is 0    */
-				if (!(j & nibblebit[l & 3]))
-					continue;	/* any such bit in input? */
-				m = k & 07;	/* which bit is this in the byte */
-				key->fperm[i][j][k >> 3] |= bytebit[m];
-			}
+	const char *src = (const char *) in;
+	char *dst = (char *) out;
+	int n;
+
+	for (; nblocks >= DES_BS_MIN;
+	     nblocks -= n, src += 8 * n, dst += 8 * n) {
+		n = nblocks < DES_BS_BLOCKS ? nblocks : DES_BS_BLOCKS;
+		des_bs_crypt(key, src, dst, n, 0);
+	}
+	for (; nblocks > 0; nblocks--, src += 8, dst += 8) {
+		if (dst != src)
+			memcpy(dst, src, 8);
+		_mcrypt_encrypt(key, dst);
+	}
 }
 
-/* Initialize the lookup table for the combined S and P boxes */
-static void spinit(DES_KEY * key)
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(DES_KEY * key, const word32 * in,
+					    word32 * out, int nblocks)
 {
-	char pbox[32];
-	int p, i, s, j, rowcol;
-	word32 val;
-
-	/* Compute pbox, the inverse of p32i.
-	 * This is easier to work with
-	 */
-	for (p = 0; p < 32; p++) {
-		for (i = 0; i < 32; i++) {
-			if (p32i[i] - 1 == p) {
-				pbox[p] = i;
-				break;
-			}
-		}
+	const char *src = (const char *) in;
+	char *dst = (char *) out;
+	int n;
+
+	for (; nblocks >= DES_BS_MIN;
+	     nblocks -= n, src += 8 * n, dst += 8 * n) {
+		n = nblocks < DES_BS_BLOCKS ? nblocks : DES_BS_BLOCKS;
+		des_bs_crypt(key, src, dst, n, 1);
 	}
-	for (s = 0; s < 8; s++) {	/* For each S-box */
-		for (i = 0; i < 64; i++) {	/* For each possible input */
-			val = 0;
-			/* The row number is formed from the first and last
-			 * bits; the column number is from the middle 4
-			 */
-			rowcol =
-			    (i & 32) | ((i & 1) ? 16 : 0) | ((i >> 1) &
-							     0xf);
-			for (j = 0; j < 4; j++) {	/* For each output bit */
-				if (si[s][rowcol] & (8 >> j)) {
-					val |=
-					    1L << (31 - pbox[4 * s + j]);
-				}
-			}
-			key->sp[s][i] = val;
-
-#ifdef DEBUG
-			printf("sp[%d][%2d] = %08lx\n", s, i,
-			       key->sp[s][i]);
-#endif
-		}
+	for (; nblocks > 0; nblocks--, src += 8, dst += 8) {
+		if (dst != src)
+			memcpy(dst, src, 8);
+		_mcrypt_decrypt(key, dst);
 	}
 }
 
@@ -602,6 +514,9 @@ return "DES";
 
 #define CIPHER "a1502d70ba1320c8"
 
+/* enough to go through both a full and a partial bitsliced batch */
+#define TEST_BLOCKS (DES_BS_BLOCKS + DES_BS_MIN + 3)
+
 WIN32DLL_DEFINE int _mcrypt_self_test()
 {
 	char *keyword;
@@ -610,6 +525,8 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	int blocksize = _mcrypt_get_block_size(), j;
 	void *key;
 	unsigned char cipher_tmp[200];
+	unsigned char tmp[TEST_BLOCKS * 8];
+	word32 blocks[TEST_BLOCKS * 2];
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -648,10 +565,35 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* the bitsliced code must agree with the one above */
+	for (j = 0; j < TEST_BLOCKS * 8; j++) {
+		((unsigned char *) blocks)[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(tmp, blocks, TEST_BLOCKS * 8);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, TEST_BLOCKS);
+	for (j = 0; j < TEST_BLOCKS; j++) {
+		_mcrypt_encrypt(key, (void *) &tmp[8 * j]);
+	}
+	if (memcmp(tmp, blocks, TEST_BLOCKS * 8) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, TEST_BLOCKS);
+	for (j = 0; j < TEST_BLOCKS; j++) {
+		_mcrypt_decrypt(key, (void *) &tmp[8 * j]);
+	}
+	free(key);
+
+	if (memcmp(tmp, blocks, TEST_BLOCKS * 8) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
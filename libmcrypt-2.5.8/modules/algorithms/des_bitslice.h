@@ -0,0 +1,714 @@
+/* Bitsliced DES, shared by des.c and tripledes.c.
+ *
+ * A batch of blocks is transposed so that word i holds bit i + 1 (in
+ * the numbering of the standard) of every block, one block per bit
+ * position. E, P, IP and FP then only rename words, and each S-box is
+ * a fixed boolean circuit evaluated for all the blocks at once. This
+ * is faster than the table driven f() once there are enough
+ * independent blocks to fill a word, as in ECB or CBC decryption.
+ *
+ * Where the compiler offers 128 bit vectors on a target that always
+ * has them, a word carries two 64 block lanes.
+ */
+
+#ifndef DES_BITSLICE_H
+#define DES_BITSLICE_H
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+# define DES_BS_LANES 2
+typedef unsigned long long des_bs_word __attribute__ ((vector_size (16)));
+# define DES_BS_LANE(w, g) ((w)[g])
+#else
+# define DES_BS_LANES 1
+typedef unsigned long long des_bs_word;
+# define DES_BS_LANE(w, g) (w)
+#endif
+
+#define DES_BS_BLOCKS (64 * DES_BS_LANES)
+
+/* The S-boxes in algebraic normal form: each output bit is the XOR of
+ * products of the six input bits, the products being shared between
+ * the four outputs. These were generated from si[][] in des.c, and
+ * XOR each output straight into the word of the left half that P
+ * moves it to.
+ */
+
+static void des_bs_s1(des_bs_word * l, des_bs_word a1, des_bs_word a2,
+		      des_bs_word a3, des_bs_word a4, des_bs_word a5,
+		      des_bs_word a6)
+{
+	des_bs_word a12 = a1 & a2;
+	des_bs_word a13 = a1 & a3;
+	des_bs_word a14 = a1 & a4;
+	des_bs_word a15 = a1 & a5;
+	des_bs_word a16 = a1 & a6;
+	des_bs_word a23 = a2 & a3;
+	des_bs_word a24 = a2 & a4;
+	des_bs_word a25 = a2 & a5;
+	des_bs_word a26 = a2 & a6;
+	des_bs_word a34 = a3 & a4;
+	des_bs_word a35 = a3 & a5;
+	des_bs_word a36 = a3 & a6;
+	des_bs_word a45 = a4 & a5;
+	des_bs_word a46 = a4 & a6;
+	des_bs_word a56 = a5 & a6;
+	des_bs_word a123 = a12 & a3;
+	des_bs_word a124 = a12 & a4;
+	des_bs_word a125 = a12 & a5;
+	des_bs_word a126 = a12 & a6;
+	des_bs_word a134 = a13 & a4;
+	des_bs_word a135 = a13 & a5;
+	des_bs_word a145 = a14 & a5;
+	des_bs_word a146 = a14 & a6;
+	des_bs_word a156 = a15 & a6;
+	des_bs_word a234 = a23 & a4;
+	des_bs_word a235 = a23 & a5;
+	des_bs_word a236 = a23 & a6;
+	des_bs_word a245 = a24 & a5;
+	des_bs_word a246 = a24 & a6;
+	des_bs_word a345 = a34 & a5;
+	des_bs_word a346 = a34 & a6;
+	des_bs_word a356 = a35 & a6;
+	des_bs_word a456 = a45 & a6;
+	des_bs_word a1234 = a123 & a4;
+	des_bs_word a1235 = a123 & a5;
+	des_bs_word a1236 = a123 & a6;
+	des_bs_word a1245 = a124 & a5;
+	des_bs_word a1246 = a124 & a6;
+	des_bs_word a1256 = a125 & a6;
+	des_bs_word a1345 = a134 & a5;
+	des_bs_word a1346 = a134 & a6;
+	des_bs_word a1356 = a135 & a6;
+	des_bs_word a2346 = a234 & a6;
+	des_bs_word a2356 = a235 & a6;
+	des_bs_word a2456 = a245 & a6;
+	des_bs_word a3456 = a345 & a6;
+	des_bs_word a12346 = a1234 & a6;
+	des_bs_word a12356 = a1235 & a6;
+	des_bs_word a12456 = a1245 & a6;
+	des_bs_word a13456 = a1345 & a6;
+
+	l[8] ^= ~a1 ^ a2 ^ a3 ^ a5 ^ a6 ^ a14 ^ a15 ^ a23 ^ a34 ^ a123 ^
+	    a124 ^ a134 ^ a135 ^ a146 ^ a234 ^ a345 ^ a346 ^ a456 ^
+	    a1234 ^ a1245 ^ a1246 ^ a1256 ^ a1345 ^ a1346 ^ a12346 ^
+	    a12356;
+	l[16] ^= ~a2 ^ a3 ^ a6 ^ a12 ^ a13 ^ a15 ^ a16 ^ a24 ^ a26 ^
+	    a35 ^ a45 ^ a46 ^ a56 ^ a123 ^ a125 ^ a126 ^ a134 ^ a145 ^
+	    a236 ^ a245 ^ a246 ^ a346 ^ a356 ^ a1234 ^ a1235 ^ a1236 ^
+	    a1356 ^ a3456 ^ a12346 ^ a12356 ^ a12456 ^ a13456;
+	l[22] ^= ~a1 ^ a4 ^ a5 ^ a6 ^ a12 ^ a15 ^ a23 ^ a24 ^ a25 ^
+	    a26 ^ a34 ^ a35 ^ a36 ^ a45 ^ a123 ^ a124 ^ a126 ^ a134 ^
+	    a156 ^ a234 ^ a235 ^ a236 ^ a246 ^ a346 ^ a456 ^ a1234 ^
+	    a1235 ^ a1236 ^ a1245 ^ a1246 ^ a1256 ^ a2346 ^ a2456 ^
+	    a12346 ^ a12356 ^ a12456 ^ a13456;
+	l[30] ^= a2 ^ a4 ^ a13 ^ a14 ^ a15 ^ a16 ^ a25 ^ a26 ^ a35 ^
+	    a56 ^ a123 ^ a125 ^ a134 ^ a135 ^ a145 ^ a146 ^ a156 ^
+	    a236 ^ a245 ^ a246 ^ a1234 ^ a1245 ^ a1256 ^ a1345 ^ a1346 ^
+	    a2356 ^ a12346 ^ a12356 ^ a13456;
+}
+
+static void des_bs_s2(des_bs_word * l, des_bs_word a1, des_bs_word a2,
+		      des_bs_word a3, des_bs_word a4, des_bs_word a5,
+		      des_bs_word a6)
+{
+	des_bs_word a12 = a1 & a2;
+	des_bs_word a13 = a1 & a3;
+	des_bs_word a14 = a1 & a4;
+	des_bs_word a15 = a1 & a5;
+	des_bs_word a16 = a1 & a6;
+	des_bs_word a23 = a2 & a3;
+	des_bs_word a24 = a2 & a4;
+	des_bs_word a25 = a2 & a5;
+	des_bs_word a26 = a2 & a6;
+	des_bs_word a34 = a3 & a4;
+	des_bs_word a35 = a3 & a5;
+	des_bs_word a36 = a3 & a6;
+	des_bs_word a45 = a4 & a5;
+	des_bs_word a123 = a12 & a3;
+	des_bs_word a124 = a12 & a4;
+	des_bs_word a125 = a12 & a5;
+	des_bs_word a126 = a12 & a6;
+	des_bs_word a134 = a13 & a4;
+	des_bs_word a135 = a13 & a5;
+	des_bs_word a136 = a13 & a6;
+	des_bs_word a145 = a14 & a5;
+	des_bs_word a156 = a15 & a6;
+	des_bs_word a235 = a23 & a5;
+	des_bs_word a236 = a23 & a6;
+	des_bs_word a245 = a24 & a5;
+	des_bs_word a246 = a24 & a6;
+	des_bs_word a256 = a25 & a6;
+	des_bs_word a345 = a34 & a5;
+	des_bs_word a346 = a34 & a6;
+	des_bs_word a456 = a45 & a6;
+	des_bs_word a1234 = a123 & a4;
+	des_bs_word a1235 = a123 & a5;
+	des_bs_word a1236 = a123 & a6;
+	des_bs_word a1245 = a124 & a5;
+	des_bs_word a1246 = a124 & a6;
+	des_bs_word a1256 = a125 & a6;
+	des_bs_word a1345 = a134 & a5;
+	des_bs_word a1346 = a134 & a6;
+	des_bs_word a1356 = a135 & a6;
+	des_bs_word a1456 = a145 & a6;
+	des_bs_word a2356 = a235 & a6;
+	des_bs_word a2456 = a245 & a6;
+	des_bs_word a3456 = a345 & a6;
+	des_bs_word a12356 = a1235 & a6;
+	des_bs_word a12456 = a1245 & a6;
+
+	l[12] ^= ~a1 ^ a3 ^ a5 ^ a6 ^ a23 ^ a24 ^ a26 ^ a45 ^ a123 ^
+	    a126 ^ a145 ^ a156 ^ a236 ^ a245 ^ a1236 ^ a1245 ^ a1256 ^
+	    a1356 ^ a1456 ^ a12456;
+	l[27] ^= ~a1 ^ a2 ^ a4 ^ a5 ^ a6 ^ a23 ^ a24 ^ a36 ^ a246 ^
+	    a456 ^ a1235 ^ a1245 ^ a3456 ^ a12356 ^ a12456;
+	l[1] ^= ~a1 ^ a2 ^ a4 ^ a5 ^ a12 ^ a13 ^ a34 ^ a35 ^ a123 ^
+	    a124 ^ a125 ^ a126 ^ a134 ^ a135 ^ a145 ^ a156 ^ a236 ^
+	    a246 ^ a256 ^ a345 ^ a346 ^ a1234 ^ a1235 ^ a1246 ^ a1345 ^
+	    a1346 ^ a2456 ^ a12356 ^ a12456;
+	l[17] ^= ~a1 ^ a3 ^ a4 ^ a12 ^ a13 ^ a16 ^ a26 ^ a35 ^ a36 ^
+	    a125 ^ a135 ^ a136 ^ a156 ^ a235 ^ a245 ^ a456 ^ a1236 ^
+	    a1246 ^ a1256 ^ a1356 ^ a1456 ^ a2356 ^ a2456 ^ a12356;
+}
+
+static void des_bs_s3(des_bs_word * l, des_bs_word a1, des_bs_word a2,
+		      des_bs_word a3, des_bs_word a4, des_bs_word a5,
+		      des_bs_word a6)
+{
+	des_bs_word a12 = a1 & a2;
+	des_bs_word a13 = a1 & a3;
+	des_bs_word a14 = a1 & a4;
+	des_bs_word a15 = a1 & a5;
+	des_bs_word a16 = a1 & a6;
+	des_bs_word a23 = a2 & a3;
+	des_bs_word a24 = a2 & a4;
+	des_bs_word a25 = a2 & a5;
+	des_bs_word a26 = a2 & a6;
+	des_bs_word a34 = a3 & a4;
+	des_bs_word a35 = a3 & a5;
+	des_bs_word a36 = a3 & a6;
+	des_bs_word a45 = a4 & a5;
+	des_bs_word a46 = a4 & a6;
+	des_bs_word a123 = a12 & a3;
+	des_bs_word a124 = a12 & a4;
+	des_bs_word a125 = a12 & a5;
+	des_bs_word a126 = a12 & a6;
+	des_bs_word a134 = a13 & a4;
+	des_bs_word a135 = a13 & a5;
+	des_bs_word a145 = a14 & a5;
+	des_bs_word a146 = a14 & a6;
+	des_bs_word a234 = a23 & a4;
+	des_bs_word a235 = a23 & a5;
+	des_bs_word a236 = a23 & a6;
+	des_bs_word a245 = a24 & a5;
+	des_bs_word a246 = a24 & a6;
+	des_bs_word a256 = a25 & a6;
+	des_bs_word a345 = a34 & a5;
+	des_bs_word a346 = a34 & a6;
+	des_bs_word a356 = a35 & a6;
+	des_bs_word a456 = a45 & a6;
+	des_bs_word a1234 = a123 & a4;
+	des_bs_word a1235 = a123 & a5;
+	des_bs_word a1236 = a123 & a6;
+	des_bs_word a1245 = a124 & a5;
+	des_bs_word a1246 = a124 & a6;
+	des_bs_word a1256 = a125 & a6;
+	des_bs_word a1345 = a134 & a5;
+	des_bs_word a1346 = a134 & a6;
+	des_bs_word a1356 = a135 & a6;
+	des_bs_word a1456 = a145 & a6;
+	des_bs_word a2346 = a234 & a6;
+	des_bs_word a2356 = a235 & a6;
+	des_bs_word a2456 = a245 & a6;
+	des_bs_word a3456 = a345 & a6;
+	des_bs_word a12346 = a1234 & a6;
+	des_bs_word a12356 = a1235 & a6;
+	des_bs_word a12456 = a1245 & a6;
+	des_bs_word a13456 = a1345 & a6;
+
+	l[23] ^= ~a2 ^ a3 ^ a5 ^ a12 ^ a13 ^ a14 ^ a16 ^ a24 ^ a34 ^
+	    a35 ^ a45 ^ a46 ^ a123 ^ a124 ^ a134 ^ a145 ^ a146 ^ a234 ^
+	    a235 ^ a245 ^ a456 ^ a1234 ^ a1245 ^ a1356 ^ a1456 ^ a2356 ^
+	    a2456 ^ a3456 ^ a12456 ^ a13456;
+	l[15] ^= a1 ^ a3 ^ a6 ^ a12 ^ a23 ^ a24 ^ a25 ^ a26 ^ a35 ^
+	    a45 ^ a46 ^ a123 ^ a124 ^ a125 ^ a126 ^ a234 ^ a235 ^ a236 ^
+	    a246 ^ a256 ^ a456 ^ a1234 ^ a1235 ^ a1236 ^ a1256 ^ a1456 ^
+	    a2356 ^ a12356 ^ a13456;
+	l[29] ^= ~a1 ^ a2 ^ a4 ^ a5 ^ a6 ^ a14 ^ a16 ^ a23 ^ a24 ^ a25 ^
+	    a34 ^ a35 ^ a36 ^ a46 ^ a124 ^ a125 ^ a126 ^ a135 ^ a145 ^
+	    a146 ^ a234 ^ a236 ^ a245 ^ a256 ^ a345 ^ a346 ^ a356 ^
+	    a456 ^ a1234 ^ a1246 ^ a1256 ^ a1346 ^ a1356 ^ a1456 ^
+	    a2346 ^ a3456 ^ a12346 ^ a12456 ^ a13456;
+	l[5] ^= a1 ^ a2 ^ a4 ^ a6 ^ a12 ^ a13 ^ a15 ^ a16 ^ a35 ^ a45 ^
+	    a123 ^ a125 ^ a126 ^ a135 ^ a145 ^ a146 ^ a1235 ^ a1236 ^
+	    a1256 ^ a12346;
+}
+
+static void des_bs_s4(des_bs_word * l, des_bs_word a1, des_bs_word a2,
+		      des_bs_word a3, des_bs_word a4, des_bs_word a5,
+		      des_bs_word a6)
+{
+	des_bs_word a12 = a1 & a2;
+	des_bs_word a13 = a1 & a3;
+	des_bs_word a14 = a1 & a4;
+	des_bs_word a15 = a1 & a5;
+	des_bs_word a16 = a1 & a6;
+	des_bs_word a23 = a2 & a3;
+	des_bs_word a24 = a2 & a4;
+	des_bs_word a25 = a2 & a5;
+	des_bs_word a26 = a2 & a6;
+	des_bs_word a34 = a3 & a4;
+	des_bs_word a35 = a3 & a5;
+	des_bs_word a36 = a3 & a6;
+	des_bs_word a45 = a4 & a5;
+	des_bs_word a46 = a4 & a6;
+	des_bs_word a56 = a5 & a6;
+	des_bs_word a123 = a12 & a3;
+	des_bs_word a124 = a12 & a4;
+	des_bs_word a125 = a12 & a5;
+	des_bs_word a134 = a13 & a4;
+	des_bs_word a135 = a13 & a5;
+	des_bs_word a136 = a13 & a6;
+	des_bs_word a145 = a14 & a5;
+	des_bs_word a146 = a14 & a6;
+	des_bs_word a156 = a15 & a6;
+	des_bs_word a234 = a23 & a4;
+	des_bs_word a235 = a23 & a5;
+	des_bs_word a236 = a23 & a6;
+	des_bs_word a245 = a24 & a5;
+	des_bs_word a256 = a25 & a6;
+	des_bs_word a345 = a34 & a5;
+	des_bs_word a456 = a45 & a6;
+	des_bs_word a1234 = a123 & a4;
+	des_bs_word a1235 = a123 & a5;
+	des_bs_word a1236 = a123 & a6;
+	des_bs_word a1245 = a124 & a5;
+	des_bs_word a1256 = a125 & a6;
+	des_bs_word a1345 = a134 & a5;
+	des_bs_word a1346 = a134 & a6;
+	des_bs_word a1356 = a135 & a6;
+	des_bs_word a1456 = a145 & a6;
+	des_bs_word a2346 = a234 & a6;
+	des_bs_word a2356 = a235 & a6;
+	des_bs_word a2456 = a245 & a6;
+	des_bs_word a3456 = a345 & a6;
+	des_bs_word a12356 = a1235 & a6;
+	des_bs_word a13456 = a1345 & a6;
+
+	l[25] ^= a1 ^ a4 ^ a5 ^ a6 ^ a14 ^ a23 ^ a25 ^ a26 ^ a35 ^ a36 ^
+	    a46 ^ a56 ^ a124 ^ a125 ^ a134 ^ a146 ^ a156 ^ a235 ^ a245 ^
+	    a256 ^ a456 ^ a1234 ^ a1235 ^ a1245 ^ a1256 ^ a1345 ^
+	    a1346 ^ a1356 ^ a2346 ^ a2356 ^ a2456 ^ a12356 ^ a13456;
+	l[19] ^= ~a1 ^ a2 ^ a3 ^ a15 ^ a23 ^ a26 ^ a35 ^ a36 ^ a45 ^
+	    a46 ^ a56 ^ a124 ^ a135 ^ a146 ^ a156 ^ a234 ^ a256 ^ a456 ^
+	    a1234 ^ a1245 ^ a1256 ^ a1346 ^ a1356 ^ a2346 ^ a2356 ^
+	    a2456 ^ a12356 ^ a13456;
+	l[9] ^= ~a2 ^ a3 ^ a5 ^ a6 ^ a12 ^ a14 ^ a15 ^ a16 ^ a26 ^ a45 ^
+	    a46 ^ a56 ^ a124 ^ a125 ^ a135 ^ a136 ^ a145 ^ a146 ^ a156 ^
+	    a234 ^ a236 ^ a256 ^ a345 ^ a1234 ^ a1235 ^ a1236 ^ a1245 ^
+	    a1345 ^ a1456 ^ a2346 ^ a2456 ^ a3456 ^ a12356 ^ a13456;
+	l[0] ^= ~a1 ^ a3 ^ a4 ^ a12 ^ a13 ^ a16 ^ a23 ^ a25 ^ a26 ^
+	    a45 ^ a46 ^ a56 ^ a123 ^ a124 ^ a125 ^ a135 ^ a136 ^ a146 ^
+	    a156 ^ a236 ^ a245 ^ a256 ^ a1234 ^ a1236 ^ a1245 ^ a1456 ^
+	    a2346 ^ a2456 ^ a3456 ^ a12356 ^ a13456;
+}
+
+static void des_bs_s5(des_bs_word * l, des_bs_word a1, des_bs_word a2,
+		      des_bs_word a3, des_bs_word a4, des_bs_word a5,
+		      des_bs_word a6)
+{
+	des_bs_word a12 = a1 & a2;
+	des_bs_word a13 = a1 & a3;
+	des_bs_word a14 = a1 & a4;
+	des_bs_word a15 = a1 & a5;
+	des_bs_word a16 = a1 & a6;
+	des_bs_word a23 = a2 & a3;
+	des_bs_word a24 = a2 & a4;
+	des_bs_word a25 = a2 & a5;
+	des_bs_word a26 = a2 & a6;
+	des_bs_word a34 = a3 & a4;
+	des_bs_word a35 = a3 & a5;
+	des_bs_word a36 = a3 & a6;
+	des_bs_word a45 = a4 & a5;
+	des_bs_word a46 = a4 & a6;
+	des_bs_word a56 = a5 & a6;
+	des_bs_word a123 = a12 & a3;
+	des_bs_word a124 = a12 & a4;
+	des_bs_word a125 = a12 & a5;
+	des_bs_word a126 = a12 & a6;
+	des_bs_word a134 = a13 & a4;
+	des_bs_word a135 = a13 & a5;
+	des_bs_word a136 = a13 & a6;
+	des_bs_word a145 = a14 & a5;
+	des_bs_word a146 = a14 & a6;
+	des_bs_word a156 = a15 & a6;
+	des_bs_word a234 = a23 & a4;
+	des_bs_word a235 = a23 & a5;
+	des_bs_word a236 = a23 & a6;
+	des_bs_word a245 = a24 & a5;
+	des_bs_word a246 = a24 & a6;
+	des_bs_word a256 = a25 & a6;
+	des_bs_word a345 = a34 & a5;
+	des_bs_word a346 = a34 & a6;
+	des_bs_word a356 = a35 & a6;
+	des_bs_word a1234 = a123 & a4;
+	des_bs_word a1235 = a123 & a5;
+	des_bs_word a1236 = a123 & a6;
+	des_bs_word a1245 = a124 & a5;
+	des_bs_word a1246 = a124 & a6;
+	des_bs_word a1256 = a125 & a6;
+	des_bs_word a1345 = a134 & a5;
+	des_bs_word a1346 = a134 & a6;
+	des_bs_word a1356 = a135 & a6;
+	des_bs_word a1456 = a145 & a6;
+	des_bs_word a2346 = a234 & a6;
+	des_bs_word a2356 = a235 & a6;
+	des_bs_word a2456 = a245 & a6;
+	des_bs_word a3456 = a345 & a6;
+	des_bs_word a12346 = a1234 & a6;
+	des_bs_word a12356 = a1235 & a6;
+	des_bs_word a12456 = a1245 & a6;
+	des_bs_word a13456 = a1345 & a6;
+
+	l[7] ^= a2 ^ a5 ^ a6 ^ a13 ^ a15 ^ a24 ^ a34 ^ a36 ^ a45 ^ a46 ^
+	    a56 ^ a124 ^ a136 ^ a146 ^ a156 ^ a236 ^ a245 ^ a246 ^
+	    a345 ^ a346 ^ a1234 ^ a1236 ^ a1245 ^ a1246 ^ a1256 ^
+	    a1345 ^ a1356 ^ a2356 ^ a3456 ^ a12456;
+	l[13] ^= a1 ^ a3 ^ a4 ^ a5 ^ a6 ^ a24 ^ a36 ^ a123 ^ a126 ^
+	    a145 ^ a156 ^ a236 ^ a346 ^ a356 ^ a1234 ^ a1236 ^ a1246 ^
+	    a1345 ^ a1456 ^ a2346 ^ a3456 ^ a12346;
+	l[24] ^= ~a1 ^ a2 ^ a4 ^ a5 ^ a13 ^ a14 ^ a16 ^ a25 ^ a34 ^
+	    a35 ^ a36 ^ a45 ^ a46 ^ a56 ^ a123 ^ a124 ^ a125 ^ a126 ^
+	    a134 ^ a135 ^ a136 ^ a145 ^ a156 ^ a234 ^ a235 ^ a245 ^
+	    a246 ^ a256 ^ a345 ^ a346 ^ a1234 ^ a1345 ^ a1346 ^ a2346 ^
+	    a2356 ^ a3456 ^ a12346 ^ a12356 ^ a12456 ^ a13456;
+	l[2] ^= a3 ^ a12 ^ a13 ^ a14 ^ a16 ^ a24 ^ a25 ^ a26 ^ a35 ^
+	    a36 ^ a45 ^ a56 ^ a123 ^ a124 ^ a125 ^ a126 ^ a136 ^ a145 ^
+	    a235 ^ a246 ^ a256 ^ a345 ^ a346 ^ a356 ^ a1234 ^ a1235 ^
+	    a1236 ^ a1245 ^ a1256 ^ a1345 ^ a1346 ^ a2456 ^ a3456 ^
+	    a12356 ^ a13456;
+}
+
+static void des_bs_s6(des_bs_word * l, des_bs_word a1, des_bs_word a2,
+		      des_bs_word a3, des_bs_word a4, des_bs_word a5,
+		      des_bs_word a6)
+{
+	des_bs_word a12 = a1 & a2;
+	des_bs_word a13 = a1 & a3;
+	des_bs_word a14 = a1 & a4;
+	des_bs_word a15 = a1 & a5;
+	des_bs_word a16 = a1 & a6;
+	des_bs_word a23 = a2 & a3;
+	des_bs_word a24 = a2 & a4;
+	des_bs_word a25 = a2 & a5;
+	des_bs_word a34 = a3 & a4;
+	des_bs_word a35 = a3 & a5;
+	des_bs_word a36 = a3 & a6;
+	des_bs_word a45 = a4 & a5;
+	des_bs_word a46 = a4 & a6;
+	des_bs_word a56 = a5 & a6;
+	des_bs_word a123 = a12 & a3;
+	des_bs_word a124 = a12 & a4;
+	des_bs_word a126 = a12 & a6;
+	des_bs_word a134 = a13 & a4;
+	des_bs_word a135 = a13 & a5;
+	des_bs_word a136 = a13 & a6;
+	des_bs_word a145 = a14 & a5;
+	des_bs_word a146 = a14 & a6;
+	des_bs_word a156 = a15 & a6;
+	des_bs_word a234 = a23 & a4;
+	des_bs_word a235 = a23 & a5;
+	des_bs_word a245 = a24 & a5;
+	des_bs_word a256 = a25 & a6;
+	des_bs_word a345 = a34 & a5;
+	des_bs_word a346 = a34 & a6;
+	des_bs_word a356 = a35 & a6;
+	des_bs_word a456 = a45 & a6;
+	des_bs_word a1234 = a123 & a4;
+	des_bs_word a1235 = a123 & a5;
+	des_bs_word a1236 = a123 & a6;
+	des_bs_word a1245 = a124 & a5;
+	des_bs_word a1246 = a124 & a6;
+	des_bs_word a1345 = a134 & a5;
+	des_bs_word a1346 = a134 & a6;
+	des_bs_word a1356 = a135 & a6;
+	des_bs_word a1456 = a145 & a6;
+	des_bs_word a2346 = a234 & a6;
+	des_bs_word a2456 = a245 & a6;
+	des_bs_word a3456 = a345 & a6;
+	des_bs_word a12346 = a1234 & a6;
+	des_bs_word a12356 = a1235 & a6;
+	des_bs_word a12456 = a1245 & a6;
+	des_bs_word a13456 = a1345 & a6;
+
+	l[3] ^= ~a2 ^ a5 ^ a13 ^ a15 ^ a16 ^ a23 ^ a34 ^ a36 ^ a45 ^
+	    a46 ^ a56 ^ a135 ^ a136 ^ a146 ^ a156 ^ a345 ^ a346 ^ a356 ^
+	    a456 ^ a1236 ^ a1246 ^ a1356 ^ a1456 ^ a2346 ^ a3456 ^
+	    a12346 ^ a12356 ^ a12456;
+	l[28] ^= ~a1 ^ a2 ^ a3 ^ a4 ^ a5 ^ a6 ^ a13 ^ a24 ^ a35 ^ a123 ^
+	    a136 ^ a145 ^ a345 ^ a1235 ^ a1236 ^ a1245 ^ a1345 ^ a1356 ^
+	    a1456 ^ a2456 ^ a12346 ^ a12356;
+	l[10] ^= a4 ^ a6 ^ a12 ^ a13 ^ a15 ^ a16 ^ a23 ^ a35 ^ a123 ^
+	    a135 ^ a136 ^ a235 ^ a245 ^ a256 ^ a456 ^ a1245 ^ a1356 ^
+	    a1456 ^ a12356 ^ a12456;
+	l[18] ^= a1 ^ a3 ^ a5 ^ a16 ^ a23 ^ a24 ^ a34 ^ a126 ^ a134 ^
+	    a135 ^ a145 ^ a234 ^ a345 ^ a346 ^ a456 ^ a1236 ^ a1246 ^
+	    a1345 ^ a1346 ^ a1456 ^ a2346 ^ a2456 ^ a3456 ^ a12456 ^
+	    a13456;
+}
+
+static void des_bs_s7(des_bs_word * l, des_bs_word a1, des_bs_word a2,
+		      des_bs_word a3, des_bs_word a4, des_bs_word a5,
+		      des_bs_word a6)
+{
+	des_bs_word a12 = a1 & a2;
+	des_bs_word a13 = a1 & a3;
+	des_bs_word a14 = a1 & a4;
+	des_bs_word a15 = a1 & a5;
+	des_bs_word a16 = a1 & a6;
+	des_bs_word a23 = a2 & a3;
+	des_bs_word a24 = a2 & a4;
+	des_bs_word a26 = a2 & a6;
+	des_bs_word a34 = a3 & a4;
+	des_bs_word a36 = a3 & a6;
+	des_bs_word a45 = a4 & a5;
+	des_bs_word a56 = a5 & a6;
+	des_bs_word a123 = a12 & a3;
+	des_bs_word a124 = a12 & a4;
+	des_bs_word a125 = a12 & a5;
+	des_bs_word a134 = a13 & a4;
+	des_bs_word a135 = a13 & a5;
+	des_bs_word a136 = a13 & a6;
+	des_bs_word a145 = a14 & a5;
+	des_bs_word a146 = a14 & a6;
+	des_bs_word a156 = a15 & a6;
+	des_bs_word a234 = a23 & a4;
+	des_bs_word a236 = a23 & a6;
+	des_bs_word a245 = a24 & a5;
+	des_bs_word a246 = a24 & a6;
+	des_bs_word a345 = a34 & a5;
+	des_bs_word a346 = a34 & a6;
+	des_bs_word a456 = a45 & a6;
+	des_bs_word a1234 = a123 & a4;
+	des_bs_word a1235 = a123 & a5;
+	des_bs_word a1236 = a123 & a6;
+	des_bs_word a1245 = a124 & a5;
+	des_bs_word a1246 = a124 & a6;
+	des_bs_word a1256 = a125 & a6;
+	des_bs_word a1345 = a134 & a5;
+	des_bs_word a1346 = a134 & a6;
+	des_bs_word a1356 = a135 & a6;
+	des_bs_word a1456 = a145 & a6;
+	des_bs_word a2346 = a234 & a6;
+	des_bs_word a2456 = a245 & a6;
+	des_bs_word a3456 = a345 & a6;
+	des_bs_word a12346 = a1234 & a6;
+	des_bs_word a12356 = a1235 & a6;
+	des_bs_word a12456 = a1245 & a6;
+	des_bs_word a13456 = a1345 & a6;
+
+	l[31] ^= a3 ^ a5 ^ a6 ^ a12 ^ a14 ^ a15 ^ a16 ^ a23 ^ a24 ^
+	    a123 ^ a124 ^ a135 ^ a136 ^ a156 ^ a234 ^ a236 ^ a345 ^
+	    a1234 ^ a1235 ^ a1236 ^ a1245 ^ a1345 ^ a1456 ^ a2346 ^
+	    a3456 ^ a12346 ^ a13456;
+	l[11] ^= ~a1 ^ a2 ^ a4 ^ a5 ^ a12 ^ a13 ^ a14 ^ a16 ^ a23 ^
+	    a24 ^ a26 ^ a1234 ^ a1236 ^ a1246 ^ a1345 ^ a2456 ^ a3456 ^
+	    a12456;
+	l[21] ^= a2 ^ a3 ^ a4 ^ a5 ^ a13 ^ a15 ^ a16 ^ a36 ^ a45 ^ a56 ^
+	    a123 ^ a124 ^ a135 ^ a156 ^ a245 ^ a346 ^ a456 ^ a1235 ^
+	    a1236 ^ a1245 ^ a1346 ^ a1356 ^ a2346 ^ a2456 ^ a3456 ^
+	    a12346 ^ a12356 ^ a13456;
+	l[6] ^= a1 ^ a2 ^ a3 ^ a5 ^ a6 ^ a23 ^ a34 ^ a45 ^ a146 ^ a246 ^
+	    a345 ^ a1236 ^ a1246 ^ a1256 ^ a1346 ^ a1456 ^ a2456 ^
+	    a13456;
+}
+
+static void des_bs_s8(des_bs_word * l, des_bs_word a1, des_bs_word a2,
+		      des_bs_word a3, des_bs_word a4, des_bs_word a5,
+		      des_bs_word a6)
+{
+	des_bs_word a12 = a1 & a2;
+	des_bs_word a13 = a1 & a3;
+	des_bs_word a14 = a1 & a4;
+	des_bs_word a15 = a1 & a5;
+	des_bs_word a16 = a1 & a6;
+	des_bs_word a23 = a2 & a3;
+	des_bs_word a24 = a2 & a4;
+	des_bs_word a25 = a2 & a5;
+	des_bs_word a26 = a2 & a6;
+	des_bs_word a34 = a3 & a4;
+	des_bs_word a35 = a3 & a5;
+	des_bs_word a45 = a4 & a5;
+	des_bs_word a46 = a4 & a6;
+	des_bs_word a56 = a5 & a6;
+	des_bs_word a123 = a12 & a3;
+	des_bs_word a124 = a12 & a4;
+	des_bs_word a125 = a12 & a5;
+	des_bs_word a134 = a13 & a4;
+	des_bs_word a135 = a13 & a5;
+	des_bs_word a136 = a13 & a6;
+	des_bs_word a145 = a14 & a5;
+	des_bs_word a146 = a14 & a6;
+	des_bs_word a156 = a15 & a6;
+	des_bs_word a234 = a23 & a4;
+	des_bs_word a236 = a23 & a6;
+	des_bs_word a245 = a24 & a5;
+	des_bs_word a246 = a24 & a6;
+	des_bs_word a256 = a25 & a6;
+	des_bs_word a345 = a34 & a5;
+	des_bs_word a346 = a34 & a6;
+	des_bs_word a356 = a35 & a6;
+	des_bs_word a456 = a45 & a6;
+	des_bs_word a1234 = a123 & a4;
+	des_bs_word a1235 = a123 & a5;
+	des_bs_word a1236 = a123 & a6;
+	des_bs_word a1245 = a124 & a5;
+	des_bs_word a1246 = a124 & a6;
+	des_bs_word a1256 = a125 & a6;
+	des_bs_word a1346 = a134 & a6;
+	des_bs_word a1356 = a135 & a6;
+	des_bs_word a1456 = a145 & a6;
+	des_bs_word a2346 = a234 & a6;
+	des_bs_word a2456 = a245 & a6;
+	des_bs_word a3456 = a345 & a6;
+	des_bs_word a12346 = a1234 & a6;
+	des_bs_word a12356 = a1235 & a6;
+	des_bs_word a12456 = a1245 & a6;
+
+	l[4] ^= ~a1 ^ a3 ^ a5 ^ a6 ^ a16 ^ a24 ^ a25 ^ a26 ^ a34 ^ a46 ^
+	    a134 ^ a135 ^ a136 ^ a145 ^ a156 ^ a234 ^ a245 ^ a246 ^
+	    a256 ^ a346 ^ a456 ^ a1234 ^ a1236 ^ a1246 ^ a1346 ^ a1456 ^
+	    a2346 ^ a12346 ^ a12356 ^ a12456;
+	l[26] ^= ~a2 ^ a4 ^ a5 ^ a6 ^ a13 ^ a14 ^ a23 ^ a24 ^ a25 ^
+	    a35 ^ a123 ^ a124 ^ a125 ^ a134 ^ a135 ^ a146 ^ a156 ^
+	    a245 ^ a1234 ^ a1245 ^ a1346 ^ a1356 ^ a12346;
+	l[14] ^= a1 ^ a2 ^ a3 ^ a5 ^ a14 ^ a15 ^ a26 ^ a35 ^ a45 ^
+	    a125 ^ a135 ^ a145 ^ a146 ^ a156 ^ a236 ^ a246 ^ a256 ^
+	    a1235 ^ a1456 ^ a2346 ^ a2456 ^ a12356 ^ a12456;
+	l[20] ^= ~a2 ^ a3 ^ a4 ^ a5 ^ a13 ^ a15 ^ a16 ^ a45 ^ a46 ^
+	    a56 ^ a123 ^ a124 ^ a135 ^ a236 ^ a245 ^ a256 ^ a346 ^
+	    a356 ^ a1235 ^ a1245 ^ a1246 ^ a1256 ^ a1346 ^ a1356 ^
+	    a1456 ^ a3456 ^ a12346 ^ a12356;
+}
+
+static void des_bs_round(des_bs_word * l, const des_bs_word * r,
+			 const des_bs_word * k)
+{
+	des_bs_s1(l, r[31] ^ k[0], r[0] ^ k[1], r[1] ^ k[2], r[2] ^ k[3],
+		  r[3] ^ k[4], r[4] ^ k[5]);
+	des_bs_s2(l, r[3] ^ k[6], r[4] ^ k[7], r[5] ^ k[8], r[6] ^ k[9],
+		  r[7] ^ k[10], r[8] ^ k[11]);
+	des_bs_s3(l, r[7] ^ k[12], r[8] ^ k[13], r[9] ^ k[14], r[10] ^ k[15],
+		  r[11] ^ k[16], r[12] ^ k[17]);
+	des_bs_s4(l, r[11] ^ k[18], r[12] ^ k[19], r[13] ^ k[20],
+		  r[14] ^ k[21], r[15] ^ k[22], r[16] ^ k[23]);
+	des_bs_s5(l, r[15] ^ k[24], r[16] ^ k[25], r[17] ^ k[26],
+		  r[18] ^ k[27], r[19] ^ k[28], r[20] ^ k[29]);
+	des_bs_s6(l, r[19] ^ k[30], r[20] ^ k[31], r[21] ^ k[32],
+		  r[22] ^ k[33], r[23] ^ k[34], r[24] ^ k[35]);
+	des_bs_s7(l, r[23] ^ k[36], r[24] ^ k[37], r[25] ^ k[38],
+		  r[26] ^ k[39], r[27] ^ k[40], r[28] ^ k[41]);
+	des_bs_s8(l, r[27] ^ k[42], r[28] ^ k[43], r[29] ^ k[44],
+		  r[30] ^ k[45], r[31] ^ k[46], r[0] ^ k[47]);
+}
+
+/* The subkeys as words of all zero or all one bits */
+static void des_bs_key(char kn[16][8], des_bs_word k[16][48])
+{
+	unsigned long long m;
+	int i, j, g;
+
+	for (i = 0; i < 16; i++) {
+		for (j = 0; j < 48; j++) {
+			m = 0 - (unsigned long long)
+			    ((kn[i][j / 6] >> (5 - j % 6)) & 1);
+			for (g = 0; g < DES_BS_LANES; g++)
+				DES_BS_LANE(k[i][j], g) = m;
+		}
+	}
+}
+
+/* The 16 rounds on the halves a (initially the left one) and b. The
+ * halves are not swapped at the end, so a and b again hold left and
+ * right as far as a following encryption or decryption is concerned,
+ * while the output block is b followed by a.
+ */
+static void des_bs_rounds(des_bs_word * a, des_bs_word * b,
+			  des_bs_word k[16][48], int decrypt)
+{
+	int i;
+
+	if (decrypt) {
+		for (i = 15; i > 0; i -= 2) {
+			des_bs_round(a, b, k[i]);
+			des_bs_round(b, a, k[i - 1]);
+		}
+	} else {
+		for (i = 0; i < 16; i += 2) {
+			des_bs_round(a, b, k[i]);
+			des_bs_round(b, a, k[i + 1]);
+		}
+	}
+}
+
+/* Transposes a 64x64 bit matrix: bit 63 - j of x[i] is swapped with
+ * bit 63 - i of x[j].
+ */
+static void des_bs_transpose(unsigned long long *x)
+{
+	unsigned long long m, t;
+	int j, k;
+
+	for (j = 32, m = 0x00000000ffffffffULL; j != 0;
+	     j >>= 1, m ^= m << j) {
+		for (k = 0; k < 64; k = ((k | j) + 1) & ~j) {
+			t = (x[k] ^ (x[k | j] >> j)) & m;
+			x[k] ^= t;
+			x[k | j] ^= t << j;
+		}
+	}
+}
+
+/* Moves n (at most DES_BS_BLOCKS) blocks, given as pairs of halves
+ * that have already been through IP, into the words hi[] and lo[].
+ * The unused block positions are zero.
+ */
+static void des_bs_load(des_bs_word * hi, des_bs_word * lo,
+			const word32 * half, int n)
+{
+	unsigned long long x[64];
+	int i, g;
+
+	for (g = 0; g < DES_BS_LANES; g++, half += 128, n -= 64) {
+		for (i = 0; i < 64; i++)
+			x[i] = i < n ? ((unsigned long long) half[2 * i] << 32)
+			    | half[2 * i + 1] : 0;
+		des_bs_transpose(x);
+		for (i = 0; i < 32; i++) {
+			DES_BS_LANE(hi[i], g) = x[i];
+			DES_BS_LANE(lo[i], g) = x[i + 32];
+		}
+	}
+}
+
+/* The reverse of des_bs_load(); FP is left to the caller */
+static void des_bs_store(word32 * half, const des_bs_word * hi,
+			 const des_bs_word * lo, int n)
+{
+	unsigned long long x[64];
+	int i, g;
+
+	for (g = 0; g < DES_BS_LANES && n > 0; g++, half += 128, n -= 64) {
+		for (i = 0; i < 32; i++) {
+			x[i] = DES_BS_LANE(hi[i], g);
+			x[i + 32] = DES_BS_LANE(lo[i], g);
+		}
+		des_bs_transpose(x);
+		for (i = 0; i < 64 && i < n; i++) {
+			half[2 * i] = (word32) (x[i] >> 32);
+			half[2 * i + 1] = (word32) x[i];
+		}
+	}
+}
+
+#endif
@@ -40,10 +40,13 @@
 #include <libdefs.h>
 
 #include <mcrypt_modules.h>
+#include "gost_sbox.h"
 
 #define _mcrypt_set_key gost_LTX__mcrypt_set_key
 #define _mcrypt_encrypt gost_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt gost_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks gost_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks gost_LTX__mcrypt_decrypt_blocks
 #define _mcrypt_get_size gost_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size gost_LTX__mcrypt_get_block_size
 #define _is_block_algorithm gost_LTX__is_block_algorithm
@@ -53,8 +56,6 @@
 #define _mcrypt_self_test gost_LTX__mcrypt_self_test
 #define _mcrypt_algorithm_version gost_LTX__mcrypt_algorithm_version
 
-void _mcrypt_kboxinit(void);
-
 /*
  * The standard does not specify the contents of the 8 4 bit->4 bit
  * substitution boxes, saying they're a parameter of the network
@@ -75,9 +76,11 @@ void _mcrypt_kboxinit(void);
  * found in Applied Cryptography book by Bruce Schneier. These were
  * used in an application for the Central Bank of the Russian Federation
  * --Nikos
+ *
+ * They are for reference only; f() uses them through the combined
+ * table gost_sbox[][] in gost_sbox.h.
  */
-static int init = 0;
-
+#ifdef notdef
 static unsigned char const gost_k1[16] = {
 	1, 15, 13, 0, 5, 7, 10, 4, 9, 2, 3, 14, 6, 11, 8, 2
 };
@@ -102,22 +105,10 @@ static unsigned char const gost_k7[16] = {
 static unsigned char const gost_k8[16] = {
 	4, 10, 9, 2, 13, 8, 0, 14, 6, 11, 1, 12, 7, 15, 5, 3
 };
-
-/* Byte-at-a-time substitution boxes */
-static unsigned char gost_k87[256];
-static unsigned char gost_k65[256];
-static unsigned char gost_k43[256];
-static unsigned char gost_k21[256];
-
-/*
- * Build byte-at-a-time subtitution tables.
- * This must be called once for global setup.
- */
+#endif
 
 WIN32DLL_DEFINE int _mcrypt_set_key(word32 * inst, word32 * key, int len)
 {
-
-	_mcrypt_kboxinit();
 	inst[0] = 0;
 	inst[1] = 0;
 	inst[2] = 0;
@@ -140,49 +131,16 @@ WIN32DLL_DEFINE int _mcrypt_set_key(word32 * inst, word32 * key, int len)
 	return 0;
 }
 
-void _mcrypt_kboxinit(void)
-{
-	int i;
-
-	if (init == 0) {
-		init = 1;
-		for (i = 0; i < 256; i++) {
-			gost_k87[i] = gost_k8[i >> 4] << 4 | gost_k7[i & 15];
-			gost_k65[i] = gost_k6[i >> 4] << 4 | gost_k5[i & 15];
-			gost_k43[i] = gost_k4[i >> 4] << 4 | gost_k3[i & 15];
-			gost_k21[i] = gost_k2[i >> 4] << 4 | gost_k1[i & 15];
-		}
-	}
-
-}
-
 /*
  * Do the substitution and rotation that are the core of the operation,
  * like the expansion, substitution and permutation of the DES.
- * It would be possible to perform DES-like optimisations and store
- * the table entries as 32-bit words, already rotated, but the
- * efficiency gain is questionable.
- *
- * This should be inlined for maximum speed
+ * As in the DES, the table entries are stored as 32-bit words,
+ * already rotated, so this is just four lookups.
  */
 static word32 f(word32 x)
 {
-	/* Do substitutions */
-# if 0
-	/* This is annoyingly slow */
-	x = k8[x >> 28 & 15] << 28 | k7[x >> 24 & 15] << 24 |
-	    k6[x >> 20 & 15] << 20 | k5[x >> 16 & 15] << 16 |
-	    k4[x >> 12 & 15] << 12 | k3[x >> 8 & 15] << 8 |
-	    k2[x >> 4 & 15] << 4 | k1[x & 15];
-# else
-	/* This is faster */
-	x = gost_k87[x >> 24 & 255] << 24 | gost_k65[x >> 16 & 255] << 16 |
-	    gost_k43[x >> 8 & 255] << 8 | gost_k21[x & 255];
-# endif
-
-	/* Rotate left 11 bits */
-	return x << 11 | x >> (32 - 11);
-
+	return gost_sbox[3][x >> 24] ^ gost_sbox[2][x >> 16 & 255] ^
+	    gost_sbox[1][x >> 8 & 255] ^ gost_sbox[0][x & 255];
 }
 
 /*
@@ -320,6 +278,113 @@ WIN32DLL_DEFINE void _mcrypt_decrypt(word32 const key[8], word32 * in)
 
 }
 
+/*
+ * Four blocks at once. The rounds of one block form a single chain of
+ * dependent lookups, so running independent blocks side by side lets
+ * the processor overlap them.
+ */
+#define ROUND4(a, b, k) \
+	a[0] ^= f(b[0] + (k)); \
+	a[1] ^= f(b[1] + (k)); \
+	a[2] ^= f(b[2] + (k)); \
+	a[3] ^= f(b[3] + (k))
+
+/* The key table once forward and once backward */
+#define FORWARD4 \
+	ROUND4(n2, n1, key[0]); ROUND4(n1, n2, key[1]); \
+	ROUND4(n2, n1, key[2]); ROUND4(n1, n2, key[3]); \
+	ROUND4(n2, n1, key[4]); ROUND4(n1, n2, key[5]); \
+	ROUND4(n2, n1, key[6]); ROUND4(n1, n2, key[7])
+
+#define BACKWARD4 \
+	ROUND4(n2, n1, key[7]); ROUND4(n1, n2, key[6]); \
+	ROUND4(n2, n1, key[5]); ROUND4(n1, n2, key[4]); \
+	ROUND4(n2, n1, key[3]); ROUND4(n1, n2, key[2]); \
+	ROUND4(n2, n1, key[1]); ROUND4(n1, n2, key[0])
+
+#ifndef WORDS_BIGENDIAN
+# define LOAD4 \
+	for (i = 0; i < 4; i++) { \
+		n1[i] = byteswap32(in[2 * i]); \
+		n2[i] = byteswap32(in[2 * i + 1]); \
+	}
+# define STORE4 \
+	for (i = 0; i < 4; i++) { \
+		out[2 * i] = byteswap32(n2[i]); \
+		out[2 * i + 1] = byteswap32(n1[i]); \
+	}
+#else
+# define LOAD4 \
+	for (i = 0; i < 4; i++) { \
+		n1[i] = in[2 * i]; \
+		n2[i] = in[2 * i + 1]; \
+	}
+# define STORE4 \
+	for (i = 0; i < 4; i++) { \
+		out[2 * i] = n2[i]; \
+		out[2 * i + 1] = n1[i]; \
+	}
+#endif
+
+static void gost_encrypt4(word32 const key[8], const word32 * in,
+			  word32 * out)
+{
+	word32 n1[4], n2[4];
+	int i;
+
+	LOAD4;
+	FORWARD4;
+	FORWARD4;
+	FORWARD4;
+	BACKWARD4;
+	STORE4;
+}
+
+static void gost_decrypt4(word32 const key[8], const word32 * in,
+			  word32 * out)
+{
+	word32 n1[4], n2[4];
+	int i;
+
+	LOAD4;
+	FORWARD4;
+	BACKWARD4;
+	BACKWARD4;
+	BACKWARD4;
+	STORE4;
+}
+
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the
+ * two may be the same buffer but must not otherwise overlap
+ */
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(word32 const key[8],
+					    const word32 * in, word32 * out,
+					    int nblocks)
+{
+	for (; nblocks >= 4; nblocks -= 4, in += 8, out += 8)
+		gost_encrypt4(key, in, out);
+
+	for (; nblocks > 0; nblocks--, in += 2, out += 2) {
+		out[0] = in[0];
+		out[1] = in[1];
+		_mcrypt_encrypt(key, out);
+	}
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(word32 const key[8],
+					    const word32 * in, word32 * out,
+					    int nblocks)
+{
+	for (; nblocks >= 4; nblocks -= 4, in += 8, out += 8)
+		gost_decrypt4(key, in, out);
+
+	for (; nblocks > 0; nblocks--, in += 2, out += 2) {
+		out[0] = in[0];
+		out[1] = in[1];
+		_mcrypt_decrypt(key, out);
+	}
+}
+
 WIN32DLL_DEFINE int _mcrypt_get_size()
 {
 	return 8 * sizeof(word32);
@@ -360,6 +425,7 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	int blocksize = _mcrypt_get_block_size(), j;
 	void *key;
 	unsigned char cipher_tmp[200];
+	word32 blocks[7 * 2];
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -398,10 +464,35 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* the interleaved code must agree with the one above */
+	for (j = 0; j < 7 * 8; j++) {
+		((unsigned char *) blocks)[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 7 * 8);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 7);
+	for (j = 0; j < 7; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 7 * 8) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 7);
+	for (j = 0; j < 7; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 7 * 8) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
@@ -550,17 +550,51 @@ WIN32DLL_DEFINE
 	return 0;
 }
 
+/* number of blocks _mcrypt_encrypt() passes to pan_pull() at once */
+#define PAN_BULK_BLOCKS 16
+
 WIN32DLL_DEFINE void _mcrypt_encrypt(PANAMA_KEY * pan_key,	/* the key from pan_init */
 				     byte * buf,	/* input array                         */
 				     int length)
 {				/* length to be encrypted, in bits     */
-	int i;
+	word32 w[PAN_BULK_BLOCKS * PAN_STAGE_SIZE];
+	int i, n;
 #ifdef WORDS_BIGENDIAN
 	int j;
 #endif
 
-/* initialize the Panama state machine for a fresh crypting operation */
-	for (i = 0; i < length; i++) {
+	/* use up the key material left from the previous call */
+	for (i = 0; i < length && pan_key->keymat_pointer < 32; i++) {
+		buf[i] ^= pan_key->keymat[pan_key->keymat_pointer];
+		pan_key->keymat_pointer++;
+	}
+
+	/* whole blocks are XORed by pan_pull() itself, many at a time.
+	 * They go through w[] as buf need not be aligned.
+	 */
+	while (length - i >= 32) {
+		n = (length - i) / 32;
+		if (n > PAN_BULK_BLOCKS)
+			n = PAN_BULK_BLOCKS;
+
+		memcpy(w, &buf[i], 32 * n);
+#ifdef WORDS_BIGENDIAN
+		for (j = 0; j < n * PAN_STAGE_SIZE; j++) {
+			w[j] = byteswap32(w[j]);
+		}
+#endif
+		pan_pull(w, w, n, &pan_key->buffer, &pan_key->state);
+#ifdef WORDS_BIGENDIAN
+		for (j = 0; j < n * PAN_STAGE_SIZE; j++) {
+			w[j] = byteswap32(w[j]);
+		}
+#endif
+		memcpy(&buf[i], w, 32 * n);
+		i += 32 * n;
+	}
+
+	/* and the tail byte by byte */
+	for (; i < length; i++) {
 
 		if (pan_key->keymat_pointer == 32) {
 			pan_pull(NULL, (void *) pan_key->wkeymat, 1,
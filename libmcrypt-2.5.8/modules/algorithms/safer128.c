@@ -31,10 +31,14 @@
 
 #include <mcrypt_modules.h>
 #include "safer.h"
+#include "simd.h"
+#include "safer_simd.h"
 
 #define _mcrypt_set_key safer_sk128_LTX__mcrypt_set_key
 #define _mcrypt_encrypt safer_sk128_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt safer_sk128_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks safer_sk128_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks safer_sk128_LTX__mcrypt_decrypt_blocks
 #define _mcrypt_get_size safer_sk128_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size safer_sk128_LTX__mcrypt_get_block_size
 #define _is_block_algorithm safer_sk128_LTX__is_block_algorithm
@@ -295,6 +299,48 @@ WIN32DLL_DEFINE
 
 /******************************************************************************/
 
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the
+ * two may be the same buffer but must not otherwise overlap
+ */
+WIN32DLL_DEFINE
+    void _mcrypt_encrypt_blocks(const safer_key_t * key,
+				const safer_block_t * in, safer_block_t * out,
+				int nblocks)
+{
+#ifdef MCRYPT_X86_SIMD
+	if (nblocks >= 8 && x86_has_ssse3()) {
+		for (; nblocks >= 8; nblocks -= 8, in += 64, out += 64)
+			safer_sk_encrypt8(key, in, out, exp_tab128, log_tab128);
+	}
+#endif
+	for (; nblocks > 0; nblocks--, in += 8, out += 8) {
+		if (out != in)
+			memcpy(out, in, 8);
+		_mcrypt_encrypt(key, out);
+	}
+}
+
+WIN32DLL_DEFINE
+    void _mcrypt_decrypt_blocks(const safer_key_t * key,
+				const safer_block_t * in, safer_block_t * out,
+				int nblocks)
+{
+#ifdef MCRYPT_X86_SIMD
+	if (nblocks >= 8 && x86_has_ssse3()) {
+		for (; nblocks >= 8; nblocks -= 8, in += 64, out += 64)
+			safer_sk_decrypt8(key, in, out, exp_tab128, log_tab128);
+	}
+#endif
+	for (; nblocks > 0; nblocks--, in += 8, out += 8) {
+		if (out != in)
+			memcpy(out, in, 8);
+		_mcrypt_decrypt(key, out);
+	}
+}
+
+/******************************************************************************/
+
+
 WIN32DLL_DEFINE int _mcrypt_get_size()
 {
 	return (1 + SAFER_BLOCK_LEN * (1 + 2 * SAFER_MAX_NOF_ROUNDS));
@@ -335,6 +381,7 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	int blocksize = _mcrypt_get_block_size(), j;
 	void *key;
 	unsigned char cipher_tmp[200];
+	unsigned char blocks[19 * 8];
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -372,10 +419,35 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* the multi-block kernels must agree with the one above */
+	for (j = 0; j < 19 * 8; j++) {
+		blocks[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 19 * 8);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 19);
+	for (j = 0; j < 19; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 19 * 8) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 19);
+	for (j = 0; j < 19; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[8 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 19 * 8) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
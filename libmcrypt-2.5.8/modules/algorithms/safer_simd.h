@@ -0,0 +1,267 @@
+/* SSSE3 rounds shared by SAFER+ (saferplus.c) and SAFER SK-64/SK-128
+ * (safer64.c, safer128.c). A 16 byte register holds one SAFER+ block
+ * or two SAFER-SK blocks. The key mixing and the Pseudo-Hadamard
+ * Transforms work on all the bytes at once, the permutations between
+ * them are byte shuffles, and only the exponent and logarithm boxes
+ * are looked up a byte at a time.
+ *
+ * simd.h must be included first.
+ */
+
+#ifdef MCRYPT_X86_SIMD
+
+/* In both ciphers bytes 0 and 3 of every four are the ones that are
+ * xored with the first round key and go through the exponent box when
+ * encrypting; bytes 1 and 2 are added and go through the logarithm.
+ */
+#define SAFER_E _mm_set1_epi32(0xff0000ff)
+
+/* A layer of PHTs on pairs of bytes. idx gives every byte the other
+ * one of its pair, and a selects the first byte of each pair: that
+ * one becomes 2x + y and the second one x + y.
+ */
+#define SAFER_PHT(x, idx, a) \
+	x = _mm_add_epi8(_mm_add_epi8(x, _mm_shuffle_epi8(x, idx)), \
+			 _mm_and_si128(x, a))
+
+/* Its inverse; b selects the second byte of each pair. */
+#define SAFER_IPHT(x, idx, b) \
+	x = _mm_add_epi8(_mm_sub_epi8(x, _mm_shuffle_epi8(x, idx)), \
+			 _mm_and_si128(x, b))
+
+/* Looks up bytes 0 and 3 of every four in p and the others in q. The
+ * bytes are taken out of general purpose registers, which is cheaper
+ * than going through memory.
+ */
+#ifdef __x86_64__
+
+typedef unsigned long long safer_word;
+
+#define SAFER_LOOKUP8(v, p, q) \
+	((safer_word) p[v & 255] | \
+	 (safer_word) q[(v >> 8) & 255] << 8 | \
+	 (safer_word) q[(v >> 16) & 255] << 16 | \
+	 (safer_word) p[(v >> 24) & 255] << 24 | \
+	 (safer_word) p[(v >> 32) & 255] << 32 | \
+	 (safer_word) q[(v >> 40) & 255] << 40 | \
+	 (safer_word) q[(v >> 48) & 255] << 48 | \
+	 (safer_word) p[v >> 56] << 56)
+
+X86_TARGET("ssse3")
+static __m128i safer_lookup(__m128i x, const unsigned char *p,
+			    const unsigned char *q)
+{
+	safer_word lo = _mm_cvtsi128_si64(x);
+	safer_word hi = _mm_cvtsi128_si64(_mm_unpackhi_epi64(x, x));
+
+	return _mm_set_epi64x(SAFER_LOOKUP8(hi, p, q),
+			      SAFER_LOOKUP8(lo, p, q));
+}
+
+#else
+
+#define SAFER_LOOKUP4(v, p, q) \
+	((word32) p[v & 255] | \
+	 (word32) q[(v >> 8) & 255] << 8 | \
+	 (word32) q[(v >> 16) & 255] << 16 | \
+	 (word32) p[v >> 24] << 24)
+
+X86_TARGET("ssse3")
+static __m128i safer_lookup(__m128i x, const unsigned char *p,
+			    const unsigned char *q)
+{
+	word32 w0 = _mm_cvtsi128_si32(x);
+	word32 w1 = _mm_cvtsi128_si32(_mm_srli_si128(x, 4));
+	word32 w2 = _mm_cvtsi128_si32(_mm_srli_si128(x, 8));
+	word32 w3 = _mm_cvtsi128_si32(_mm_srli_si128(x, 12));
+
+	return _mm_set_epi32(SAFER_LOOKUP4(w3, p, q),
+			     SAFER_LOOKUP4(w2, p, q),
+			     SAFER_LOOKUP4(w1, p, q),
+			     SAFER_LOOKUP4(w0, p, q));
+}
+
+#endif
+
+/* The key mixing and the boxes of one round; k1 and k2 are the two
+ * round keys.
+ */
+X86_TARGET("ssse3")
+static __m128i safer_sbox(__m128i x, __m128i k1, __m128i k2,
+			  const unsigned char *exp, const unsigned char *log)
+{
+	__m128i e = SAFER_E;
+
+	x = _mm_add_epi8(_mm_xor_si128(x, _mm_and_si128(k1, e)),
+			 _mm_andnot_si128(e, k1));
+	x = safer_lookup(x, exp, log);
+	return _mm_xor_si128(_mm_add_epi8(x, _mm_and_si128(k2, e)),
+			     _mm_andnot_si128(e, k2));
+}
+
+X86_TARGET("ssse3")
+static __m128i safer_inv_sbox(__m128i x, __m128i k1, __m128i k2,
+			      const unsigned char *exp,
+			      const unsigned char *log)
+{
+	__m128i e = SAFER_E;
+
+	x = _mm_xor_si128(_mm_sub_epi8(x, _mm_and_si128(k2, e)),
+			  _mm_andnot_si128(e, k2));
+	x = safer_lookup(x, log, exp);
+	return _mm_sub_epi8(_mm_xor_si128(x, _mm_and_si128(k1, e)),
+			    _mm_andnot_si128(e, k1));
+}
+
+/* The key mixing after the last round, and its inverse */
+#define SAFER_LAST_KEY(x, k) \
+	x = _mm_add_epi8(_mm_xor_si128(x, _mm_and_si128(k, SAFER_E)), \
+			 _mm_andnot_si128(SAFER_E, k))
+#define SAFER_INV_LAST_KEY(x, k) \
+	x = _mm_sub_epi8(_mm_xor_si128(x, _mm_and_si128(k, SAFER_E)), \
+			 _mm_andnot_si128(SAFER_E, k))
+
+#ifdef SAFER_H
+
+/* SAFER-SK, with two blocks in a register: the shuffles of the three
+ * PHT layers, each followed by the mask of the first bytes of the
+ * pairs; the permutation at the end of a round and its inverse; and
+ * the masks of the second bytes of the pairs.
+ */
+static const unsigned char safer_sk_shuffle[11][16] = {
+	{ 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+	{ 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0 },
+	{ 2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13 },
+	{ 0xff, 0xff, 0, 0, 0xff, 0xff, 0, 0, 0xff, 0xff, 0, 0, 0xff, 0xff, 0, 0 },
+	{ 4, 5, 6, 7, 0, 1, 2, 3, 12, 13, 14, 15, 8, 9, 10, 11 },
+	{ 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0 },
+	{ 0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15 },
+	{ 0, 2, 4, 6, 1, 3, 5, 7, 8, 10, 12, 14, 9, 11, 13, 15 },
+	{ 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff },
+	{ 0, 0, 0xff, 0xff, 0, 0, 0xff, 0xff, 0, 0, 0xff, 0xff, 0, 0, 0xff, 0xff },
+	{ 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff }
+};
+
+X86_TARGET("ssse3")
+static void safer_sk_tables(__m128i * sh)
+{
+	int i;
+
+	for (i = 0; i < 11; i++)
+		sh[i] = _mm_loadu_si128((const __m128i *) safer_sk_shuffle[i]);
+}
+
+/* 8 key bytes, in both halves of a register */
+X86_TARGET("ssse3")
+static __m128i safer_sk_key(const unsigned char *key)
+{
+	__m128i k = _mm_loadl_epi64((const __m128i *) key);
+
+	return _mm_unpacklo_epi64(k, k);
+}
+
+X86_TARGET("ssse3")
+static __m128i safer_sk_round(__m128i x, const unsigned char *key,
+			      const __m128i * sh, const unsigned char *exp,
+			      const unsigned char *log)
+{
+	x = safer_sbox(x, safer_sk_key(key), safer_sk_key(key + 8),
+		       exp, log);
+	SAFER_PHT(x, sh[0], sh[1]);
+	SAFER_PHT(x, sh[2], sh[3]);
+	SAFER_PHT(x, sh[4], sh[5]);
+	return _mm_shuffle_epi8(x, sh[6]);
+}
+
+X86_TARGET("ssse3")
+static __m128i safer_sk_inv_round(__m128i x, const unsigned char *key,
+				  const __m128i * sh,
+				  const unsigned char *exp,
+				  const unsigned char *log)
+{
+	x = _mm_shuffle_epi8(x, sh[7]);
+	SAFER_IPHT(x, sh[4], sh[10]);
+	SAFER_IPHT(x, sh[2], sh[9]);
+	SAFER_IPHT(x, sh[0], sh[8]);
+	return safer_inv_sbox(x, safer_sk_key(key), safer_sk_key(key + 8),
+			      exp, log);
+}
+
+/* Eight blocks at a time, in four registers: the lookups of one block
+ * depend on each other, so the processor gets to overlap the others.
+ */
+X86_TARGET("ssse3")
+static void safer_sk_encrypt8(const unsigned char *key,
+			      const unsigned char *in, unsigned char *out,
+			      const unsigned char *exp,
+			      const unsigned char *log)
+{
+	__m128i sh[11], x0, x1, x2, x3, k;
+	unsigned int round;
+
+	safer_sk_tables(sh);
+	x0 = _mm_loadu_si128((const __m128i *) in);
+	x1 = _mm_loadu_si128((const __m128i *) (in + 16));
+	x2 = _mm_loadu_si128((const __m128i *) (in + 32));
+	x3 = _mm_loadu_si128((const __m128i *) (in + 48));
+
+	if (SAFER_MAX_NOF_ROUNDS < (round = *key))
+		round = SAFER_MAX_NOF_ROUNDS;
+	for (key++; round > 0; round--, key += 2 * SAFER_BLOCK_LEN) {
+		x0 = safer_sk_round(x0, key, sh, exp, log);
+		x1 = safer_sk_round(x1, key, sh, exp, log);
+		x2 = safer_sk_round(x2, key, sh, exp, log);
+		x3 = safer_sk_round(x3, key, sh, exp, log);
+	}
+	k = safer_sk_key(key);
+	SAFER_LAST_KEY(x0, k);
+	SAFER_LAST_KEY(x1, k);
+	SAFER_LAST_KEY(x2, k);
+	SAFER_LAST_KEY(x3, k);
+
+	_mm_storeu_si128((__m128i *) out, x0);
+	_mm_storeu_si128((__m128i *) (out + 16), x1);
+	_mm_storeu_si128((__m128i *) (out + 32), x2);
+	_mm_storeu_si128((__m128i *) (out + 48), x3);
+}
+
+X86_TARGET("ssse3")
+static void safer_sk_decrypt8(const unsigned char *key,
+			      const unsigned char *in, unsigned char *out,
+			      const unsigned char *exp,
+			      const unsigned char *log)
+{
+	__m128i sh[11], x0, x1, x2, x3, k;
+	unsigned int round;
+
+	safer_sk_tables(sh);
+	x0 = _mm_loadu_si128((const __m128i *) in);
+	x1 = _mm_loadu_si128((const __m128i *) (in + 16));
+	x2 = _mm_loadu_si128((const __m128i *) (in + 32));
+	x3 = _mm_loadu_si128((const __m128i *) (in + 48));
+
+	if (SAFER_MAX_NOF_ROUNDS < (round = *key))
+		round = SAFER_MAX_NOF_ROUNDS;
+	key += 1 + 2 * SAFER_BLOCK_LEN * round;
+	k = safer_sk_key(key);
+	SAFER_INV_LAST_KEY(x0, k);
+	SAFER_INV_LAST_KEY(x1, k);
+	SAFER_INV_LAST_KEY(x2, k);
+	SAFER_INV_LAST_KEY(x3, k);
+	for (; round > 0; round--) {
+		key -= 2 * SAFER_BLOCK_LEN;
+		x0 = safer_sk_inv_round(x0, key, sh, exp, log);
+		x1 = safer_sk_inv_round(x1, key, sh, exp, log);
+		x2 = safer_sk_inv_round(x2, key, sh, exp, log);
+		x3 = safer_sk_inv_round(x3, key, sh, exp, log);
+	}
+
+	_mm_storeu_si128((__m128i *) out, x0);
+	_mm_storeu_si128((__m128i *) (out + 16), x1);
+	_mm_storeu_si128((__m128i *) (out + 32), x2);
+	_mm_storeu_si128((__m128i *) (out + 48), x3);
+}
+
+#endif /* SAFER_H */
+
+#endif /* MCRYPT_X86_SIMD */
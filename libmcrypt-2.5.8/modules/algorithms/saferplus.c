@@ -67,11 +67,14 @@ Mean:         3392 cycles =     7.5 mbits/sec
 
 #include <mcrypt_modules.h>
 #include "saferplus.h"
+#include "simd.h"
 #include <stdlib.h>
 
 #define _mcrypt_set_key saferplus_LTX__mcrypt_set_key
 #define _mcrypt_encrypt saferplus_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt saferplus_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks saferplus_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks saferplus_LTX__mcrypt_decrypt_blocks
 #define _mcrypt_get_size saferplus_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size saferplus_LTX__mcrypt_get_block_size
 #define _is_block_algorithm saferplus_LTX__is_block_algorithm
@@ -588,6 +591,171 @@ WIN32DLL_DEFINE void _mcrypt_decrypt(SPI * spi, word32 * _blk)
 
 
 
+#include "safer_simd.h"
+
+#ifdef MCRYPT_X86_SIMD
+
+/* The PHT layers of do_fr() as byte shuffles: the other byte of the */
+/* pair of every byte in each of the four layers, and then the       */
+/* permutation at the end of the round and its inverse.              */
+
+static const byte sp_shuffle[6][16] = {
+	{ 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14 },
+	{ 7, 2, 1, 4, 3, 6, 5, 0, 11, 10, 9, 8, 15, 14, 13, 12 },
+	{ 3, 6, 15, 0, 7, 8, 1, 4, 5, 14, 13, 12, 11, 10, 9, 2 },
+	{ 13, 10, 5, 12, 9, 2, 11, 14, 15, 4, 1, 6, 3, 0, 7, 8 },
+	{ 14, 7, 8, 15, 0, 13, 6, 11, 4, 9, 2, 5, 10, 1, 12, 3 },
+	{ 4, 13, 10, 15, 8, 11, 6, 1, 2, 9, 12, 7, 14, 5, 0, 3 }
+};
+
+#define sp_rounds(spi)  \
+    ((spi)->k_bytes > 24 ? 16 : (spi)->k_bytes > 16 ? 12 : 8)
+
+/* the bytes of a block in the order do_fr() numbers them */
+#define sp_load(p)      \
+    _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *) (p)), 0x1b)
+#define sp_store(p,x)   \
+    _mm_storeu_si128((__m128i *) (p), _mm_shuffle_epi32(x, 0x1b))
+
+X86_TARGET("ssse3")
+static __m128i sp_fr(__m128i x, const byte * kp, const __m128i * sh)
+{
+	__m128i even = _mm_set1_epi16(0x00ff);
+
+	x = safer_sbox(x, _mm_loadu_si128((const __m128i *) kp),
+		       _mm_loadu_si128((const __m128i *) (kp + 16)),
+		       safer_expf, safer_logf);
+	SAFER_PHT(x, sh[0], even);
+	SAFER_PHT(x, sh[1], even);
+	SAFER_PHT(x, sh[2], even);
+	SAFER_PHT(x, sh[3], even);
+	return _mm_shuffle_epi8(x, sh[4]);
+}
+
+X86_TARGET("ssse3")
+static __m128i sp_ir(__m128i x, const byte * kp, const __m128i * sh)
+{
+	__m128i odd = _mm_set1_epi16(0xff00);
+
+	x = _mm_shuffle_epi8(x, sh[5]);
+	SAFER_IPHT(x, sh[3], odd);
+	SAFER_IPHT(x, sh[2], odd);
+	SAFER_IPHT(x, sh[1], odd);
+	SAFER_IPHT(x, sh[0], odd);
+	return safer_inv_sbox(x, _mm_loadu_si128((const __m128i *) kp),
+			      _mm_loadu_si128((const __m128i *) (kp + 16)),
+			      safer_expf, safer_logf);
+}
+
+/* Four blocks at a time: the lookups of one block depend on each    */
+/* other, so the processor gets to overlap those of the others.      */
+
+X86_TARGET("ssse3")
+static void sp_encrypt4(SPI * spi, const word32 * in, word32 * out)
+{
+	__m128i sh[6], x0, x1, x2, x3, k;
+	byte *kp = spi->l_key;
+	int i;
+
+	for (i = 0; i < 6; i++)
+		sh[i] = _mm_loadu_si128((const __m128i *) sp_shuffle[i]);
+
+	x0 = sp_load(in);
+	x1 = sp_load(in + 4);
+	x2 = sp_load(in + 8);
+	x3 = sp_load(in + 12);
+
+	for (i = sp_rounds(spi); i > 0; i--, kp += 32) {
+		x0 = sp_fr(x0, kp, sh);
+		x1 = sp_fr(x1, kp, sh);
+		x2 = sp_fr(x2, kp, sh);
+		x3 = sp_fr(x3, kp, sh);
+	}
+
+	k = _mm_loadu_si128((const __m128i *) kp);
+	SAFER_LAST_KEY(x0, k);
+	SAFER_LAST_KEY(x1, k);
+	SAFER_LAST_KEY(x2, k);
+	SAFER_LAST_KEY(x3, k);
+
+	sp_store(out, x0);
+	sp_store(out + 4, x1);
+	sp_store(out + 8, x2);
+	sp_store(out + 12, x3);
+}
+
+X86_TARGET("ssse3")
+static void sp_decrypt4(SPI * spi, const word32 * in, word32 * out)
+{
+	__m128i sh[6], x0, x1, x2, x3, k;
+	byte *kp = spi->l_key + 16 * spi->k_bytes;
+	int i;
+
+	for (i = 0; i < 6; i++)
+		sh[i] = _mm_loadu_si128((const __m128i *) sp_shuffle[i]);
+
+	x0 = sp_load(in);
+	x1 = sp_load(in + 4);
+	x2 = sp_load(in + 8);
+	x3 = sp_load(in + 12);
+
+	k = _mm_loadu_si128((const __m128i *) kp);
+	SAFER_INV_LAST_KEY(x0, k);
+	SAFER_INV_LAST_KEY(x1, k);
+	SAFER_INV_LAST_KEY(x2, k);
+	SAFER_INV_LAST_KEY(x3, k);
+
+	for (i = sp_rounds(spi); i > 0; i--) {
+		kp -= 32;
+		x0 = sp_ir(x0, kp, sh);
+		x1 = sp_ir(x1, kp, sh);
+		x2 = sp_ir(x2, kp, sh);
+		x3 = sp_ir(x3, kp, sh);
+	}
+
+	sp_store(out, x0);
+	sp_store(out + 4, x1);
+	sp_store(out + 8, x2);
+	sp_store(out + 12, x3);
+}
+
+#endif /* MCRYPT_X86_SIMD */
+
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the */
+/* two may be the same buffer but must not otherwise overlap      */
+
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(SPI * spi, const word32 * in,
+					    word32 * out, int nblocks)
+{
+#ifdef MCRYPT_X86_SIMD
+	if (nblocks >= 4 && x86_has_ssse3()) {
+		for (; nblocks >= 4; nblocks -= 4, in += 16, out += 16)
+			sp_encrypt4(spi, in, out);
+	}
+#endif
+	for (; nblocks > 0; nblocks--, in += 4, out += 4) {
+		if (out != in)
+			memcpy(out, in, 16);
+		_mcrypt_encrypt(spi, out);
+	}
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(SPI * spi, const word32 * in,
+					    word32 * out, int nblocks)
+{
+#ifdef MCRYPT_X86_SIMD
+	if (nblocks >= 4 && x86_has_ssse3()) {
+		for (; nblocks >= 4; nblocks -= 4, in += 16, out += 16)
+			sp_decrypt4(spi, in, out);
+	}
+#endif
+	for (; nblocks > 0; nblocks--, in += 4, out += 4) {
+		if (out != in)
+			memcpy(out, in, 16);
+		_mcrypt_decrypt(spi, out);
+	}
+}
+
 WIN32DLL_DEFINE int _mcrypt_get_size()
 {
 	return sizeof(SPI);
@@ -625,7 +793,8 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	unsigned char ciphertext[16];
 	int blocksize = _mcrypt_get_block_size(), j;
 	void *key;
-	unsigned char cipher_tmp[200];
+	unsigned char cipher_tmp[250];
+	word32 blocks[13 * 4];
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -662,10 +831,35 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* the multi-block kernels must agree with the one above */
+	for (j = 0; j < 13 * 16; j++) {
+		((unsigned char *) blocks)[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 13 * 16);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[16 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 13 * 16) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[16 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 13 * 16) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
@@ -43,10 +43,13 @@ Mean:          941 cycles =    27.2 mbits/sec
 
 #include <mcrypt_modules.h>
 #include "serpent.h"
+#include "simd.h"
 
 #define _mcrypt_set_key serpent_LTX__mcrypt_set_key
 #define _mcrypt_encrypt serpent_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt serpent_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks serpent_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks serpent_LTX__mcrypt_decrypt_blocks
 #define _mcrypt_get_size serpent_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size serpent_LTX__mcrypt_get_block_size
 #define _is_block_algorithm serpent_LTX__is_block_algorithm
@@ -455,6 +458,205 @@ Mean:          941 cycles =    27.2 mbits/sec
     c = rotr32(c, 3);     \
     a = rotr32(a, 13)
 
+/* the 32 rounds, parameterised on the linear transformation so */
+/* that the same sequence serves the scalar and SIMD code      */
+
+#define encrypt_rounds(ROT) \
+	k_xor(0, a, b, c, d); \
+	sb0(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(1, e, f, g, h); \
+	sb1(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(2, a, b, c, d); \
+	sb2(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(3, e, f, g, h); \
+	sb3(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(4, a, b, c, d); \
+	sb4(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(5, e, f, g, h); \
+	sb5(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(6, a, b, c, d); \
+	sb6(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(7, e, f, g, h); \
+	sb7(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(8, a, b, c, d); \
+	sb0(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(9, e, f, g, h); \
+	sb1(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(10, a, b, c, d); \
+	sb2(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(11, e, f, g, h); \
+	sb3(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(12, a, b, c, d); \
+	sb4(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(13, e, f, g, h); \
+	sb5(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(14, a, b, c, d); \
+	sb6(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(15, e, f, g, h); \
+	sb7(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(16, a, b, c, d); \
+	sb0(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(17, e, f, g, h); \
+	sb1(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(18, a, b, c, d); \
+	sb2(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(19, e, f, g, h); \
+	sb3(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(20, a, b, c, d); \
+	sb4(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(21, e, f, g, h); \
+	sb5(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(22, a, b, c, d); \
+	sb6(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(23, e, f, g, h); \
+	sb7(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(24, a, b, c, d); \
+	sb0(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(25, e, f, g, h); \
+	sb1(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(26, a, b, c, d); \
+	sb2(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(27, e, f, g, h); \
+	sb3(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(28, a, b, c, d); \
+	sb4(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(29, e, f, g, h); \
+	sb5(e, f, g, h, a, b, c, d); \
+	ROT(a, b, c, d); \
+	k_xor(30, a, b, c, d); \
+	sb6(a, b, c, d, e, f, g, h); \
+	ROT(e, f, g, h); \
+	k_xor(31, e, f, g, h); \
+	sb7(e, f, g, h, a, b, c, d); \
+	k_xor(32, a, b, c, d);
+
+#define decrypt_rounds(IROT) \
+	k_xor(32, a, b, c, d); \
+	ib7(a, b, c, d, e, f, g, h); \
+	k_xor(31, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib6(e, f, g, h, a, b, c, d); \
+	k_xor(30, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib5(a, b, c, d, e, f, g, h); \
+	k_xor(29, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib4(e, f, g, h, a, b, c, d); \
+	k_xor(28, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib3(a, b, c, d, e, f, g, h); \
+	k_xor(27, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib2(e, f, g, h, a, b, c, d); \
+	k_xor(26, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib1(a, b, c, d, e, f, g, h); \
+	k_xor(25, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib0(e, f, g, h, a, b, c, d); \
+	k_xor(24, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib7(a, b, c, d, e, f, g, h); \
+	k_xor(23, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib6(e, f, g, h, a, b, c, d); \
+	k_xor(22, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib5(a, b, c, d, e, f, g, h); \
+	k_xor(21, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib4(e, f, g, h, a, b, c, d); \
+	k_xor(20, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib3(a, b, c, d, e, f, g, h); \
+	k_xor(19, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib2(e, f, g, h, a, b, c, d); \
+	k_xor(18, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib1(a, b, c, d, e, f, g, h); \
+	k_xor(17, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib0(e, f, g, h, a, b, c, d); \
+	k_xor(16, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib7(a, b, c, d, e, f, g, h); \
+	k_xor(15, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib6(e, f, g, h, a, b, c, d); \
+	k_xor(14, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib5(a, b, c, d, e, f, g, h); \
+	k_xor(13, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib4(e, f, g, h, a, b, c, d); \
+	k_xor(12, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib3(a, b, c, d, e, f, g, h); \
+	k_xor(11, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib2(e, f, g, h, a, b, c, d); \
+	k_xor(10, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib1(a, b, c, d, e, f, g, h); \
+	k_xor(9, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib0(e, f, g, h, a, b, c, d); \
+	k_xor(8, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib7(a, b, c, d, e, f, g, h); \
+	k_xor(7, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib6(e, f, g, h, a, b, c, d); \
+	k_xor(6, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib5(a, b, c, d, e, f, g, h); \
+	k_xor(5, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib4(e, f, g, h, a, b, c, d); \
+	k_xor(4, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib3(a, b, c, d, e, f, g, h); \
+	k_xor(3, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib2(e, f, g, h, a, b, c, d); \
+	k_xor(2, a, b, c, d); \
+	IROT(a, b, c, d); \
+	ib1(a, b, c, d, e, f, g, h); \
+	k_xor(1, e, f, g, h); \
+	IROT(e, f, g, h); \
+	ib0(e, f, g, h, a, b, c, d); \
+	k_xor(0, a, b, c, d);
+
 /* initialise the key schedule from the user supplied key   */
 
 WIN32DLL_DEFINE
@@ -624,102 +826,7 @@ WIN32DLL_DEFINE void _mcrypt_encrypt(SERPENT_KEY * spkey, word32 * in_blk)
 	d = in_blk[3];
 #endif
 
-	k_xor(0, a, b, c, d);
-	sb0(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(1, e, f, g, h);
-	sb1(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(2, a, b, c, d);
-	sb2(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(3, e, f, g, h);
-	sb3(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(4, a, b, c, d);
-	sb4(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(5, e, f, g, h);
-	sb5(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(6, a, b, c, d);
-	sb6(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(7, e, f, g, h);
-	sb7(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(8, a, b, c, d);
-	sb0(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(9, e, f, g, h);
-	sb1(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(10, a, b, c, d);
-	sb2(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(11, e, f, g, h);
-	sb3(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(12, a, b, c, d);
-	sb4(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(13, e, f, g, h);
-	sb5(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(14, a, b, c, d);
-	sb6(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(15, e, f, g, h);
-	sb7(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(16, a, b, c, d);
-	sb0(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(17, e, f, g, h);
-	sb1(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(18, a, b, c, d);
-	sb2(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(19, e, f, g, h);
-	sb3(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(20, a, b, c, d);
-	sb4(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(21, e, f, g, h);
-	sb5(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(22, a, b, c, d);
-	sb6(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(23, e, f, g, h);
-	sb7(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(24, a, b, c, d);
-	sb0(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(25, e, f, g, h);
-	sb1(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(26, a, b, c, d);
-	sb2(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(27, e, f, g, h);
-	sb3(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(28, a, b, c, d);
-	sb4(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(29, e, f, g, h);
-	sb5(e, f, g, h, a, b, c, d);
-	rot(a, b, c, d);
-	k_xor(30, a, b, c, d);
-	sb6(a, b, c, d, e, f, g, h);
-	rot(e, f, g, h);
-	k_xor(31, e, f, g, h);
-	sb7(e, f, g, h, a, b, c, d);
-	k_xor(32, a, b, c, d);
+	encrypt_rounds(rot);
 
 #ifdef WORDS_BIGENDIAN
 	in_blk[0] = byteswap32(a);
@@ -754,102 +861,7 @@ WIN32DLL_DEFINE void _mcrypt_decrypt(SERPENT_KEY * spkey, word32 * in_blk)
 	d = in_blk[3];
 #endif
 
-	k_xor(32, a, b, c, d);
-	ib7(a, b, c, d, e, f, g, h);
-	k_xor(31, e, f, g, h);
-	irot(e, f, g, h);
-	ib6(e, f, g, h, a, b, c, d);
-	k_xor(30, a, b, c, d);
-	irot(a, b, c, d);
-	ib5(a, b, c, d, e, f, g, h);
-	k_xor(29, e, f, g, h);
-	irot(e, f, g, h);
-	ib4(e, f, g, h, a, b, c, d);
-	k_xor(28, a, b, c, d);
-	irot(a, b, c, d);
-	ib3(a, b, c, d, e, f, g, h);
-	k_xor(27, e, f, g, h);
-	irot(e, f, g, h);
-	ib2(e, f, g, h, a, b, c, d);
-	k_xor(26, a, b, c, d);
-	irot(a, b, c, d);
-	ib1(a, b, c, d, e, f, g, h);
-	k_xor(25, e, f, g, h);
-	irot(e, f, g, h);
-	ib0(e, f, g, h, a, b, c, d);
-	k_xor(24, a, b, c, d);
-	irot(a, b, c, d);
-	ib7(a, b, c, d, e, f, g, h);
-	k_xor(23, e, f, g, h);
-	irot(e, f, g, h);
-	ib6(e, f, g, h, a, b, c, d);
-	k_xor(22, a, b, c, d);
-	irot(a, b, c, d);
-	ib5(a, b, c, d, e, f, g, h);
-	k_xor(21, e, f, g, h);
-	irot(e, f, g, h);
-	ib4(e, f, g, h, a, b, c, d);
-	k_xor(20, a, b, c, d);
-	irot(a, b, c, d);
-	ib3(a, b, c, d, e, f, g, h);
-	k_xor(19, e, f, g, h);
-	irot(e, f, g, h);
-	ib2(e, f, g, h, a, b, c, d);
-	k_xor(18, a, b, c, d);
-	irot(a, b, c, d);
-	ib1(a, b, c, d, e, f, g, h);
-	k_xor(17, e, f, g, h);
-	irot(e, f, g, h);
-	ib0(e, f, g, h, a, b, c, d);
-	k_xor(16, a, b, c, d);
-	irot(a, b, c, d);
-	ib7(a, b, c, d, e, f, g, h);
-	k_xor(15, e, f, g, h);
-	irot(e, f, g, h);
-	ib6(e, f, g, h, a, b, c, d);
-	k_xor(14, a, b, c, d);
-	irot(a, b, c, d);
-	ib5(a, b, c, d, e, f, g, h);
-	k_xor(13, e, f, g, h);
-	irot(e, f, g, h);
-	ib4(e, f, g, h, a, b, c, d);
-	k_xor(12, a, b, c, d);
-	irot(a, b, c, d);
-	ib3(a, b, c, d, e, f, g, h);
-	k_xor(11, e, f, g, h);
-	irot(e, f, g, h);
-	ib2(e, f, g, h, a, b, c, d);
-	k_xor(10, a, b, c, d);
-	irot(a, b, c, d);
-	ib1(a, b, c, d, e, f, g, h);
-	k_xor(9, e, f, g, h);
-	irot(e, f, g, h);
-	ib0(e, f, g, h, a, b, c, d);
-	k_xor(8, a, b, c, d);
-	irot(a, b, c, d);
-	ib7(a, b, c, d, e, f, g, h);
-	k_xor(7, e, f, g, h);
-	irot(e, f, g, h);
-	ib6(e, f, g, h, a, b, c, d);
-	k_xor(6, a, b, c, d);
-	irot(a, b, c, d);
-	ib5(a, b, c, d, e, f, g, h);
-	k_xor(5, e, f, g, h);
-	irot(e, f, g, h);
-	ib4(e, f, g, h, a, b, c, d);
-	k_xor(4, a, b, c, d);
-	irot(a, b, c, d);
-	ib3(a, b, c, d, e, f, g, h);
-	k_xor(3, e, f, g, h);
-	irot(e, f, g, h);
-	ib2(e, f, g, h, a, b, c, d);
-	k_xor(2, a, b, c, d);
-	irot(a, b, c, d);
-	ib1(a, b, c, d, e, f, g, h);
-	k_xor(1, e, f, g, h);
-	irot(e, f, g, h);
-	ib0(e, f, g, h, a, b, c, d);
-	k_xor(0, a, b, c, d);
+	decrypt_rounds(irot);
 
 #ifdef WORDS_BIGENDIAN
 	in_blk[0] = byteswap32(a);
@@ -865,6 +877,168 @@ WIN32DLL_DEFINE void _mcrypt_decrypt(SERPENT_KEY * spkey, word32 * in_blk)
 }
 
 
+#ifdef MCRYPT_X86_SIMD
+
+/* Several blocks at once: lane j of a, b, c and d holds the words  */
+/* of block j, so the S box circuits and the linear transformation  */
+/* run unchanged on 4 (SSE2) or 8 (AVX2) blocks per instruction.    */
+
+#define vrot(a,b,c,d)   \
+    a = vrotl32(a, 13);   \
+    c = vrotl32(c, 3);    \
+    d ^= c ^ (a << 3);  \
+    b ^= a ^ c;         \
+    d = vrotl32(d, 7);    \
+    b = vrotl32(b, 1);    \
+    a ^= b ^ d;         \
+    c ^= d ^ (b << 7);  \
+    a = vrotl32(a, 5);    \
+    c = vrotl32(c, 22)
+
+#define virot(a,b,c,d)  \
+    c = vrotr32(c, 22);   \
+    a = vrotr32(a, 5);    \
+    c ^= d ^ (b << 7);  \
+    a ^= b ^ d;         \
+    d = vrotr32(d, 7);    \
+    b = vrotr32(b, 1);    \
+    d ^= c ^ (a << 3);  \
+    b ^= a ^ c;         \
+    c = vrotr32(c, 3);    \
+    a = vrotr32(a, 13)
+
+#define load4(in)	\
+    a = (v4word32) _mm_loadu_si128((const __m128i *) &in[0]);  \
+    b = (v4word32) _mm_loadu_si128((const __m128i *) &in[4]);  \
+    c = (v4word32) _mm_loadu_si128((const __m128i *) &in[8]);  \
+    d = (v4word32) _mm_loadu_si128((const __m128i *) &in[12]); \
+    transpose4x4_sse2(a, b, c, d)
+
+#define store4(out,a,b,c,d)	\
+    transpose4x4_sse2(a, b, c, d); \
+    _mm_storeu_si128((__m128i *) &out[0], (__m128i) a);  \
+    _mm_storeu_si128((__m128i *) &out[4], (__m128i) b);  \
+    _mm_storeu_si128((__m128i *) &out[8], (__m128i) c);  \
+    _mm_storeu_si128((__m128i *) &out[12], (__m128i) d)
+
+/* Each 256 bit row holds two consecutive blocks, so the in-lane    */
+/* transposition leaves blocks 0,2,4,6 in the low halves and        */
+/* 1,3,5,7 in the high ones; store8 undoes exactly that.            */
+
+#define load8(in)	\
+    a = (v8word32) _mm256_loadu_si256((const __m256i *) &in[0]);  \
+    b = (v8word32) _mm256_loadu_si256((const __m256i *) &in[8]);  \
+    c = (v8word32) _mm256_loadu_si256((const __m256i *) &in[16]); \
+    d = (v8word32) _mm256_loadu_si256((const __m256i *) &in[24]); \
+    transpose4x4_avx2(a, b, c, d)
+
+#define store8(out,a,b,c,d)	\
+    transpose4x4_avx2(a, b, c, d); \
+    _mm256_storeu_si256((__m256i *) &out[0], (__m256i) a);  \
+    _mm256_storeu_si256((__m256i *) &out[8], (__m256i) b);  \
+    _mm256_storeu_si256((__m256i *) &out[16], (__m256i) c); \
+    _mm256_storeu_si256((__m256i *) &out[24], (__m256i) d)
+
+X86_TARGET("sse2")
+static void serpent_encrypt4(SERPENT_KEY * spkey, const word32 * in,
+			     word32 * out)
+{
+	v4word32 a, b, c, d, e, f, g, h;
+	v4word32 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13,
+	    t14, t15, t16;
+
+	load4(in);
+	encrypt_rounds(vrot);
+	store4(out, a, b, c, d);
+}
+
+X86_TARGET("sse2")
+static void serpent_decrypt4(SERPENT_KEY * spkey, const word32 * in,
+			     word32 * out)
+{
+	v4word32 a, b, c, d, e, f, g, h;
+	v4word32 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13,
+	    t14, t15, t16;
+
+	load4(in);
+	decrypt_rounds(virot);
+	store4(out, a, b, c, d);
+}
+
+X86_TARGET("avx2")
+static void serpent_encrypt8(SERPENT_KEY * spkey, const word32 * in,
+			     word32 * out)
+{
+	v8word32 a, b, c, d, e, f, g, h;
+	v8word32 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13,
+	    t14, t15, t16;
+
+	load8(in);
+	encrypt_rounds(vrot);
+	store8(out, a, b, c, d);
+}
+
+X86_TARGET("avx2")
+static void serpent_decrypt8(SERPENT_KEY * spkey, const word32 * in,
+			     word32 * out)
+{
+	v8word32 a, b, c, d, e, f, g, h;
+	v8word32 t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13,
+	    t14, t15, t16;
+
+	load8(in);
+	decrypt_rounds(virot);
+	store8(out, a, b, c, d);
+}
+
+#endif /* MCRYPT_X86_SIMD */
+
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the */
+/* two may be the same buffer but must not otherwise overlap      */
+
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(SERPENT_KEY * spkey,
+					    const word32 * in,
+					    word32 * out, int nblocks)
+{
+#ifdef MCRYPT_X86_SIMD
+	if (nblocks >= 8 && x86_has_avx2()) {
+		for (; nblocks >= 8; nblocks -= 8, in += 32, out += 32)
+			serpent_encrypt8(spkey, in, out);
+	}
+	if (nblocks >= 4 && x86_has_sse2()) {
+		for (; nblocks >= 4; nblocks -= 4, in += 16, out += 16)
+			serpent_encrypt4(spkey, in, out);
+	}
+#endif
+	for (; nblocks > 0; nblocks--, in += 4, out += 4) {
+		if (out != in)
+			memcpy(out, in, 16);
+		_mcrypt_encrypt(spkey, out);
+	}
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(SERPENT_KEY * spkey,
+					    const word32 * in,
+					    word32 * out, int nblocks)
+{
+#ifdef MCRYPT_X86_SIMD
+	if (nblocks >= 8 && x86_has_avx2()) {
+		for (; nblocks >= 8; nblocks -= 8, in += 32, out += 32)
+			serpent_decrypt8(spkey, in, out);
+	}
+	if (nblocks >= 4 && x86_has_sse2()) {
+		for (; nblocks >= 4; nblocks -= 4, in += 16, out += 16)
+			serpent_decrypt4(spkey, in, out);
+	}
+#endif
+	for (; nblocks > 0; nblocks--, in += 4, out += 4) {
+		if (out != in)
+			memcpy(out, in, 16);
+		_mcrypt_decrypt(spkey, out);
+	}
+}
+
+
 WIN32DLL_DEFINE int _mcrypt_get_size()
 {
 	return sizeof(SERPENT_KEY);
@@ -904,7 +1078,8 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	unsigned char ciphertext[16];
 	int blocksize = _mcrypt_get_block_size(), j;
 	void *key;
-	unsigned char cipher_tmp[200];
+	unsigned char cipher_tmp[13 * 16];
+	word32 blocks[13 * 4];
 
 	keyword = calloc(1, _mcrypt_get_key_size());
 	if (keyword == NULL)
@@ -942,10 +1117,35 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (strcmp(ciphertext, plaintext) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* the multi-block kernels must agree with the one above */
+	for (j = 0; j < 13 * 16; j++) {
+		((unsigned char *) blocks)[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 13 * 16);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[16 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 13 * 16) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 13);
+	for (j = 0; j < 13; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[16 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 13 * 16) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
@@ -0,0 +1,67 @@
+/* Support for the optional SIMD kernels of the algorithm modules,
+ * and of the GCM mode.
+ *
+ * The kernels are compiled with per-function target attributes, so
+ * the modules themselves need no special CFLAGS, and are selected at
+ * run time with x86_has_sse2(), x86_has_ssse3(), x86_has_avx2() or
+ * x86_has_pclmul().
+ * On every other compiler or architecture MCRYPT_X86_SIMD is left
+ * undefined and the modules use their portable code only.
+ */
+
+#ifndef MCRYPT_SIMD_H
+#define MCRYPT_SIMD_H
+
+#if (defined(__i386__) || defined(__x86_64__)) && \
+    (defined(__clang__) || __GNUC__ > 4 || \
+     (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+
+# define MCRYPT_X86_SIMD 1
+# include <immintrin.h>
+
+# define X86_TARGET(x) __attribute__ ((target (x)))
+
+# define x86_has_sse2() __builtin_cpu_supports("sse2")
+# define x86_has_ssse3() __builtin_cpu_supports("ssse3")
+# define x86_has_avx2() __builtin_cpu_supports("avx2")
+# define x86_has_pclmul() __builtin_cpu_supports("pclmul")
+
+/* 32 bit lanes; the usual C operators (and shifts by a scalar)
+ * work on these, so the boolean circuits of the scalar code can be
+ * reused unchanged.
+ */
+typedef word32 v4word32 __attribute__ ((vector_size (16)));
+typedef word32 v8word32 __attribute__ ((vector_size (32)));
+
+# define vrotl32(x,n) (((x) << (n)) | ((x) >> (32 - (n))))
+# define vrotr32(x,n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/* Transposes four rows of four 32 bit words, so that word i of every
+ * row ends up in row i. Applying it twice gives back the input.
+ */
+# define transpose4x4_sse2(a,b,c,d) do { \
+	__m128i _t0 = _mm_unpacklo_epi32((__m128i) (a), (__m128i) (b)); \
+	__m128i _t1 = _mm_unpacklo_epi32((__m128i) (c), (__m128i) (d)); \
+	__m128i _t2 = _mm_unpackhi_epi32((__m128i) (a), (__m128i) (b)); \
+	__m128i _t3 = _mm_unpackhi_epi32((__m128i) (c), (__m128i) (d)); \
+	(a) = (v4word32) _mm_unpacklo_epi64(_t0, _t1); \
+	(b) = (v4word32) _mm_unpackhi_epi64(_t0, _t1); \
+	(c) = (v4word32) _mm_unpacklo_epi64(_t2, _t3); \
+	(d) = (v4word32) _mm_unpackhi_epi64(_t2, _t3); \
+	} while(0)
+
+/* The same inside each 128 bit half of four 256 bit rows. */
+# define transpose4x4_avx2(a,b,c,d) do { \
+	__m256i _t0 = _mm256_unpacklo_epi32((__m256i) (a), (__m256i) (b)); \
+	__m256i _t1 = _mm256_unpacklo_epi32((__m256i) (c), (__m256i) (d)); \
+	__m256i _t2 = _mm256_unpackhi_epi32((__m256i) (a), (__m256i) (b)); \
+	__m256i _t3 = _mm256_unpackhi_epi32((__m256i) (c), (__m256i) (d)); \
+	(a) = (v8word32) _mm256_unpacklo_epi64(_t0, _t1); \
+	(b) = (v8word32) _mm256_unpackhi_epi64(_t0, _t1); \
+	(c) = (v8word32) _mm256_unpacklo_epi64(_t2, _t3); \
+	(d) = (v8word32) _mm256_unpackhi_epi64(_t2, _t3); \
+	} while(0)
+
+#endif
+
+#endif
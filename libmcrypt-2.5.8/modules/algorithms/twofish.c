@@ -48,10 +48,15 @@
 
 #include <mcrypt_modules.h>
 #include "twofish.h"
+#if defined(Q_TABLES) || defined(M_TABLE)
+#include "twofish_tables.h"
+#endif
 
 #define _mcrypt_set_key twofish_LTX__mcrypt_set_key
 #define _mcrypt_encrypt twofish_LTX__mcrypt_encrypt
 #define _mcrypt_decrypt twofish_LTX__mcrypt_decrypt
+#define _mcrypt_encrypt_blocks twofish_LTX__mcrypt_encrypt_blocks
+#define _mcrypt_decrypt_blocks twofish_LTX__mcrypt_decrypt_blocks
 #define _mcrypt_get_size twofish_LTX__mcrypt_get_size
 #define _mcrypt_get_block_size twofish_LTX__mcrypt_get_block_size
 #define _is_block_algorithm twofish_LTX__is_block_algorithm
@@ -127,17 +132,7 @@ byte qp(const word32 n, const byte x)
 
 #ifdef  Q_TABLES
 
-#define q(n,x)  pkey->q_tab[n][x]
-
-void gen_qtab(TWI * pkey)
-{
-	word32 i;
-
-	for (i = 0; i < 256; ++i) {
-		q(0, i) = qp(0, (byte) i);
-		q(1, i) = qp(1, (byte) i);
-	}
-}
+#define q(n,x)  tw_q_tab[n][x]
 
 #else
 
@@ -147,30 +142,7 @@ void gen_qtab(TWI * pkey)
 
 #ifdef  M_TABLE
 
-void gen_mtab(TWI * pkey)
-{
-	word32 i, f01, f5b, fef;
-
-	for (i = 0; i < 256; ++i) {
-		f01 = q(1, i);
-		f5b = ffm_5b(f01);
-		fef = ffm_ef(f01);
-		pkey->m_tab[0][i] =
-		    f01 + (f5b << 8) + (fef << 16) + (fef << 24);
-		pkey->m_tab[2][i] =
-		    f5b + (fef << 8) + (f01 << 16) + (fef << 24);
-
-		f01 = q(0, i);
-		f5b = ffm_5b(f01);
-		fef = ffm_ef(f01);
-		pkey->m_tab[1][i] =
-		    fef + (fef << 8) + (f5b << 16) + (f01 << 24);
-		pkey->m_tab[3][i] =
-		    f5b + (f01 << 8) + (fef << 16) + (f5b << 24);
-	}
-}
-
-#define mds(n,x)    pkey->m_tab[n][x]
+#define mds(n,x)    tw_m_tab[n][x]
 
 #else
 
@@ -429,23 +401,6 @@ WIN32DLL_DEFINE
 {
 	word32 i, a, b, me_key[4], mo_key[4];
 
-#ifdef Q_TABLES
-	pkey->qt_gen = 0;
-
-	if (!pkey->qt_gen) {
-		gen_qtab(pkey);
-		pkey->qt_gen = 1;
-	}
-#endif
-
-#ifdef M_TABLE
-	pkey->mt_gen = 0;
-	if (!pkey->mt_gen) {
-		gen_mtab(pkey);
-		pkey->mt_gen = 1;
-	}
-#endif
-
 	pkey->k_len = (key_len * 8) / 64;	/* 2, 3 or 4 */
 
 	for (i = 0; i < pkey->k_len; ++i) {
@@ -583,6 +538,111 @@ WIN32DLL_DEFINE void _mcrypt_decrypt(TWI * pkey, word32 * in_blk)
 
 }
 
+/* Two blocks at a time. Each round is a chain of dependent table   */
+/* lookups, so interleaving a second, independent block lets its    */
+/* lookups fill the latency of the first one's.                     */
+
+#ifdef WORDS_BIGENDIAN
+#define tw_le32(x)  byteswap32(x)
+#else
+#define tw_le32(x)  (x)
+#endif
+
+#define f_rnd2(i)                                                       \
+        t1 = g1_fun(x[1]); u1 = g1_fun(y[1]);                           \
+        t0 = g0_fun(x[0]); u0 = g0_fun(y[0]);                           \
+        x[2] = rotr32(x[2] ^ (t0 + t1 + pkey->l_key[4 * (i) + 8]), 1);  \
+        y[2] = rotr32(y[2] ^ (u0 + u1 + pkey->l_key[4 * (i) + 8]), 1);  \
+        x[3] = rotl32(x[3], 1) ^ (t0 + 2 * t1 + pkey->l_key[4 * (i) + 9]); \
+        y[3] = rotl32(y[3], 1) ^ (u0 + 2 * u1 + pkey->l_key[4 * (i) + 9]); \
+        t1 = g1_fun(x[3]); u1 = g1_fun(y[3]);                           \
+        t0 = g0_fun(x[2]); u0 = g0_fun(y[2]);                           \
+        x[0] = rotr32(x[0] ^ (t0 + t1 + pkey->l_key[4 * (i) + 10]), 1); \
+        y[0] = rotr32(y[0] ^ (u0 + u1 + pkey->l_key[4 * (i) + 10]), 1); \
+        x[1] = rotl32(x[1], 1) ^ (t0 + 2 * t1 + pkey->l_key[4 * (i) + 11]); \
+        y[1] = rotl32(y[1], 1) ^ (u0 + 2 * u1 + pkey->l_key[4 * (i) + 11])
+
+#define i_rnd2(i)                                                       \
+        t1 = g1_fun(x[1]); u1 = g1_fun(y[1]);                           \
+        t0 = g0_fun(x[0]); u0 = g0_fun(y[0]);                           \
+        x[2] = rotl32(x[2], 1) ^ (t0 + t1 + pkey->l_key[4 * (i) + 10]); \
+        y[2] = rotl32(y[2], 1) ^ (u0 + u1 + pkey->l_key[4 * (i) + 10]); \
+        x[3] = rotr32(x[3] ^ (t0 + 2 * t1 + pkey->l_key[4 * (i) + 11]), 1); \
+        y[3] = rotr32(y[3] ^ (u0 + 2 * u1 + pkey->l_key[4 * (i) + 11]), 1); \
+        t1 = g1_fun(x[3]); u1 = g1_fun(y[3]);                           \
+        t0 = g0_fun(x[2]); u0 = g0_fun(y[2]);                           \
+        x[0] = rotl32(x[0], 1) ^ (t0 + t1 + pkey->l_key[4 * (i) +  8]); \
+        y[0] = rotl32(y[0], 1) ^ (u0 + u1 + pkey->l_key[4 * (i) +  8]); \
+        x[1] = rotr32(x[1] ^ (t0 + 2 * t1 + pkey->l_key[4 * (i) +  9]), 1); \
+        y[1] = rotr32(y[1] ^ (u0 + 2 * u1 + pkey->l_key[4 * (i) +  9]), 1)
+
+static void twofish_encrypt2(TWI * pkey, const word32 * in, word32 * out)
+{
+	word32 t0, t1, u0, u1, x[4], y[4];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		x[i] = tw_le32(in[i]) ^ pkey->l_key[i];
+		y[i] = tw_le32(in[i + 4]) ^ pkey->l_key[i];
+	}
+
+	f_rnd2(0); f_rnd2(1); f_rnd2(2); f_rnd2(3);
+	f_rnd2(4); f_rnd2(5); f_rnd2(6); f_rnd2(7);
+
+	for (i = 0; i < 4; i++) {
+		out[i] = tw_le32(x[(i + 2) & 3] ^ pkey->l_key[i + 4]);
+		out[i + 4] = tw_le32(y[(i + 2) & 3] ^ pkey->l_key[i + 4]);
+	}
+}
+
+static void twofish_decrypt2(TWI * pkey, const word32 * in, word32 * out)
+{
+	word32 t0, t1, u0, u1, x[4], y[4];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		x[i] = tw_le32(in[i]) ^ pkey->l_key[i + 4];
+		y[i] = tw_le32(in[i + 4]) ^ pkey->l_key[i + 4];
+	}
+
+	i_rnd2(7); i_rnd2(6); i_rnd2(5); i_rnd2(4);
+	i_rnd2(3); i_rnd2(2); i_rnd2(1); i_rnd2(0);
+
+	for (i = 0; i < 4; i++) {
+		out[i] = tw_le32(x[(i + 2) & 3] ^ pkey->l_key[i]);
+		out[i + 4] = tw_le32(y[(i + 2) & 3] ^ pkey->l_key[i]);
+	}
+}
+
+/* encrypt/decrypt nblocks consecutive blocks from in to out; the */
+/* two may be the same buffer but must not otherwise overlap      */
+
+WIN32DLL_DEFINE void _mcrypt_encrypt_blocks(TWI * pkey, const word32 * in,
+					    word32 * out, int nblocks)
+{
+	for (; nblocks >= 2; nblocks -= 2, in += 8, out += 8)
+		twofish_encrypt2(pkey, in, out);
+
+	if (nblocks > 0) {
+		if (out != in)
+			memcpy(out, in, 16);
+		_mcrypt_encrypt(pkey, out);
+	}
+}
+
+WIN32DLL_DEFINE void _mcrypt_decrypt_blocks(TWI * pkey, const word32 * in,
+					    word32 * out, int nblocks)
+{
+	for (; nblocks >= 2; nblocks -= 2, in += 8, out += 8)
+		twofish_decrypt2(pkey, in, out);
+
+	if (nblocks > 0) {
+		if (out != in)
+			memcpy(out, in, 16);
+		_mcrypt_decrypt(pkey, out);
+	}
+}
+
 WIN32DLL_DEFINE int _mcrypt_get_size()
 {
 	return sizeof(TWI);
@@ -624,6 +684,7 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 	int blocksize = _mcrypt_get_block_size(), j;
 	void* key;
 	unsigned char cipher_tmp[200];
+	word32 blocks[5 * 4];
 
 	memcpy( keyword, KEY, 16);
 	memcpy( plaintext, PT, 16);
@@ -650,10 +711,35 @@ WIN32DLL_DEFINE int _mcrypt_self_test()
 		return -1;
 	}
 	_mcrypt_decrypt(key, (void *) ciphertext);
-	free(key);
 
 	if (memcmp(ciphertext, plaintext, 16) != 0) {
 		printf("failed internally\n");
+		free(key);
+		return -1;
+	}
+
+	/* the interleaved kernels must agree with the one above */
+	for (j = 0; j < 5 * 16; j++) {
+		((unsigned char *) blocks)[j] = (j * 7 + 3) % 256;
+	}
+	memcpy(cipher_tmp, blocks, 5 * 16);
+	_mcrypt_encrypt_blocks(key, blocks, blocks, 5);
+	for (j = 0; j < 5; j++) {
+		_mcrypt_encrypt(key, (void *) &cipher_tmp[16 * j]);
+	}
+	if (memcmp(cipher_tmp, blocks, 5 * 16) != 0) {
+		printf("failed multi-block encryption\n");
+		free(key);
+		return -1;
+	}
+	_mcrypt_decrypt_blocks(key, blocks, blocks, 5);
+	for (j = 0; j < 5; j++) {
+		_mcrypt_decrypt(key, (void *) &cipher_tmp[16 * j]);
+	}
+	free(key);
+
+	if (memcmp(cipher_tmp, blocks, 5 * 16) != 0) {
+		printf("failed multi-block decryption\n");
 		return -1;
 	}
 
@@ -1,24 +1,25 @@
 #define Q_TABLES
 #define M_TABLE
 #define MK_TABLE
+
+/* With TWOFISH_COMPACT_KEY each key carries 1 KB of key dependent
+ * S boxes instead of the 4 KB of S boxes already merged with the MDS
+ * matrix, at the cost of a second table lookup per byte in every round.
+ */
+#ifndef TWOFISH_COMPACT_KEY
 #define ONE_STEP
+#endif
 
+/* The q and MDS tables (Q_TABLES, M_TABLE) do not depend on the key
+ * and are shared by all instances, see twofish_tables.h.
+ */
 typedef struct twofish_instance {
 	word32  k_len;
 	word32  l_key[40];
 	word32  s_key[4];
-#ifdef  Q_TABLES
-	word32 qt_gen;
-	byte q_tab[2][256];
-#endif
-#ifdef  M_TABLE
-	word32 mt_gen;
-	word32 m_tab[4][256];
-#endif
 #ifdef  ONE_STEP
 	word32 mk_tab[4][256];
 #else
 	byte sb[4][256];
 #endif
 } TWI;
-
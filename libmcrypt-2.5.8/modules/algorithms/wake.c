@@ -146,11 +146,63 @@ inline static word32 _int_M(word32 X, word32 Y, WAKE_KEY * wake_key)
 	return ((((TMP) >> 8) & 0x00ffffff) ^ wake_key->t[(TMP) & 0xff]);
 }
 
+/* Moves the registers on once r6 has been used up; x is R2 (or R1
+ * when decrypting).
+ */
+#ifdef WORDS_BIGENDIAN
+/* these swaps are because we do operations per byte */
+# define UPDATE(x) \
+	x = byteswap32(x); \
+	r6 = byteswap32(r6); \
+	r3 = M(r3, x); r4 = M(r4, r3); r5 = M(r5, r4); r6 = M(r6, r5); \
+	r6 = byteswap32(r6)
+#else
+# define UPDATE(x) \
+	r3 = M(r3, x); r4 = M(r4, r3); r5 = M(r5, r4); r6 = M(r6, r5)
+#endif
+
+/* R1 = V[n] = V[n] XOR R6 - here we do it per byte --sloooow
+ * R2 = V[n] = R1 - per byte also
+ */
+#define ENC_BYTE(i) \
+	input[i] ^= ((byte *) & r6)[counter]; \
+	((byte *) & r2)[counter] = input[i]; \
+	if (++counter == 4) { \
+		counter = 0; \
+		UPDATE(r2); \
+	}
+
+/* the same for a whole word, which needs no byte access to r6 since
+ * the word is kept in memory order; the buffer need not be aligned
+ */
+#define ENC_WORD(i) \
+	memcpy(&w, &input[i], 4); \
+	w ^= r6; \
+	memcpy(&input[i], &w, 4); \
+	UPDATE(w)
+
+/* R1 = V[n]
+ * R2 = V[n] = V[n] ^ R6
+ */
+#define DEC_BYTE(i) \
+	((byte *) & r1)[counter] = input[i]; \
+	input[i] ^= ((byte *) & r6)[counter]; \
+	if (++counter == 4) { \
+		counter = 0; \
+		UPDATE(r1); \
+	}
+
+#define DEC_WORD(i) \
+	memcpy(&w, &input[i], 4); \
+	v = w ^ r6; \
+	memcpy(&input[i], &v, 4); \
+	UPDATE(w)
+
 WIN32DLL_DEFINE
     void _mcrypt_encrypt(WAKE_KEY * wake_key, byte * input, int len)
 {
 	register word32 r3, r4, r5;
-	word32 r6;
+	word32 r6, w;
 	int i;
 
 	if (len == 0)
@@ -169,32 +221,24 @@ WIN32DLL_DEFINE
 	}
 #endif
 
-	for (i = 0; i < len; i++) {
-		/* R1 = V[n] = V[n] XOR R6 - here we do it per byte --sloooow */
-		/* R1 is ignored */
-		input[i] ^= ((byte *) & r6)[counter];
-
-		/* R2 = V[n] = R1 - per byte also */
-		((byte *) & r2)[counter] = input[i];
-		counter++;
-
-		if (counter == 4) {	/* r6 was used - update it! */
-			counter = 0;
+	/* finish the word a previous call stopped in */
+	for (i = 0; i < len && counter != 0; i++) {
+		ENC_BYTE(i);
+	}
 
-#ifdef WORDS_BIGENDIAN
-			/* these swaps are because we do operations per byte */
-			r2 = byteswap32(r2);
-			r6 = byteswap32(r6);
-#endif
-			r3 = M(r3, r2);
-			r4 = M(r4, r3);
-			r5 = M(r5, r4);
-			r6 = M(r6, r5);
+	/* then whole words at once, while there are any */
+	for (; i + 16 <= len; i += 16) {
+		ENC_WORD(i);
+		ENC_WORD(i + 4);
+		ENC_WORD(i + 8);
+		ENC_WORD(i + 12);
+	}
+	for (; i + 4 <= len; i += 4) {
+		ENC_WORD(i);
+	}
 
-#ifdef WORDS_BIGENDIAN
-			r6 = byteswap32(r6);
-#endif
-		}
+	for (; i < len; i++) {
+		ENC_BYTE(i);
 	}
 
 	wake_key->r[0] = r3;
@@ -209,7 +253,7 @@ WIN32DLL_DEFINE
     void _mcrypt_decrypt(WAKE_KEY * wake_key, byte * input, int len)
 {
 	register word32 r3, r4, r5;
-	word32 r6;
+	word32 r6, w, v;
 	int i;
 
 	if (len == 0)
@@ -234,30 +278,22 @@ WIN32DLL_DEFINE
 	}
 #endif
 
-	for (i = 0; i < len; i++) {
-		/* R1 = V[n] */
-		((byte *) & r1)[counter] = input[i];
-		/* R2 = V[n] = V[n] ^ R6 */
-		/* R2 is ignored */
-		input[i] ^= ((byte *) & r6)[counter];
-		counter++;
-
-		if (counter == 4) {
-			counter = 0;
+	for (i = 0; i < len && counter != 0; i++) {
+		DEC_BYTE(i);
+	}
 
-#ifdef WORDS_BIGENDIAN
-			r1 = byteswap32(r1);
-			r6 = byteswap32(r6);
-#endif
-			r3 = M(r3, r1);
-			r4 = M(r4, r3);
-			r5 = M(r5, r4);
-			r6 = M(r6, r5);
+	for (; i + 16 <= len; i += 16) {
+		DEC_WORD(i);
+		DEC_WORD(i + 4);
+		DEC_WORD(i + 8);
+		DEC_WORD(i + 12);
+	}
+	for (; i + 4 <= len; i += 4) {
+		DEC_WORD(i);
+	}
 
-#ifdef WORDS_BIGENDIAN
-			r6 = byteswap32(r6);
-#endif
-		}
+	for (; i < len; i++) {
+		DEC_BYTE(i);
 	}
 
 	wake_key->r[0] = r3;
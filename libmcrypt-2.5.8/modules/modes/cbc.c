@@ -19,6 +19,7 @@
 
 #include <libdefs.h>
 #include <mcrypt_modules.h>
+#include "mode_buf.h"
 
 #define _init_mcrypt cbc_LTX__init_mcrypt
 #define _mcrypt_set_state cbc_LTX__mcrypt_set_state
@@ -32,30 +33,32 @@
 #define _mcrypt_get_modes_name cbc_LTX__mcrypt_get_modes_name
 #define _mcrypt_mode_get_size cbc_LTX__mcrypt_mode_get_size
 #define _mcrypt_mode_version cbc_LTX__mcrypt_mode_version
+#define _mcrypt_set_blocks cbc_LTX__mcrypt_set_blocks
+#define _mcrypt_out cbc_LTX__mcrypt_out
+#define _mdecrypt_out cbc_LTX__mdecrypt_out
 
 typedef struct cbc_buf {
-	word32 *previous_ciphertext;
-	word32 *previous_cipher;
+	word32 previous_ciphertext[MODE_MAX_BLOCK_WORDS];
+	word32 previous_cipher[MODE_MAX_BLOCK_WORDS];
 	int blocksize;
+	void (*blocks_decrypt)(void*,const void*,void*,int);
 } CBC_BUFFER;
 
+/* How much ciphertext the multi-block decryption handles per call */
+#define CBC_BULK_WORDS 256
+
 /* CBC MODE */
 
 
 int _init_mcrypt( CBC_BUFFER* buf,void *key, int lenofkey, void *IV, int size)
 {
 /* For cbc */
-	buf->previous_ciphertext =
-	buf->previous_cipher = NULL;
+	if (size > MODE_MAX_BLOCK_SIZE)
+		return -1;
 
 	buf->blocksize = size;
+	buf->blocks_decrypt = NULL;
 		
-	buf->previous_ciphertext = malloc( size);
-	buf->previous_cipher = malloc( size);
-	
-	if (buf->previous_ciphertext==NULL ||
-		buf->previous_cipher==NULL) goto freeall;
-	
 	if (IV!=NULL) {
 		memcpy(buf->previous_ciphertext, IV, size);
 	} else {
@@ -63,11 +66,6 @@ int _init_mcrypt( CBC_BUFFER* buf,void *key, int lenofkey, void *IV, int size)
 	}
 
 	return 0;
-
-	freeall:
-		free(buf->previous_ciphertext);
-		free(buf->previous_cipher);
-		return -1;
 }
 
 int _mcrypt_set_state( CBC_BUFFER* buf, void *IV, int size)
@@ -94,15 +92,26 @@ int _mcrypt_get_state( CBC_BUFFER* buf, void *IV, int *size)
 }
 
 
+/* Called after _init_mcrypt() when the algorithm also exports the
+ * optional multi-block entry points. CBC encryption is inherently
+ * serial, so only the decryption one is used.
+ */
+int _mcrypt_set_blocks( CBC_BUFFER* buf, void (*func)(void*,const void*,void*,int), void (*func2)(void*,const void*,void*,int))
+{
+	buf->blocks_decrypt = func2;
+	return 0;
+}
+
 void _end_mcrypt( CBC_BUFFER* buf) {
-	free(buf->previous_ciphertext);
-	free(buf->previous_cipher);
 }
 
-int _mcrypt( CBC_BUFFER* buf, void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+/* Encrypts from in to out, which may be the same buffer */
+int _mcrypt_out( CBC_BUFFER* buf, const void *in, void *out, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
 {
-	word32 *fplain = plaintext;
-	word32 *plain;
+	const word32 *fplain = in;
+	word32 *fcipher = out;
+	const word32 *plain;
+	word32 *cipher;
 	int i, j; 
 	void (*_mcrypt_block_encrypt) (void *, void *);
 
@@ -111,40 +120,97 @@ int _mcrypt( CBC_BUFFER* buf, void *plaintext, int len, int blocksize, void* ake
 	for (j = 0; j < len / blocksize; j++) {
 
 		plain = &fplain[j * blocksize / sizeof(word32)];
+		cipher = &fcipher[j * blocksize / sizeof(word32)];
 
 		for (i = 0; i < blocksize / sizeof(word32); i++) {
-			plain[i] ^= buf->previous_ciphertext[i];
+			cipher[i] = plain[i] ^ buf->previous_ciphertext[i];
 		}
 
-		_mcrypt_block_encrypt(akey, plain);
+		_mcrypt_block_encrypt(akey, cipher);
 
 		/* Copy the ciphertext to prev_ciphertext */
-		memcpy(buf->previous_ciphertext, plain, blocksize);
+		memcpy(buf->previous_ciphertext, cipher, blocksize);
 	}
 	if (j==0 && len!=0) return -1;
 	return 0;
 }
 
+int _mcrypt( CBC_BUFFER* buf, void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return _mcrypt_out( buf, plaintext, plaintext, len, blocksize, akey, func, func2);
+}
 
 
-int _mdecrypt( CBC_BUFFER* buf, void *ciphertext, int len, int blocksize,void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+
+/* Decrypts up to CBC_BULK_WORDS of ciphertext per call into a
+ * scratch buffer, then xors each block with the ciphertext block
+ * before it. Going backwards lets us do that in place.
+ */
+static int cbc_bulk_decrypt( CBC_BUFFER* buf, const void *in, void *out, int len, int blocksize, void* akey)
 {
-	word32 *cipher;
-	word32 *fcipher = ciphertext;
+	word32 tmp[CBC_BULK_WORDS];
+	const word32 *fcipher = in;
+	word32 *fplain = out;
+	int bwords = blocksize / sizeof(word32);
+	int nblocks = len / blocksize;
+	int i, j, n;
+
+	if (nblocks<=0 && len!=0) return -1;
+
+	while (nblocks > 0) {
+		n = sizeof(tmp) / blocksize;
+		if (n > nblocks) n = nblocks;
+
+		buf->blocks_decrypt(akey, fcipher, tmp, n);
+
+		/* the last ciphertext block is the next chain value */
+		memcpy(buf->previous_cipher, &fcipher[(n - 1) * bwords], blocksize);
+
+		for (j = n - 1; j > 0; j--) {
+			for (i = 0; i < bwords; i++) {
+				fplain[j * bwords + i] =
+					tmp[j * bwords + i] ^ fcipher[(j - 1) * bwords + i];
+			}
+		}
+		for (i = 0; i < bwords; i++) {
+			fplain[i] = tmp[i] ^ buf->previous_ciphertext[i];
+		}
+
+		memcpy(buf->previous_ciphertext, buf->previous_cipher, blocksize);
+
+		fcipher += n * bwords;
+		fplain += n * bwords;
+		nblocks -= n;
+	}
+	return 0;
+}
+
+/* Decrypts from in to out, which may be the same buffer */
+int _mdecrypt_out( CBC_BUFFER* buf, const void *in, void *out, int len, int blocksize,void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	const word32 *fcipher = in;
+	word32 *fplain = out;
+	const word32 *cipher;
+	word32 *plain;
 	int i, j; 
 	void (*_mcrypt_block_decrypt) (void *, void *);
 
 	_mcrypt_block_decrypt = func2;
 
+	if (buf->blocks_decrypt != NULL)
+		return cbc_bulk_decrypt( buf, in, out, len, blocksize, akey);
 
 	for (j = 0; j < len / blocksize; j++) {
 
 		cipher = &fcipher[j * blocksize / sizeof(word32)];
+		plain = &fplain[j * blocksize / sizeof(word32)];
 		memcpy(buf->previous_cipher, cipher, blocksize);
 
-		_mcrypt_block_decrypt(akey, cipher);
+		if (plain != cipher)
+			memcpy(plain, cipher, blocksize);
+		_mcrypt_block_decrypt(akey, plain);
 		for (i = 0; i < blocksize / sizeof(word32); i++) {
-			cipher[i] ^= buf->previous_ciphertext[i];
+			plain[i] ^= buf->previous_ciphertext[i];
 		}
 
 		/* Copy the ciphertext to prev_cipher */
@@ -155,6 +221,11 @@ int _mdecrypt( CBC_BUFFER* buf, void *ciphertext, int len, int blocksize,void* a
 	return 0;
 }
 
+int _mdecrypt( CBC_BUFFER* buf, void *ciphertext, int len, int blocksize,void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return _mdecrypt_out( buf, ciphertext, ciphertext, len, blocksize, akey, func, func2);
+}
+
 int _has_iv() { return 1; }
 int _is_block_mode() { return 1; }
 int _is_block_algorithm_mode() { return 1; }
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_modules.h>
+#include "mode_buf.h"
+
+#define _init_mcrypt cbcmac_LTX__init_mcrypt
+#define _mcrypt_set_state cbcmac_LTX__mcrypt_set_state
+#define _mcrypt_get_state cbcmac_LTX__mcrypt_get_state
+#define _end_mcrypt cbcmac_LTX__end_mcrypt
+#define _mcrypt cbcmac_LTX__mcrypt
+#define _mdecrypt cbcmac_LTX__mdecrypt
+#define _has_iv cbcmac_LTX__has_iv
+#define _is_block_mode cbcmac_LTX__is_block_mode
+#define _is_block_algorithm_mode cbcmac_LTX__is_block_algorithm_mode
+#define _mcrypt_get_modes_name cbcmac_LTX__mcrypt_get_modes_name
+#define _mcrypt_mode_get_size cbcmac_LTX__mcrypt_mode_get_size
+#define _mcrypt_mode_version cbcmac_LTX__mcrypt_mode_version
+#define _mcrypt_mac_update cbcmac_LTX__mcrypt_mac_update
+#define _mcrypt_mac_final cbcmac_LTX__mcrypt_mac_final
+#define _mdecrypt_verify_tag cbcmac_LTX__mdecrypt_verify_tag
+
+/* Raw CBC-MAC (ISO/IEC 9797-1 MAC algorithm 1): the last block of
+ * CBC encryption with a zero IV, the message padded with zeroes to a
+ * whole number of blocks. Since the padding is ambiguous and the tag of
+ * one message can be extended to the tag of a longer one, it is only
+ * safe for messages of a fixed length; otherwise use cmac.
+ */
+
+#define CBCMAC_MIN_TAG_SIZE 4
+
+typedef struct cbcmac_buf {
+	byte X[MODE_MAX_BLOCK_SIZE];	/* chaining block */
+	byte last[MODE_MAX_BLOCK_SIZE];	/* last block seen, not yet chained */
+	int last_pos;
+} CBCMAC_BUFFER;
+
+int _init_mcrypt( CBCMAC_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
+{
+	memset( buf, 0, sizeof(CBCMAC_BUFFER));
+	return 0;
+}
+
+/* Starts a new message; there is no IV. */
+static void cbcmac_reset( CBCMAC_BUFFER* buf)
+{
+	memset( buf->X, 0, sizeof(buf->X));
+	buf->last_pos = 0;
+}
+
+int _mcrypt_set_state( CBCMAC_BUFFER* buf, byte *IV, int size)
+{
+	cbcmac_reset( buf);
+	return 0;
+}
+
+int _mcrypt_get_state( CBCMAC_BUFFER* buf, byte *IV, int *size)
+{
+	*size = 0;
+	return 0;
+}
+
+void _end_mcrypt( CBCMAC_BUFFER* buf) {
+}
+
+/* Adds len bytes to the message. The last block is held back until
+ * more data arrives or the message ends, when it may need padding.
+ */
+int _mcrypt_mac_update( CBCMAC_BUFFER* buf, const void *data, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	const byte *in = data;
+	int n;
+
+	if (len < 0 || blocksize > MODE_MAX_BLOCK_SIZE)
+		return -1;
+	if (len == 0)
+		return 0;
+
+	if (buf->last_pos > 0) {
+		n = blocksize - buf->last_pos;
+		if (n > len)
+			n = len;
+		memcpy( &buf->last[buf->last_pos], in, n);
+		buf->last_pos += n;
+		in += n;
+		len -= n;
+		if (len == 0)
+			return 0;
+
+		memxor( buf->X, buf->last, blocksize);
+		func(akey, buf->X);
+		buf->last_pos = 0;
+	}
+
+	for (; len > blocksize; len -= blocksize, in += blocksize) {
+		memxor( buf->X, in, blocksize);
+		func(akey, buf->X);
+	}
+
+	memcpy( buf->last, in, len);
+	buf->last_pos = len;
+
+	return 0;
+}
+
+/* The data is authenticated but left as it is. */
+int _mcrypt( CBCMAC_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return _mcrypt_mac_update( buf, plaintext, len, blocksize, akey, func, func2);
+}
+
+int _mdecrypt( CBCMAC_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return _mcrypt_mac_update( buf, plaintext, len, blocksize, akey, func, func2);
+}
+
+/* Ends the message and leaves its full tag in X. */
+static int cbcmac_final( CBCMAC_BUFFER* buf, int blocksize, void* akey, void (*func)(void*,void*))
+{
+	if (blocksize > MODE_MAX_BLOCK_SIZE)
+		return -1;
+
+	/* an empty message is padded to one block of zeroes */
+	memset( &buf->last[buf->last_pos], 0, blocksize - buf->last_pos);
+	memxor( buf->X, buf->last, blocksize);
+	func(akey, buf->X);
+
+	return 0;
+}
+
+/* Ends the message and returns the first len bytes of its tag. The
+ * next update starts a new message under the same key.
+ */
+int _mcrypt_mac_final( CBCMAC_BUFFER* buf, void *tag, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	if (len < CBCMAC_MIN_TAG_SIZE || len > blocksize)
+		return -1;
+	if (cbcmac_final( buf, blocksize, akey, func) < 0)
+		return -1;
+
+	memcpy( tag, buf->X, len);
+	cbcmac_reset( buf);
+
+	return 0;
+}
+
+/* Ends the message and compares its tag to the len bytes in tag, in
+ * time independent of where they differ. Returns 0 when they match.
+ */
+int _mdecrypt_verify_tag( CBCMAC_BUFFER* buf, const void *tag, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	const byte *t = tag;
+	byte diff = 0;
+	int i;
+
+	if (len < CBCMAC_MIN_TAG_SIZE || len > blocksize)
+		return -1;
+	if (cbcmac_final( buf, blocksize, akey, func) < 0)
+		return -1;
+
+	for (i = 0; i < len; i++)
+		diff |= buf->X[i] ^ t[i];
+	cbcmac_reset( buf);
+
+	return diff == 0 ? 0 : -1;
+}
+
+int _has_iv() { return 0; }
+int _is_block_mode() { return 0; }
+int _is_block_algorithm_mode() { return 1; }
+const char *_mcrypt_get_modes_name() { return "CBC-MAC";}
+int _mcrypt_mode_get_size () {return sizeof(CBCMAC_BUFFER);}
+
+
+word32 _mcrypt_mode_version() {
+	return 20261018;
+}
+
+#ifdef WIN32
+# ifdef USE_LTDL
+WIN32DLL_DEFINE int main (void)
+{
+       /* empty main function to avoid linker error (see cygwin FAQ) */
+}
+# endif
+#endif
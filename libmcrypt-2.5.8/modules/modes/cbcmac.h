@@ -0,0 +1,12 @@
+#ifndef USE_MODULES
+int _cbcmac_init_mcrypt( int td, void* buf, void *key, int lenofkey, void *IV);
+int _mcrypt_cbcmac(int td, void* buf,void *plaintext, int len);
+int _mdecrypt_cbcmac(int td, void* buf, void *plaintext, int len);
+int _cbcmac_is_block_mode();
+int _cbcmac_has_iv();
+int _cbcmac_is_block_algorithm_mode();
+char *_mcrypt_cbcmac_get_modes_name();
+int _mcrypt_cbcmac_mode_get_size ();
+int _mcrypt_cbcmac_get_iv_size(int td);
+word32 _mcrypt_cbcmac_mode_version();
+#endif
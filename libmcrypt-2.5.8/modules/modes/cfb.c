@@ -19,6 +19,7 @@
 
 #include <libdefs.h>
 #include <mcrypt_modules.h>
+#include "mode_buf.h"
 
 #define _init_mcrypt cfb_LTX__init_mcrypt
 #define _mcrypt_set_state cfb_LTX__mcrypt_set_state
@@ -32,40 +33,49 @@
 #define _mcrypt_get_modes_name cfb_LTX__mcrypt_get_modes_name
 #define _mcrypt_mode_get_size cfb_LTX__mcrypt_mode_get_size
 #define _mcrypt_mode_version cfb_LTX__mcrypt_mode_version
+#define _mcrypt_set_blocks cfb_LTX__mcrypt_set_blocks
 
 typedef struct cfb_buf {
-	byte* s_register;
-	byte* enc_s_register;
+	byte s_register[2 * MODE_MAX_BLOCK_SIZE];
+	byte enc_s_register[MODE_MAX_BLOCK_SIZE];
+	int s_register_pos;
 	int blocksize;
+	void (*blocks_encrypt)(void*,const void*,void*,int);
 } CFB_BUFFER;
 
+/* Size of the buffer of cipher inputs used with multi-block encryption */
+#define CFB_BULK_BYTES 1024
+
+/* The shift register is kept in a buffer of twice the block size,
+ * with every byte stored in both halves, and is the block starting at
+ * s_register_pos. Shifting a byte in is then two stores and a step of
+ * the position, and the register is always a contiguous block.
+ */
+#define SHIFT_IN(reg, pos, blocksize, c) \
+	reg[pos] = reg[pos + blocksize] = (c); \
+	if (++pos == blocksize) pos = 0
+
 /* CFB MODE */
 
 int _init_mcrypt( CFB_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
 {
 
-    buf->s_register = buf->enc_s_register = NULL;
+    if (size > MODE_MAX_BLOCK_SIZE)
+	return -1;
+
+    buf->s_register_pos = 0;
     
     buf->blocksize = size;
+    buf->blocks_encrypt = NULL;
 /* For cfb */
-	buf->s_register=malloc( size);
-    if (buf->s_register==NULL) goto freeall;
-
-	buf->enc_s_register=malloc( size);
-    if (buf->enc_s_register==NULL) goto freeall;
-
 	if (IV!=NULL) {
 		memcpy(buf->s_register, IV, size);
 	} else {
-		memset(buf->s_register, 0, size);	
+		memset(buf->s_register, 0, size);
 	}
+	memcpy(&buf->s_register[size], buf->s_register, size);
 /* End cfb */
 	return 0;
-
-	freeall:
-		free(buf->s_register);
-		free(buf->enc_s_register);
-		return -1;
 }
 
 
@@ -73,6 +83,8 @@ int _mcrypt_set_state( CFB_BUFFER* buf, void *IV, int size)
 {
 	memcpy(buf->enc_s_register, IV, size);
 	memcpy(buf->s_register, IV, size);
+	memcpy(&buf->s_register[size], IV, size);
+	buf->s_register_pos = 0;
 
 	return 0;
 }
@@ -85,68 +97,114 @@ int _mcrypt_get_state( CFB_BUFFER* buf, byte *IV, int *size)
 	}
 	*size = buf->blocksize;
 
-	memcpy( IV, buf->s_register, buf->blocksize);
+	memcpy( IV, &buf->s_register[buf->s_register_pos], buf->blocksize);
 
 	return 0;
 }
 
 
+/* Called after _init_mcrypt() when the algorithm also exports the
+ * optional multi-block entry points. Encryption needs each ciphertext
+ * byte before the next cipher input is known, so only decryption makes
+ * use of them.
+ */
+int _mcrypt_set_blocks( CFB_BUFFER* buf, void (*func)(void*,const void*,void*,int), void (*func2)(void*,const void*,void*,int))
+{
+	buf->blocks_encrypt = func;
+	return 0;
+}
+
 void _end_mcrypt( CFB_BUFFER* buf) {
-	free(buf->s_register);
-	free(buf->enc_s_register);
 }
 
 int _mcrypt( CFB_BUFFER* buf, void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
 {				/* plaintext is 1 byte (8bit cfb) */
-	char *plain = plaintext;
-	int i, j;
+	byte *plain = plaintext;
+	byte *reg = buf->s_register, *enc = buf->enc_s_register;
+	int pos = buf->s_register_pos;
+	int j;
 	void (*_mcrypt_block_encrypt) (void *, void *);
 
 	_mcrypt_block_encrypt = func;
 
 	for (j = 0; j < len; j++) {
 
-		memcpy(buf->enc_s_register, buf->s_register, blocksize);
-
-		_mcrypt_block_encrypt(akey, buf->enc_s_register);
+		memcpy(enc, &reg[pos], blocksize);
 
-		plain[j] ^= buf->enc_s_register[0];
+		_mcrypt_block_encrypt(akey, enc);
 
-/* Shift the register */
-		for (i = 0; i < (blocksize - 1); i++)
-			buf->s_register[i] = buf->s_register[i + 1];
+		plain[j] ^= enc[0];
 
-		buf->s_register[blocksize - 1] = plain[j];
+		SHIFT_IN(reg, pos, blocksize, plain[j]);
 	}
+	buf->s_register_pos = pos;
 
 	return 0;
 
 }
 
 
+/* When decrypting, the cipher input for every byte is the block of
+ * ciphertext before it, so all of them are known up front. They are
+ * laid out side by side and encrypted with one multi-block call.
+ */
+static void cfb_bulk_decrypt( CFB_BUFFER* buf, byte* plain, int len, int blocksize, void* akey)
+{
+	word32 tmp[CFB_BULK_BYTES / sizeof(word32)];
+	byte hist[CFB_BULK_BYTES + 32];
+	byte *in = (byte *) tmp;
+	byte *reg = buf->s_register;
+	int pos = buf->s_register_pos;
+	int k, n;
+
+	while (len > 0) {
+		n = sizeof(tmp) / blocksize;
+		if (n > len) n = len;
+
+		/* the register followed by the ciphertext */
+		memcpy(hist, &reg[pos], blocksize);
+		memcpy(&hist[blocksize], plain, n);
+		for (k = 0; k < n; k++)
+			memcpy(&in[k * blocksize], &hist[k], blocksize);
+
+		buf->blocks_encrypt(akey, in, in, n);
+
+		for (k = 0; k < n; k++) {
+			SHIFT_IN(reg, pos, blocksize, plain[k]);
+			plain[k] ^= in[k * blocksize];
+		}
+		plain += n;
+		len -= n;
+	}
+	buf->s_register_pos = pos;
+}
+
 int _mdecrypt( CFB_BUFFER* buf, void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
-{				/* plaintext is 1 byte (8bit ofb) */
-	char *plain = plaintext;
-	int i, j;
+{				/* plaintext is 1 byte (8bit cfb) */
+	byte *plain = plaintext;
+	byte *reg = buf->s_register, *enc = buf->enc_s_register;
+	int pos = buf->s_register_pos;
+	int j;
 	void (*_mcrypt_block_encrypt) (void *, void *);
 
 	_mcrypt_block_encrypt = func;
 
-	for (j = 0; j < len; j++) {
-
-		memcpy(buf->enc_s_register, buf->s_register, blocksize);
+	if (buf->blocks_encrypt != NULL && len > 1) {
+		cfb_bulk_decrypt( buf, plain, len, blocksize, akey);
+		return 0;
+	}
 
-		_mcrypt_block_encrypt(akey, buf->enc_s_register);
+	for (j = 0; j < len; j++) {
 
-/* Shift the register */
-		for (i = 0; i < (blocksize - 1); i++)
-			buf->s_register[i] = buf->s_register[i + 1];
+		memcpy(enc, &reg[pos], blocksize);
 
-		buf->s_register[blocksize - 1] = plain[j];
+		_mcrypt_block_encrypt(akey, enc);
 
-		plain[j] ^= buf->enc_s_register[0];
+		SHIFT_IN(reg, pos, blocksize, plain[j]);
 
+		plain[j] ^= enc[0];
 	}
+	buf->s_register_pos = pos;
 
 	return 0;
 }
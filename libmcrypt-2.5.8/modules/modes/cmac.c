@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_modules.h>
+#include "mode_buf.h"
+
+#define _init_mcrypt cmac_LTX__init_mcrypt
+#define _mcrypt_set_state cmac_LTX__mcrypt_set_state
+#define _mcrypt_get_state cmac_LTX__mcrypt_get_state
+#define _end_mcrypt cmac_LTX__end_mcrypt
+#define _mcrypt cmac_LTX__mcrypt
+#define _mdecrypt cmac_LTX__mdecrypt
+#define _has_iv cmac_LTX__has_iv
+#define _is_block_mode cmac_LTX__is_block_mode
+#define _is_block_algorithm_mode cmac_LTX__is_block_algorithm_mode
+#define _mcrypt_get_modes_name cmac_LTX__mcrypt_get_modes_name
+#define _mcrypt_mode_get_size cmac_LTX__mcrypt_mode_get_size
+#define _mcrypt_mode_version cmac_LTX__mcrypt_mode_version
+#define _mcrypt_mac_update cmac_LTX__mcrypt_mac_update
+#define _mcrypt_mac_final cmac_LTX__mcrypt_mac_final
+#define _mdecrypt_verify_tag cmac_LTX__mdecrypt_verify_tag
+
+/* CMAC (NIST SP 800-38B): CBC-MAC over the message with a zero IV,
+ * where the last block is first xored with one of two subkeys derived
+ * from E(0). The first subkey is used when the last block is complete,
+ * the second when it had to be padded with 10*.
+ *
+ * Nothing is encrypted; the message is authenticated with the key the
+ * algorithm has already expanded, and the state is just the chaining
+ * block and the (possibly partial) last block.
+ */
+
+#define CMAC_MIN_TAG_SIZE 4
+
+typedef struct cmac_buf {
+	byte K1[MODE_MAX_BLOCK_SIZE];
+	byte K2[MODE_MAX_BLOCK_SIZE];
+	byte X[MODE_MAX_BLOCK_SIZE];	/* chaining block */
+	byte last[MODE_MAX_BLOCK_SIZE];	/* last block seen, not yet chained */
+	int last_pos;
+	int blocksize;			/* 0 until the subkeys are made */
+} CMAC_BUFFER;
+
+int _init_mcrypt( CMAC_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
+{
+	memset( buf, 0, sizeof(CMAC_BUFFER));
+	return 0;
+}
+
+/* Starts a new message; there is no IV. */
+static void cmac_reset( CMAC_BUFFER* buf)
+{
+	memset( buf->X, 0, sizeof(buf->X));
+	buf->last_pos = 0;
+}
+
+int _mcrypt_set_state( CMAC_BUFFER* buf, byte *IV, int size)
+{
+	cmac_reset( buf);
+	return 0;
+}
+
+int _mcrypt_get_state( CMAC_BUFFER* buf, byte *IV, int *size)
+{
+	*size = 0;
+	return 0;
+}
+
+void _end_mcrypt( CMAC_BUFFER* buf) {
+}
+
+/* Multiplication by x in GF(2^n), in place; rb holds the two low bytes
+ * of the reduction polynomial.
+ */
+static void cmac_double( byte *b, int blocksize, const byte *rb)
+{
+	int carry = b[0] >> 7;
+	int i;
+
+	for (i = 0; i < blocksize - 1; i++)
+		b[i] = (b[i] << 1) | (b[i + 1] >> 7);
+	b[blocksize - 1] <<= 1;
+
+	if (carry) {
+		b[blocksize - 2] ^= rb[0];
+		b[blocksize - 1] ^= rb[1];
+	}
+}
+
+/* Makes the subkeys on the first use of the key. Only 64, 128 and 256
+ * bit blocks have a polynomial.
+ */
+static int cmac_start( CMAC_BUFFER* buf, int blocksize, void* akey, void (*func)(void*,void*))
+{
+	static const byte rb64[2] = { 0x00, 0x1B };
+	static const byte rb128[2] = { 0x00, 0x87 };
+	static const byte rb256[2] = { 0x04, 0x25 };
+	const byte *rb;
+
+	if (buf->blocksize != 0)
+		return buf->blocksize == blocksize ? 0 : -1;
+
+	switch (blocksize) {
+	case 8:
+		rb = rb64;
+		break;
+	case 16:
+		rb = rb128;
+		break;
+	case 32:
+		rb = rb256;
+		break;
+	default:
+		return -1;
+	}
+
+	memset( buf->K1, 0, blocksize);
+	func(akey, buf->K1);
+	cmac_double( buf->K1, blocksize, rb);
+	memcpy( buf->K2, buf->K1, blocksize);
+	cmac_double( buf->K2, blocksize, rb);
+
+	buf->blocksize = blocksize;
+	return 0;
+}
+
+/* Adds len bytes to the message. The last block is held back until
+ * more data arrives or the message ends, since only then is it known
+ * which subkey it takes.
+ */
+int _mcrypt_mac_update( CMAC_BUFFER* buf, const void *data, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	const byte *in = data;
+	int n;
+
+	if (len < 0 || cmac_start( buf, blocksize, akey, func) < 0)
+		return -1;
+	if (len == 0)
+		return 0;
+
+	if (buf->last_pos > 0) {
+		n = blocksize - buf->last_pos;
+		if (n > len)
+			n = len;
+		memcpy( &buf->last[buf->last_pos], in, n);
+		buf->last_pos += n;
+		in += n;
+		len -= n;
+		if (len == 0)
+			return 0;
+
+		memxor( buf->X, buf->last, blocksize);
+		func(akey, buf->X);
+		buf->last_pos = 0;
+	}
+
+	for (; len > blocksize; len -= blocksize, in += blocksize) {
+		memxor( buf->X, in, blocksize);
+		func(akey, buf->X);
+	}
+
+	memcpy( buf->last, in, len);
+	buf->last_pos = len;
+
+	return 0;
+}
+
+/* The data is authenticated but left as it is. */
+int _mcrypt( CMAC_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return _mcrypt_mac_update( buf, plaintext, len, blocksize, akey, func, func2);
+}
+
+int _mdecrypt( CMAC_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return _mcrypt_mac_update( buf, plaintext, len, blocksize, akey, func, func2);
+}
+
+/* Ends the message and leaves its full tag in X. */
+static int cmac_final( CMAC_BUFFER* buf, int blocksize, void* akey, void (*func)(void*,void*))
+{
+	if (cmac_start( buf, blocksize, akey, func) < 0)
+		return -1;
+
+	if (buf->last_pos == blocksize) {
+		memxor( buf->X, buf->K1, blocksize);
+	} else {
+		buf->last[buf->last_pos] = 0x80;
+		memset( &buf->last[buf->last_pos + 1], 0,
+			blocksize - buf->last_pos - 1);
+		memxor( buf->X, buf->K2, blocksize);
+	}
+	memxor( buf->X, buf->last, blocksize);
+	func(akey, buf->X);
+
+	return 0;
+}
+
+/* Ends the message and returns the first len bytes of its tag. The
+ * next update starts a new message under the same key.
+ */
+int _mcrypt_mac_final( CMAC_BUFFER* buf, void *tag, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	if (len < CMAC_MIN_TAG_SIZE || len > blocksize)
+		return -1;
+	if (cmac_final( buf, blocksize, akey, func) < 0)
+		return -1;
+
+	memcpy( tag, buf->X, len);
+	cmac_reset( buf);
+
+	return 0;
+}
+
+/* Ends the message and compares its tag to the len bytes in tag, in
+ * time independent of where they differ. Returns 0 when they match.
+ */
+int _mdecrypt_verify_tag( CMAC_BUFFER* buf, const void *tag, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	const byte *t = tag;
+	byte diff = 0;
+	int i;
+
+	if (len < CMAC_MIN_TAG_SIZE || len > blocksize)
+		return -1;
+	if (cmac_final( buf, blocksize, akey, func) < 0)
+		return -1;
+
+	for (i = 0; i < len; i++)
+		diff |= buf->X[i] ^ t[i];
+	cmac_reset( buf);
+
+	return diff == 0 ? 0 : -1;
+}
+
+int _has_iv() { return 0; }
+int _is_block_mode() { return 0; }
+int _is_block_algorithm_mode() { return 1; }
+const char *_mcrypt_get_modes_name() { return "CMAC";}
+int _mcrypt_mode_get_size () {return sizeof(CMAC_BUFFER);}
+
+
+word32 _mcrypt_mode_version() {
+	return 20261018;
+}
+
+#ifdef WIN32
+# ifdef USE_LTDL
+WIN32DLL_DEFINE int main (void)
+{
+       /* empty main function to avoid linker error (see cygwin FAQ) */
+}
+# endif
+#endif
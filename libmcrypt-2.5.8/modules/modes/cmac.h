@@ -0,0 +1,12 @@
+#ifndef USE_MODULES
+int _cmac_init_mcrypt( int td, void* buf, void *key, int lenofkey, void *IV);
+int _mcrypt_cmac(int td, void* buf,void *plaintext, int len);
+int _mdecrypt_cmac(int td, void* buf, void *plaintext, int len);
+int _cmac_is_block_mode();
+int _cmac_has_iv();
+int _cmac_is_block_algorithm_mode();
+char *_mcrypt_cmac_get_modes_name();
+int _mcrypt_cmac_mode_get_size ();
+int _mcrypt_cmac_get_iv_size(int td);
+word32 _mcrypt_cmac_mode_version();
+#endif
@@ -19,6 +19,7 @@
 
 #include <libdefs.h>
 #include <mcrypt_modules.h>
+#include "mode_buf.h"
 
 #define _init_mcrypt ctr_LTX__init_mcrypt
 #define _mcrypt_set_state ctr_LTX__mcrypt_set_state
@@ -32,14 +33,28 @@
 #define _mcrypt_get_modes_name ctr_LTX__mcrypt_get_modes_name
 #define _mcrypt_mode_get_size ctr_LTX__mcrypt_mode_get_size
 #define _mcrypt_mode_version ctr_LTX__mcrypt_mode_version
+#define _mcrypt_set_blocks ctr_LTX__mcrypt_set_blocks
+#define _mcrypt_out ctr_LTX__mcrypt_out
+#define _mdecrypt_out ctr_LTX__mdecrypt_out
+#define _mcrypt_prefetch ctr_LTX__mcrypt_prefetch
 
 typedef struct ctr_buf {
-	byte* enc_counter;
-	byte* c_counter;
+	byte enc_counter[MODE_MAX_BLOCK_SIZE];
+	byte c_counter[MODE_MAX_BLOCK_SIZE];
 	int c_counter_pos;
 	int blocksize;
+	void (*blocks_encrypt)(void*,const void*,void*,int);
+	/* Keystream of the blocks after the current one, computed ahead
+	 * of time; only whole blocks, the next one at ks_pos.
+	 */
+	word32 ks[MODE_KEYSTREAM_WORDS];
+	int ks_pos, ks_len;
+	int prefetch;		/* refill ks whenever it runs out */
 } CTR_BUFFER;
 
+/* Size of the keystream buffer used with multi-block encryption */
+#define CTR_BULK_BYTES 1024
+
 /* CTR MODE */
 
 /* This function will add one to the given number (as a byte string).
@@ -67,30 +82,27 @@ register int i, y=0;
  */
 int _init_mcrypt( CTR_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
 {
-    buf->c_counter = buf->enc_counter = NULL;
+    if (size > MODE_MAX_BLOCK_SIZE)
+	return -1;
     
 /* For ctr */
     buf->c_counter_pos = 0;
     buf->blocksize = size;
+    buf->blocks_encrypt = NULL;
+    buf->ks_pos = buf->ks_len = 0;
+    buf->prefetch = 0;
 
-	buf->c_counter=calloc( 1, size);
-    if (buf->c_counter==NULL) goto freeall;
-
-	buf->enc_counter=calloc( 1, size);
-    if (buf->enc_counter==NULL) goto freeall;
-    
     if (IV!=NULL) {
 	memcpy(buf->enc_counter, IV, size);
 	memcpy(buf->c_counter, IV, size);
+    } else {
+	memset(buf->enc_counter, 0, size);
+	memset(buf->c_counter, 0, size);
     }
 
 /* End ctr */
 
 	return 0;
-	freeall:
-		free(buf->c_counter);
-		free(buf->enc_counter);
-		return -1;
 }
 
 int _mcrypt_set_state( CTR_BUFFER* buf, byte *IV, int size)
@@ -98,6 +110,7 @@ int _mcrypt_set_state( CTR_BUFFER* buf, byte *IV, int size)
 	buf->c_counter_pos = IV[0];
 	memcpy(buf->c_counter, &IV[1], size-1);
 	memcpy(buf->enc_counter, &IV[1], size-1);
+	buf->ks_pos = buf->ks_len = 0;
 
 	return 0;
 }
@@ -117,116 +130,248 @@ int _mcrypt_get_state( CTR_BUFFER* buf, byte *IV, int *size)
 }
 
 
+/* Called after _init_mcrypt() when the algorithm also exports the
+ * optional multi-block entry points. Only encryption is needed here.
+ */
+int _mcrypt_set_blocks( CTR_BUFFER* buf, void (*func)(void*,const void*,void*,int), void (*func2)(void*,const void*,void*,int))
+{
+	buf->blocks_encrypt = func;
+	return 0;
+}
+
 void _end_mcrypt( CTR_BUFFER* buf) {
-	free(buf->c_counter);
-	free(buf->enc_counter);
 }
 
-inline static
-void xor_stuff( CTR_BUFFER *buf, void* akey, void (*func)(void*,void*), byte* plain,  int blocksize, int xor_size) 
+/* The low 64 bits of the counter are handled as one big endian word;
+ * only a carry out of them has to go through increase_counter().
+ */
+static unsigned long long ctr_get64( const byte *x)
 {
-	void (*_mcrypt_block_encrypt) (void *, void *);
-
-	_mcrypt_block_encrypt = func;
-
-	if (xor_size == blocksize) {
-		if (buf->c_counter_pos == 0) {
+	unsigned long long v = 0;
+	int i;
 
-			memcpy( buf->enc_counter, buf->c_counter, blocksize);
-			_mcrypt_block_encrypt(akey, buf->enc_counter);
+	for (i = 0; i < 8; i++)
+		v = (v << 8) | x[i];
+	return v;
+}
 
-			memxor( plain, buf->enc_counter, blocksize);
+static void ctr_put64( byte *x, unsigned long long v)
+{
+	int i;
 
-			increase_counter( buf->c_counter, blocksize);
+	for (i = 7; i >= 0; i--) {
+		x[i] = (byte) v;
+		v >>= 8;
+	}
+}
 
+/* Lays out the next n counter values in ks and advances the counter
+ * past them.
+ */
+static void ctr_fill( byte *ks, byte *counter, int blocksize, int n)
+{
+	int hi = blocksize - 8;
+	unsigned long long c = ctr_get64( &counter[hi]);
+	int k;
+
+	for (k = 0; k < n; k++, ks += blocksize) {
+		memcpy( ks, counter, hi);
+		ctr_put64( &ks[hi], c);
+		if (++c == 0)
+			increase_counter( counter, hi);
+	}
+	ctr_put64( &counter[hi], c);
+}
 
-		} else {
-			int size = blocksize - buf->c_counter_pos;
+/* Adds n to the counter */
+static void ctr_add( byte *counter, int blocksize, int n)
+{
+	int hi = blocksize - 8;
+	unsigned long long c = ctr_get64( &counter[hi]);
 
-			memxor( plain, &buf->enc_counter[buf->c_counter_pos],
-				size);
-		
-			increase_counter( buf->c_counter, blocksize);
+	if (c + n < c)
+		increase_counter( counter, hi);
+	ctr_put64( &counter[hi], c + n);
+}
 
-			memcpy( buf->enc_counter, buf->c_counter, blocksize);
-			_mcrypt_block_encrypt(akey, buf->enc_counter);
+/* Computes the keystream of the n blocks from counter on into ks, and
+ * advances the counter past them.
+ */
+static void ctr_keystream( CTR_BUFFER* buf, byte *ks, byte *counter, int blocksize, int n, void* akey, void (*func)(void*,void*))
+{
+	int k;
 
-			memxor( &plain[size], buf->enc_counter,
-				buf->c_counter_pos);
+	ctr_fill( ks, counter, blocksize, n);
+	if (buf->blocks_encrypt != NULL)
+		buf->blocks_encrypt(akey, ks, ks, n);
+	else for (k = 0; k < n; k++)
+		func(akey, &ks[k * blocksize]);
+}
 
-			/* buf->c_counter_pos remains the same */
+/* Makes sure at least want bytes (rounded up to whole blocks, and at
+ * most the size of the reservoir) of keystream are waiting in ks.
+ */
+static void ctr_refill( CTR_BUFFER* buf, int want, int blocksize, void* akey, void (*func)(void*,void*))
+{
+	byte *ks = (byte *) buf->ks;
+	byte counter[MODE_MAX_BLOCK_SIZE];
+	int cap = sizeof(buf->ks) / blocksize * blocksize;
+	int n;
+
+	if (want > cap)
+		want = cap;
+	if (buf->ks_len - buf->ks_pos >= want)
+		return;
+
+	memmove( ks, &ks[buf->ks_pos], buf->ks_len - buf->ks_pos);
+	buf->ks_len -= buf->ks_pos;
+	buf->ks_pos = 0;
+
+	/* the counter of the first block that is not in ks yet */
+	memcpy( counter, buf->c_counter, blocksize);
+	ctr_add( counter, blocksize,
+		 (buf->c_counter_pos != 0) + buf->ks_len / blocksize);
+
+	n = (want - buf->ks_len + blocksize - 1) / blocksize;
+	ctr_keystream( buf, &ks[buf->ks_len], counter, blocksize, n, akey, func);
+	buf->ks_len += n * blocksize;
+}
 
-		}
-	} else { /* xor_size != blocksize */
-		if (buf->c_counter_pos == 0) {
-			memcpy( buf->enc_counter, buf->c_counter, blocksize);
-			_mcrypt_block_encrypt(akey, buf->enc_counter);
+/* Computes at least len bytes of keystream ahead of time, and from then
+ * on refills the reservoir whenever a call finds it empty. A len of 0
+ * stops the refilling. Returns the number of bytes ready.
+ */
+int _mcrypt_prefetch( CTR_BUFFER* buf, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	if (len < 0)
+		return -1;
 
-			memxor( plain, buf->enc_counter, xor_size);
-			buf->c_counter_pos = xor_size;
-		} else {
-			int size = blocksize - buf->c_counter_pos;
-			int min_size =  size < xor_size ? size: xor_size;
+	buf->prefetch = len > 0;
+	if (len > 0)
+		ctr_refill( buf, len, blocksize, akey, func);
 
-			memxor( plain, &buf->enc_counter[buf->c_counter_pos],
-				min_size); 
+	return buf->ks_len - buf->ks_pos;
+}
 
-			buf->c_counter_pos += min_size;
+/* Sets out to in XOR len bytes of keystream, eight bytes at a time.
+ * out may be the same buffer as in.
+ */
+static void ctr_xor( byte *out, const byte *in, const byte *ks, int len)
+{
+	unsigned long long a, b;
 
-			if (min_size >= xor_size)
-				return;
+	for (; len >= 8; len -= 8, out += 8, in += 8, ks += 8) {
+		memcpy( &a, in, 8);
+		memcpy( &b, ks, 8);
+		a ^= b;
+		memcpy( out, &a, 8);
+	}
+	for (; len > 0; len--)
+		*out++ = *in++ ^ *ks++;
+}
 
-			increase_counter( buf->c_counter, blocksize);
+/* Encrypts (or decrypts) from in to out, which may be the same buffer */
+int _mcrypt_out( CTR_BUFFER* buf, const void *in, void *out, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{				/* plaintext can be any size */
+	word32 tmp[CTR_BULK_BYTES / sizeof(word32)];
+	byte *ks = (byte *) tmp;
+	const byte *plain = in;
+	byte *cipher = out;
+	void (*_mcrypt_block_encrypt) (void *, void *);
+	int n, size;
 
-			memcpy( buf->enc_counter, buf->c_counter, blocksize);
-			_mcrypt_block_encrypt(akey, buf->enc_counter);
+	_mcrypt_block_encrypt = func;
 
-			memxor( &plain[min_size], buf->enc_counter,
-				xor_size - min_size);
+	/* Use up what is left of the last keystream block. The counter
+	 * is only advanced once all of it has been used.
+	 */
+	if (buf->c_counter_pos != 0) {
+		size = blocksize - buf->c_counter_pos;
+		if (size > len) size = len;
 
-			buf->c_counter_pos = xor_size - min_size;
+		ctr_xor( cipher, plain, &buf->enc_counter[buf->c_counter_pos], size);
+		buf->c_counter_pos += size;
+		plain += size;
+		cipher += size;
+		len -= size;
 
+		if (buf->c_counter_pos == blocksize) {
+			increase_counter( buf->c_counter, blocksize);
+			buf->c_counter_pos = 0;
 		}
-	
 	}
-	return;
-}
-
-int _mcrypt( CTR_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
-{				/* plaintext can be any size */
-	byte *plain;
-	word32 *fplain = plaintext;
-	int i, j=0;
-	int modlen;
 
-	plain = plaintext;
-	for (j = 0; j < len / blocksize; j++) {
+	/* Then the keystream computed ahead. A short request that finds
+	 * it empty refills all of it when prefetching is on, so that the
+	 * next ones are only an XOR.
+	 */
+	while (len > 0) {
+		byte *rks = (byte *) buf->ks;
+
+		if (buf->ks_pos == buf->ks_len) {
+			if (!buf->prefetch || len >= sizeof(buf->ks))
+				break;
+			ctr_refill( buf, sizeof(buf->ks), blocksize, akey, func);
+		}
 
-		xor_stuff( buf, akey, func, plain, blocksize, blocksize);
+		size = buf->ks_len - buf->ks_pos;
+		if (size > len) size = len;
+
+		ctr_xor( cipher, plain, &rks[buf->ks_pos], size);
+		n = size / blocksize;
+		ctr_add( buf->c_counter, blocksize, n);
+		buf->ks_pos += n * blocksize;
+		if (size % blocksize != 0) {
+			/* the rest of this block goes on from enc_counter */
+			memcpy( buf->enc_counter, &rks[buf->ks_pos], blocksize);
+			buf->ks_pos += blocksize;
+			buf->c_counter_pos = size % blocksize;
+		}
+		plain += size;
+		cipher += size;
+		len -= size;
+	}
 
-		plain += blocksize;
+	/* Whole blocks: lay out a run of counters, encrypt them all and
+	 * XOR the lot in one pass.
+	 */
+	while (len >= blocksize) {
+		n = sizeof(tmp) / blocksize;
+		if (n > len / blocksize) n = len / blocksize;
 
-/* Put the new register */
+		ctr_keystream( buf, ks, buf->c_counter, blocksize, n, akey, func);
 
+		ctr_xor( cipher, plain, ks, n * blocksize);
+		plain += n * blocksize;
+		cipher += n * blocksize;
+		len -= n * blocksize;
 	}
-	modlen = len % blocksize;
-	if (modlen > 0) {
-		/* This is only usefull if encrypting the
-		 * final block. Otherwise you'll not be
-		 * able to decrypt it.
-		 */
 
-		xor_stuff( buf, akey, func, plain, blocksize, modlen);
+	/* a partial block; the rest of its keystream is kept for later */
+	if (len > 0) {
+		memcpy( buf->enc_counter, buf->c_counter, blocksize);
+		_mcrypt_block_encrypt(akey, buf->enc_counter);
 
+		ctr_xor( cipher, plain, buf->enc_counter, len);
+		buf->c_counter_pos = len;
 	}
 	
 	return 0;
 }
 
+int _mcrypt( CTR_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{				/* plaintext can be any size */
+	return _mcrypt_out( buf, plaintext, plaintext, len, blocksize, akey, func, func2);
+}
+
+int _mdecrypt_out( CTR_BUFFER* buf, const void *in, void *out, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{				/* plaintext can be any size */
+	return _mcrypt_out( buf, in, out, len, blocksize, akey, func, func2);
+}
 
 int _mdecrypt( CTR_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
 {				/* plaintext can be any size */
-	return _mcrypt( buf, plaintext, len, blocksize, akey, func, func2);
+	return _mcrypt_out( buf, plaintext, plaintext, len, blocksize, akey, func, func2);
 }
 
 int _has_iv() { return 1; }
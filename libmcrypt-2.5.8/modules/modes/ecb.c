@@ -34,55 +34,109 @@
 #define _mcrypt_get_modes_name ecb_LTX__mcrypt_get_modes_name
 #define _mcrypt_mode_get_size ecb_LTX__mcrypt_mode_get_size
 #define _mcrypt_mode_version ecb_LTX__mcrypt_mode_version
+#define _mcrypt_set_blocks ecb_LTX__mcrypt_set_blocks
+#define _mcrypt_out ecb_LTX__mcrypt_out
+#define _mdecrypt_out ecb_LTX__mdecrypt_out
 
-int _init_mcrypt( void* ign, void *key, int lenofkey, void *IV, int size)
+typedef struct ecb_buf {
+	void (*blocks_encrypt)(void*,const void*,void*,int);
+	void (*blocks_decrypt)(void*,const void*,void*,int);
+} ECB_BUFFER;
+
+int _init_mcrypt( ECB_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
 {
+	buf->blocks_encrypt = NULL;
+	buf->blocks_decrypt = NULL;
 	return 0;
 
 }
 
-int _mcrypt_set_state( void* buf, void *IV, int size) { return -1; }
-int _mcrypt_get_state( void* buf, void *IV, int *size) { return -1; }
+/* Called after _init_mcrypt() when the algorithm also exports the
+ * optional _mcrypt_encrypt_blocks()/_mcrypt_decrypt_blocks() entry
+ * points. Either may be NULL.
+ */
+int _mcrypt_set_blocks( ECB_BUFFER* buf, void (*func)(void*,const void*,void*,int), void (*func2)(void*,const void*,void*,int))
+{
+	buf->blocks_encrypt = func;
+	buf->blocks_decrypt = func2;
+	return 0;
+}
+
+int _mcrypt_set_state( ECB_BUFFER* buf, void *IV, int size) { return -1; }
+int _mcrypt_get_state( ECB_BUFFER* buf, void *IV, int *size) { return -1; }
 
-int _end_mcrypt (void* buf) {return 0;}
+int _end_mcrypt (ECB_BUFFER* buf) {return 0;}
 
-int _mcrypt( void* ign, void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+/* Encrypts from in to out, which may be the same buffer */
+int _mcrypt_out( ECB_BUFFER* buf, const void *in, void *out, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
 {
 	int j;
-	char *plain = plaintext;
+	const char *plain = in;
+	char *cipher = out;
 	void (*_mcrypt_block_encrypt) (void *, void *);
 
 	_mcrypt_block_encrypt = func;
+
+	if (buf->blocks_encrypt != NULL) {
+		j = len / blocksize;
+		if (j > 0)
+			buf->blocks_encrypt(akey, plain, cipher, j);
+		if (j<=0 && len!=0) return -1;
+		return 0;
+	}
 	
 	for (j = 0; j < len / blocksize; j++) {
-		_mcrypt_block_encrypt(akey, &plain[j * blocksize]);
+		if (cipher != plain)
+			memcpy(&cipher[j * blocksize], &plain[j * blocksize], blocksize);
+		_mcrypt_block_encrypt(akey, &cipher[j * blocksize]);
 	}
 	if (j==0 && len!=0) return -1; /* no blocks were encrypted */
 	return 0;
 }
 
+int _mcrypt( ECB_BUFFER* buf, void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return _mcrypt_out( buf, plaintext, plaintext, len, blocksize, akey, func, func2);
+}
 
 
-int _mdecrypt( void* ign, void *ciphertext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+/* Decrypts from in to out, which may be the same buffer */
+int _mdecrypt_out( ECB_BUFFER* buf, const void *in, void *out, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
 {
 	int j;
-	char *cipher = ciphertext;
+	const char *cipher = in;
+	char *plain = out;
 	void (*_mcrypt_block_decrypt) (void *, void *);
 
 	_mcrypt_block_decrypt = func2;
+
+	if (buf->blocks_decrypt != NULL) {
+		j = len / blocksize;
+		if (j > 0)
+			buf->blocks_decrypt(akey, cipher, plain, j);
+		if (j<=0 && len!=0) return -1;
+		return 0;
+	}
 	
 	for (j = 0; j < len / blocksize; j++) {
-		_mcrypt_block_decrypt(akey, &cipher[j * blocksize]);
+		if (plain != cipher)
+			memcpy(&plain[j * blocksize], &cipher[j * blocksize], blocksize);
+		_mcrypt_block_decrypt(akey, &plain[j * blocksize]);
 	}
 	if (j==0 && len!=0) return -1; /* no blocks were encrypted */
 	return 0;
 }
 
+int _mdecrypt( ECB_BUFFER* buf, void *ciphertext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return _mdecrypt_out( buf, ciphertext, ciphertext, len, blocksize, akey, func, func2);
+}
+
 int _has_iv() { return 0; }
 int _is_block_mode() { return 1; }
 int _is_block_algorithm_mode() { return 1; }
 const char *_mcrypt_get_modes_name() { return "ECB";}
-int _mcrypt_mode_get_size () {return 0;}
+int _mcrypt_mode_get_size () {return sizeof(ECB_BUFFER);}
 
 word32 _mcrypt_mode_version() {
 	return 20010801;
@@ -0,0 +1,686 @@
+/*
+ * Copyright (C) 2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_modules.h>
+#include "mode_buf.h"
+#include "../algorithms/simd.h"
+
+#define _init_mcrypt gcm_LTX__init_mcrypt
+#define _mcrypt_set_state gcm_LTX__mcrypt_set_state
+#define _mcrypt_get_state gcm_LTX__mcrypt_get_state
+#define _end_mcrypt gcm_LTX__end_mcrypt
+#define _mcrypt gcm_LTX__mcrypt
+#define _mdecrypt gcm_LTX__mdecrypt
+#define _has_iv gcm_LTX__has_iv
+#define _is_block_mode gcm_LTX__is_block_mode
+#define _is_block_algorithm_mode gcm_LTX__is_block_algorithm_mode
+#define _mcrypt_get_modes_name gcm_LTX__mcrypt_get_modes_name
+#define _mcrypt_mode_get_size gcm_LTX__mcrypt_mode_get_size
+#define _mcrypt_mode_version gcm_LTX__mcrypt_mode_version
+#define _mcrypt_set_blocks gcm_LTX__mcrypt_set_blocks
+#define _mcrypt_out gcm_LTX__mcrypt_out
+#define _mdecrypt_out gcm_LTX__mdecrypt_out
+#define _mcrypt_aad gcm_LTX__mcrypt_aad
+#define _mcrypt_get_tag gcm_LTX__mcrypt_get_tag
+#define _mdecrypt_verify_tag gcm_LTX__mdecrypt_verify_tag
+
+/* GCM (NIST SP 800-38D): CTR encryption with a 32 bit counter, and
+ * GHASH over the additional data and the ciphertext for the tag. Only
+ * for algorithms with 128 bit blocks.
+ *
+ * GHASH is a multiplication by H = E(0^128) in GF(2^128). The portable
+ * code uses Shoup's 4 bit tables; on x86 with PCLMULQDQ four blocks
+ * are multiplied by H^4..H at a time and reduced once.
+ */
+
+#define GCM_BLOCK_SIZE 16
+#define GCM_MIN_TAG_SIZE 4
+
+/* Size of the keystream buffer; the data is hashed in pieces of this
+ * size right next to its encryption, while it is still in the cache.
+ */
+#define GCM_BULK_BYTES 1024
+
+typedef struct gcm_buf {
+	byte iv[GCM_BLOCK_SIZE];
+	int iv_size;
+	byte H[GCM_BLOCK_SIZE];
+	byte J0[GCM_BLOCK_SIZE];
+	byte counter[GCM_BLOCK_SIZE];
+	byte enc_counter[GCM_BLOCK_SIZE];
+	int c_counter_pos;
+	byte X[GCM_BLOCK_SIZE];		/* GHASH accumulator */
+	byte ghash_buf[GCM_BLOCK_SIZE];	/* partial block to be hashed */
+	int ghash_pos;
+	unsigned long long aad_len;
+	unsigned long long text_len;
+	byte tag[GCM_BLOCK_SIZE];
+	int h_ready;	/* H and its tables are set up */
+	int started;	/* J0 is set up for the current IV */
+	int in_text;	/* the additional data is complete */
+	int final;	/* the tag has been computed */
+	unsigned long long HL[16], HH[16];
+	byte Hpow[4][GCM_BLOCK_SIZE];	/* H^1..H^4, byte reversed */
+	int use_pclmul;
+	void (*blocks_encrypt)(void*,const void*,void*,int);
+} GCM_BUFFER;
+
+/* GCM MODE */
+
+static word32 gcm_get32( const byte *x)
+{
+	return ((word32) x[0] << 24) | ((word32) x[1] << 16) |
+	    ((word32) x[2] << 8) | x[3];
+}
+
+static void gcm_put32( byte *x, word32 v)
+{
+	x[0] = v >> 24;
+	x[1] = v >> 16;
+	x[2] = v >> 8;
+	x[3] = v;
+}
+
+static unsigned long long gcm_get64( const byte *x)
+{
+	return ((unsigned long long) gcm_get32(x) << 32) | gcm_get32(&x[4]);
+}
+
+static void gcm_put64( byte *x, unsigned long long v)
+{
+	gcm_put32( x, v >> 32);
+	gcm_put32( &x[4], v);
+}
+
+/* Portable GHASH, after Shoup: HL/HH hold i*H for every 4 bit i, and
+ * the product is formed a nibble at a time from the end.
+ */
+static const unsigned long long gcm_last4[16] = {
+	0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+	0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static void gcm_gen_table( GCM_BUFFER *buf)
+{
+	unsigned long long vh, vl, *hl, *hh;
+	int i, j;
+
+	vh = gcm_get64( buf->H);
+	vl = gcm_get64( &buf->H[8]);
+
+	buf->HL[8] = vl;
+	buf->HH[8] = vh;
+	buf->HL[0] = 0;
+	buf->HH[0] = 0;
+
+	for (i = 4; i > 0; i >>= 1) {
+		unsigned long long t = (vl & 1) * 0xe1000000ULL;
+		vl = (vh << 63) | (vl >> 1);
+		vh = (vh >> 1) ^ (t << 32);
+		buf->HL[i] = vl;
+		buf->HH[i] = vh;
+	}
+
+	for (i = 2; i <= 8; i *= 2) {
+		hl = &buf->HL[i];
+		hh = &buf->HH[i];
+		vh = *hh;
+		vl = *hl;
+		for (j = 1; j < i; j++) {
+			hh[j] = vh ^ buf->HH[j];
+			hl[j] = vl ^ buf->HL[j];
+		}
+	}
+}
+
+/* x = x * H */
+static void gcm_mult( const GCM_BUFFER *buf, byte *x)
+{
+	unsigned long long zh, zl;
+	int i, lo, hi, rem;
+
+	lo = x[15] & 0xf;
+	zh = buf->HH[lo];
+	zl = buf->HL[lo];
+
+	for (i = 15; i >= 0; i--) {
+		lo = x[i] & 0xf;
+		hi = x[i] >> 4;
+
+		if (i != 15) {
+			rem = zl & 0xf;
+			zl = (zh << 60) | (zl >> 4);
+			zh = (zh >> 4) ^ (gcm_last4[rem] << 48);
+			zh ^= buf->HH[lo];
+			zl ^= buf->HL[lo];
+		}
+
+		rem = zl & 0xf;
+		zl = (zh << 60) | (zl >> 4);
+		zh = (zh >> 4) ^ (gcm_last4[rem] << 48);
+		zh ^= buf->HH[hi];
+		zl ^= buf->HL[hi];
+	}
+
+	gcm_put64( x, zh);
+	gcm_put64( &x[8], zl);
+}
+
+#ifdef MCRYPT_X86_SIMD
+/* The carry-less product of a and b, unreduced, as lo:hi. */
+# define GCM_CLMUL(a, b, lo, hi) do { \
+	__m128i _m0 = _mm_clmulepi64_si128((a), (b), 0x00); \
+	__m128i _m1 = _mm_xor_si128(_mm_clmulepi64_si128((a), (b), 0x10), \
+				    _mm_clmulepi64_si128((a), (b), 0x01)); \
+	(lo) = _mm_xor_si128((lo), _mm_xor_si128(_m0, _mm_slli_si128(_m1, 8))); \
+	(hi) = _mm_xor_si128((hi), _mm_xor_si128( \
+		_mm_clmulepi64_si128((a), (b), 0x11), _mm_srli_si128(_m1, 8))); \
+	} while(0)
+
+/* Reduces lo:hi modulo the GCM polynomial, taking care of the bit
+ * reflection of the operands (Intel's carry-less multiplication
+ * white paper, figure 5).
+ */
+X86_TARGET("pclmul,ssse3")
+static __m128i gcm_reduce( __m128i lo, __m128i hi)
+{
+	__m128i t0, t1, t2;
+
+	/* shift the 256 bit product left by one */
+	t0 = _mm_srli_epi32(lo, 31);
+	t1 = _mm_srli_epi32(hi, 31);
+	lo = _mm_slli_epi32(lo, 1);
+	hi = _mm_slli_epi32(hi, 1);
+	t2 = _mm_srli_si128(t0, 12);
+	t1 = _mm_slli_si128(t1, 4);
+	t0 = _mm_slli_si128(t0, 4);
+	lo = _mm_or_si128(lo, t0);
+	hi = _mm_or_si128(hi, t1);
+	hi = _mm_or_si128(hi, t2);
+
+	t0 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31),
+					 _mm_slli_epi32(lo, 30)),
+			   _mm_slli_epi32(lo, 25));
+	t1 = _mm_srli_si128(t0, 4);
+	t0 = _mm_slli_si128(t0, 12);
+	lo = _mm_xor_si128(lo, t0);
+
+	t2 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1),
+					 _mm_srli_epi32(lo, 2)),
+			   _mm_srli_epi32(lo, 7));
+	t2 = _mm_xor_si128(t2, t1);
+	lo = _mm_xor_si128(lo, t2);
+	return _mm_xor_si128(hi, lo);
+}
+
+X86_TARGET("pclmul,ssse3")
+static __m128i gcm_mul_pclmul( __m128i a, __m128i b)
+{
+	__m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+	GCM_CLMUL(a, b, lo, hi);
+	return gcm_reduce(lo, hi);
+}
+
+X86_TARGET("pclmul,ssse3")
+static void gcm_init_pclmul( GCM_BUFFER *buf)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+					   8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i h, p;
+	int i;
+
+	h = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) buf->H), bswap);
+	p = h;
+	_mm_storeu_si128((__m128i *) buf->Hpow[0], p);
+	for (i = 1; i < 4; i++) {
+		p = gcm_mul_pclmul(p, h);
+		_mm_storeu_si128((__m128i *) buf->Hpow[i], p);
+	}
+}
+
+X86_TARGET("pclmul,ssse3")
+static void gcm_ghash_pclmul( GCM_BUFFER *buf, const byte *in, int nblocks)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+					   8, 9, 10, 11, 12, 13, 14, 15);
+	__m128i x, h1, h2, h3, h4, b0, b1, b2, b3, lo, hi;
+
+	x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) buf->X), bswap);
+	h1 = _mm_loadu_si128((const __m128i *) buf->Hpow[0]);
+	h2 = _mm_loadu_si128((const __m128i *) buf->Hpow[1]);
+	h3 = _mm_loadu_si128((const __m128i *) buf->Hpow[2]);
+	h4 = _mm_loadu_si128((const __m128i *) buf->Hpow[3]);
+
+	/* (((x+b0)H + b1)H + b2)H + b3)H
+	 *   = (x+b0)H^4 + b1 H^3 + b2 H^2 + b3 H */
+	for (; nblocks >= 4; nblocks -= 4, in += 4 * GCM_BLOCK_SIZE) {
+		b0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) in), bswap);
+		b1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) &in[16]), bswap);
+		b2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) &in[32]), bswap);
+		b3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) &in[48]), bswap);
+		b0 = _mm_xor_si128(b0, x);
+
+		lo = _mm_setzero_si128();
+		hi = _mm_setzero_si128();
+		GCM_CLMUL(b0, h4, lo, hi);
+		GCM_CLMUL(b1, h3, lo, hi);
+		GCM_CLMUL(b2, h2, lo, hi);
+		GCM_CLMUL(b3, h1, lo, hi);
+		x = gcm_reduce(lo, hi);
+	}
+
+	for (; nblocks > 0; nblocks--, in += GCM_BLOCK_SIZE) {
+		b0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) in), bswap);
+		x = gcm_mul_pclmul(_mm_xor_si128(x, b0), h1);
+	}
+
+	_mm_storeu_si128((__m128i *) buf->X, _mm_shuffle_epi8(x, bswap));
+}
+#endif
+
+/* Sets out to in XOR len bytes of ks (the keystream, or a block to
+ * hash), eight bytes at a time; out may be in.
+ */
+static void gcm_xor( byte *out, const byte *in, const byte *ks, int len)
+{
+	unsigned long long a, b;
+
+	for (; len >= 8; len -= 8, out += 8, in += 8, ks += 8) {
+		memcpy( &a, in, 8);
+		memcpy( &b, ks, 8);
+		a ^= b;
+		memcpy( out, &a, 8);
+	}
+	for (; len > 0; len--)
+		*out++ = *in++ ^ *ks++;
+}
+
+/* Hashes nblocks whole blocks into the accumulator */
+static void gcm_ghash_blocks( GCM_BUFFER *buf, const byte *in, int nblocks)
+{
+#ifdef MCRYPT_X86_SIMD
+	if (buf->use_pclmul) {
+		gcm_ghash_pclmul( buf, in, nblocks);
+		return;
+	}
+#endif
+	for (; nblocks > 0; nblocks--, in += GCM_BLOCK_SIZE) {
+		gcm_xor( buf->X, buf->X, in, GCM_BLOCK_SIZE);
+		gcm_mult( buf, buf->X);
+	}
+}
+
+/* Hashes len bytes of a stream of any length; a partial block is kept
+ * until it is completed or padded by gcm_ghash_flush().
+ */
+static void gcm_ghash_update( GCM_BUFFER *buf, const byte *in, int len)
+{
+	int n;
+
+	if (buf->ghash_pos > 0) {
+		n = GCM_BLOCK_SIZE - buf->ghash_pos;
+		if (n > len) n = len;
+		memcpy( &buf->ghash_buf[buf->ghash_pos], in, n);
+		buf->ghash_pos += n;
+		in += n;
+		len -= n;
+		if (buf->ghash_pos < GCM_BLOCK_SIZE)
+			return;
+		gcm_ghash_blocks( buf, buf->ghash_buf, 1);
+		buf->ghash_pos = 0;
+	}
+
+	n = len / GCM_BLOCK_SIZE;
+	gcm_ghash_blocks( buf, in, n);
+	in += n * GCM_BLOCK_SIZE;
+	len -= n * GCM_BLOCK_SIZE;
+
+	if (len > 0) {
+		memcpy( buf->ghash_buf, in, len);
+		buf->ghash_pos = len;
+	}
+}
+
+static void gcm_ghash_flush( GCM_BUFFER *buf)
+{
+	if (buf->ghash_pos > 0) {
+		memset( &buf->ghash_buf[buf->ghash_pos], 0,
+			GCM_BLOCK_SIZE - buf->ghash_pos);
+		gcm_ghash_blocks( buf, buf->ghash_buf, 1);
+		buf->ghash_pos = 0;
+	}
+}
+
+/* The hash key depends on the key only, so it is computed on the first
+ * call after _init_mcrypt(); J0 depends on the IV and is computed on
+ * the first call after _init_mcrypt() or _mcrypt_set_state().
+ */
+static void gcm_start( GCM_BUFFER *buf, void* akey, void (*func)(void*,void*))
+{
+	byte len_block[GCM_BLOCK_SIZE];
+
+	if (!buf->h_ready) {
+		memset( buf->H, 0, GCM_BLOCK_SIZE);
+		func(akey, buf->H);
+		gcm_gen_table( buf);
+#ifdef MCRYPT_X86_SIMD
+		buf->use_pclmul = x86_has_pclmul() && x86_has_ssse3();
+		if (buf->use_pclmul)
+			gcm_init_pclmul( buf);
+#endif
+		buf->h_ready = 1;
+	}
+
+	memset( buf->X, 0, GCM_BLOCK_SIZE);
+	buf->ghash_pos = 0;
+
+	if (buf->iv_size == 12) {
+		memcpy( buf->J0, buf->iv, 12);
+		gcm_put32( &buf->J0[12], 1);
+	} else {
+		gcm_ghash_update( buf, buf->iv, buf->iv_size);
+		gcm_ghash_flush( buf);
+		memset( len_block, 0, 8);
+		gcm_put64( &len_block[8], (unsigned long long) buf->iv_size * 8);
+		gcm_ghash_blocks( buf, len_block, 1);
+		memcpy( buf->J0, buf->X, GCM_BLOCK_SIZE);
+		memset( buf->X, 0, GCM_BLOCK_SIZE);
+	}
+
+	memcpy( buf->counter, buf->J0, GCM_BLOCK_SIZE);
+	gcm_put32( &buf->counter[12], gcm_get32( &buf->J0[12]) + 1);
+
+	buf->c_counter_pos = 0;
+	buf->aad_len = 0;
+	buf->text_len = 0;
+	buf->in_text = 0;
+	buf->final = 0;
+	buf->started = 1;
+}
+
+/* size holds the size of the IV, which is the block size. Other IV
+ * sizes, such as the usual 12 bytes, can be set with
+ * _mcrypt_set_state().
+ */
+int _init_mcrypt( GCM_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
+{
+	if (size != GCM_BLOCK_SIZE)
+		return -1;
+
+	buf->iv_size = size;
+	if (IV != NULL)
+		memcpy( buf->iv, IV, size);
+	else
+		memset( buf->iv, 0, size);
+
+	buf->h_ready = 0;
+	buf->started = 0;
+	buf->use_pclmul = 0;
+	buf->blocks_encrypt = NULL;
+
+	return 0;
+}
+
+/* The state is the IV; setting it starts a new message with the same
+ * key.
+ */
+int _mcrypt_set_state( GCM_BUFFER* buf, byte *IV, int size)
+{
+	if (size <= 0 || size > GCM_BLOCK_SIZE)
+		return -1;
+
+	buf->iv_size = size;
+	memcpy( buf->iv, IV, size);
+	buf->started = 0;
+
+	return 0;
+}
+
+int _mcrypt_get_state( GCM_BUFFER* buf, byte *IV, int *size)
+{
+	if (*size < buf->iv_size) {
+		*size = buf->iv_size;
+		return -1;
+	}
+	*size = buf->iv_size;
+
+	memcpy( IV, buf->iv, buf->iv_size);
+
+	return 0;
+}
+
+/* Called after _init_mcrypt() when the algorithm also exports the
+ * optional multi-block entry points. Only encryption is needed here.
+ */
+int _mcrypt_set_blocks( GCM_BUFFER* buf, void (*func)(void*,const void*,void*,int), void (*func2)(void*,const void*,void*,int))
+{
+	buf->blocks_encrypt = func;
+	return 0;
+}
+
+void _end_mcrypt( GCM_BUFFER* buf) {
+}
+
+/* Lays out the next n counter blocks in ks. Only the last 32 bits are
+ * incremented, modulo 2^32.
+ */
+static void gcm_fill( byte *ks, byte *counter, int n)
+{
+	word32 c = gcm_get32( &counter[12]);
+	int k;
+
+	for (k = 0; k < n; k++, ks += GCM_BLOCK_SIZE) {
+		memcpy( ks, counter, 12);
+		gcm_put32( &ks[12], c++);
+	}
+	gcm_put32( &counter[12], c);
+}
+
+/* The CTR part; len is at most GCM_BULK_BYTES */
+static void gcm_ctr( GCM_BUFFER* buf, const byte *in, byte *out, int len, void* akey, void (*func)(void*,void*))
+{
+	word32 tmp[GCM_BULK_BYTES / sizeof(word32)];
+	byte *ks = (byte *) tmp;
+	int k, n, size;
+
+	if (buf->c_counter_pos != 0) {
+		size = GCM_BLOCK_SIZE - buf->c_counter_pos;
+		if (size > len) size = len;
+
+		gcm_xor( out, in, &buf->enc_counter[buf->c_counter_pos], size);
+		buf->c_counter_pos = (buf->c_counter_pos + size) % GCM_BLOCK_SIZE;
+		in += size;
+		out += size;
+		len -= size;
+	}
+
+	n = len / GCM_BLOCK_SIZE;
+	if (n > 0) {
+		gcm_fill( ks, buf->counter, n);
+		if (buf->blocks_encrypt != NULL)
+			buf->blocks_encrypt(akey, ks, ks, n);
+		else for (k = 0; k < n; k++)
+			func(akey, &ks[k * GCM_BLOCK_SIZE]);
+
+		gcm_xor( out, in, ks, n * GCM_BLOCK_SIZE);
+		in += n * GCM_BLOCK_SIZE;
+		out += n * GCM_BLOCK_SIZE;
+		len -= n * GCM_BLOCK_SIZE;
+	}
+
+	/* a partial block; the rest of its keystream is kept for later */
+	if (len > 0) {
+		gcm_fill( buf->enc_counter, buf->counter, 1);
+		func(akey, buf->enc_counter);
+
+		gcm_xor( out, in, buf->enc_counter, len);
+		buf->c_counter_pos = len;
+	}
+}
+
+static int gcm_crypt( GCM_BUFFER* buf, const byte *in, byte *out, int len, int blocksize, void* akey, void (*func)(void*,void*), int decrypt)
+{
+	int n;
+
+	if (blocksize != GCM_BLOCK_SIZE || len < 0)
+		return -1;
+	if (!buf->started)
+		gcm_start( buf, akey, func);
+	if (buf->final)
+		return -1;
+
+	if (!buf->in_text) {
+		gcm_ghash_flush( buf);
+		buf->in_text = 1;
+	}
+	buf->text_len += len;
+
+	while (len > 0) {
+		n = len < GCM_BULK_BYTES ? len : GCM_BULK_BYTES;
+
+		if (decrypt)
+			gcm_ghash_update( buf, in, n);
+		gcm_ctr( buf, in, out, n, akey, func);
+		if (!decrypt)
+			gcm_ghash_update( buf, out, n);
+
+		in += n;
+		out += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+int _mcrypt_out( GCM_BUFFER* buf, const void *in, void *out, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return gcm_crypt( buf, in, out, len, blocksize, akey, func, 0);
+}
+
+int _mcrypt( GCM_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return gcm_crypt( buf, plaintext, plaintext, len, blocksize, akey, func, 0);
+}
+
+int _mdecrypt_out( GCM_BUFFER* buf, const void *in, void *out, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return gcm_crypt( buf, in, out, len, blocksize, akey, func, 1);
+}
+
+int _mdecrypt( GCM_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	return gcm_crypt( buf, plaintext, plaintext, len, blocksize, akey, func, 1);
+}
+
+/* Additional data is authenticated but not encrypted. It may be given
+ * in several calls, but all of it before the first _mcrypt() or
+ * _mdecrypt().
+ */
+int _mcrypt_aad( GCM_BUFFER* buf, const void *aad, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	if (blocksize != GCM_BLOCK_SIZE || len < 0)
+		return -1;
+	if (!buf->started)
+		gcm_start( buf, akey, func);
+	if (buf->in_text || buf->final)
+		return -1;
+
+	buf->aad_len += len;
+	gcm_ghash_update( buf, aad, len);
+
+	return 0;
+}
+
+static void gcm_final( GCM_BUFFER* buf, void* akey, void (*func)(void*,void*))
+{
+	byte len_block[GCM_BLOCK_SIZE];
+
+	if (!buf->started)
+		gcm_start( buf, akey, func);
+	if (buf->final)
+		return;
+
+	gcm_ghash_flush( buf);
+	gcm_put64( len_block, buf->aad_len * 8);
+	gcm_put64( &len_block[8], buf->text_len * 8);
+	gcm_ghash_blocks( buf, len_block, 1);
+
+	memcpy( buf->tag, buf->J0, GCM_BLOCK_SIZE);
+	func(akey, buf->tag);
+	memxor( buf->tag, buf->X, GCM_BLOCK_SIZE);
+
+	buf->final = 1;
+}
+
+/* Ends the message and returns the first len bytes of its tag. No
+ * more data can be processed until the IV is set again.
+ */
+int _mcrypt_get_tag( GCM_BUFFER* buf, void *tag, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	if (blocksize != GCM_BLOCK_SIZE ||
+	    len < GCM_MIN_TAG_SIZE || len > GCM_BLOCK_SIZE)
+		return -1;
+
+	gcm_final( buf, akey, func);
+	memcpy( tag, buf->tag, len);
+
+	return 0;
+}
+
+/* Ends the message and compares its tag to the len bytes in tag, in
+ * time independent of where they differ. Returns 0 when they match.
+ */
+int _mdecrypt_verify_tag( GCM_BUFFER* buf, const void *tag, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	const byte *t = tag;
+	byte diff = 0;
+	int i;
+
+	if (blocksize != GCM_BLOCK_SIZE ||
+	    len < GCM_MIN_TAG_SIZE || len > GCM_BLOCK_SIZE)
+		return -1;
+
+	gcm_final( buf, akey, func);
+	for (i = 0; i < len; i++)
+		diff |= buf->tag[i] ^ t[i];
+
+	return diff == 0 ? 0 : -1;
+}
+
+int _has_iv() { return 1; }
+int _is_block_mode() { return 0; }
+int _is_block_algorithm_mode() { return 1; }
+const char *_mcrypt_get_modes_name() { return "GCM";}
+int _mcrypt_mode_get_size () {return sizeof(GCM_BUFFER);}
+
+
+word32 _mcrypt_mode_version() {
+	return 20261018;
+}
+
+#ifdef WIN32
+# ifdef USE_LTDL
+WIN32DLL_DEFINE int main (void)
+{
+       /* empty main function to avoid linker error (see cygwin FAQ) */
+}
+# endif
+#endif
@@ -0,0 +1,12 @@
+#ifndef USE_MODULES
+int _gcm_init_mcrypt( int td, void* buf, void *key, int lenofkey, void *IV);
+int _mcrypt_gcm(int td, void* buf,void *plaintext, int len);
+int _mdecrypt_gcm(int td, void* buf, void *plaintext, int len);
+int _gcm_is_block_mode();
+int _gcm_has_iv();
+int _gcm_is_block_algorithm_mode();
+char *_mcrypt_gcm_get_modes_name();
+int _mcrypt_gcm_mode_get_size ();
+int _mcrypt_gcm_get_iv_size(int td);
+word32 _mcrypt_gcm_mode_version();
+#endif
@@ -0,0 +1,14 @@
+/* The registers of the modes are kept inside their state structures,
+ * sized for the largest block of any algorithm (Rijndael-256). That way
+ * _mcrypt_mode_get_size() covers the whole state and one allocation by
+ * the caller is all a mode needs.
+ */
+#define MODE_MAX_BLOCK_SIZE 32
+#define MODE_MAX_BLOCK_WORDS (MODE_MAX_BLOCK_SIZE / 4)
+
+/* Size of the keystream reservoir of the output feedback and counter
+ * modes (see _mcrypt_prefetch() in doc/README.modules). It holds a
+ * whole number of blocks of any size.
+ */
+#define MODE_KEYSTREAM_BYTES 512
+#define MODE_KEYSTREAM_WORDS (MODE_KEYSTREAM_BYTES / 4)
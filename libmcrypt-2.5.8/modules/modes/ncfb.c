@@ -19,6 +19,7 @@
 
 #include <libdefs.h>
 #include <mcrypt_modules.h>
+#include "mode_buf.h"
 
 #define _init_mcrypt ncfb_LTX__init_mcrypt
 #define _mcrypt_set_state ncfb_LTX__mcrypt_set_state
@@ -32,30 +33,32 @@
 #define _mcrypt_get_modes_name ncfb_LTX__mcrypt_get_modes_name
 #define _mcrypt_mode_get_size ncfb_LTX__mcrypt_mode_get_size
 #define _mcrypt_mode_version ncfb_LTX__mcrypt_mode_version
+#define _mcrypt_set_blocks ncfb_LTX__mcrypt_set_blocks
 
 typedef struct ncfb_buf {
-	byte*   enc_s_register;
-	byte* s_register;
+	byte enc_s_register[MODE_MAX_BLOCK_SIZE];
+	byte s_register[MODE_MAX_BLOCK_SIZE];
 	int   s_register_pos;
 	int   blocksize;
+	void (*blocks_encrypt)(void*,const void*,void*,int);
 } nCFB_BUFFER;
 
+/* Size of the keystream buffer used with multi-block encryption */
+#define NCFB_BULK_WORDS 256
+
 /* nCFB MODE */
 
 int _init_mcrypt( nCFB_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
 {
-    buf->enc_s_register = buf->s_register = NULL;
+    if (size > MODE_MAX_BLOCK_SIZE)
+	return -1;
+
     buf->s_register_pos = 0;
     
     buf->blocksize = size;
+    buf->blocks_encrypt = NULL;
 
 /* For cfb */
-	buf->enc_s_register=malloc( size);
-    if (buf->enc_s_register==NULL) goto freeall;
-    
-	buf->s_register=malloc( size);
-    if (buf->s_register==NULL) goto freeall;
-
 	if (IV!=NULL) {
 		memcpy(buf->enc_s_register, IV, size);
 		memcpy(buf->s_register, IV, size);
@@ -67,10 +70,6 @@ int _init_mcrypt( nCFB_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
 /* End ncfb */
 
 	return 0;
-	freeall:
-		free(buf->enc_s_register);
-		free(buf->s_register);
-		return -1;
 }
 
 int _mcrypt_set_state( nCFB_BUFFER* buf, byte *IV, int size)
@@ -96,9 +95,18 @@ int _mcrypt_get_state( nCFB_BUFFER* buf, byte *IV, int *size)
 	return 0;
 }
 
+/* Called after _init_mcrypt() when the algorithm also exports the
+ * optional multi-block entry points. Encryption feeds each ciphertext
+ * block back before the next one can be computed, so only decryption
+ * makes use of them.
+ */
+int _mcrypt_set_blocks( nCFB_BUFFER* buf, void (*func)(void*,const void*,void*,int), void (*func2)(void*,const void*,void*,int))
+{
+	buf->blocks_encrypt = func;
+	return 0;
+}
+
 void _end_mcrypt( nCFB_BUFFER* buf) {
-	free(buf->enc_s_register);
-	free(buf->s_register);
 }
 
 inline static
@@ -124,6 +132,9 @@ void xor_stuff_en( nCFB_BUFFER *buf, void* akey, void (*func)(void*,void*), byte
 
 			memxor( plain, &buf->enc_s_register[buf->s_register_pos],
 				size); 
+
+			memcpy( &buf->s_register[buf->s_register_pos],
+				plain, size);
 		
 			memcpy(buf->enc_s_register, buf->s_register, blocksize);
 
@@ -132,8 +143,8 @@ void xor_stuff_en( nCFB_BUFFER *buf, void* akey, void (*func)(void*,void*), byte
 			memxor( &plain[size], buf->enc_s_register,
 				buf->s_register_pos);
 
-			memcpy( &buf->s_register[size], 
-				plain, buf->s_register_pos);
+			memcpy( buf->s_register, 
+				&plain[size], buf->s_register_pos);
 
 			/* buf->s_register_pos remains the same */
 		}
@@ -166,12 +177,12 @@ void xor_stuff_en( nCFB_BUFFER *buf, void* akey, void (*func)(void*,void*), byte
 
 			_mcrypt_block_encrypt(akey, buf->enc_s_register);
 
-			memxor( &plain[min_size], buf->s_register,
+			memxor( &plain[min_size], buf->enc_s_register,
 				xor_size - min_size);
 
 			buf->s_register_pos = xor_size - min_size;
 
-			memcpy(buf->s_register, plain, xor_size - min_size);
+			memcpy(buf->s_register, &plain[min_size], xor_size - min_size);
 		}
 	
 	}
@@ -200,6 +211,9 @@ void xor_stuff_de( nCFB_BUFFER *buf, void* akey, void (*func)(void*,void*), byte
 		} else {
 			int size = blocksize - buf->s_register_pos;
 
+			memcpy( &buf->s_register[buf->s_register_pos],
+				cipher, size);
+
 			memxor( cipher, &buf->enc_s_register[buf->s_register_pos],
 				size); 
 		
@@ -207,8 +221,8 @@ void xor_stuff_de( nCFB_BUFFER *buf, void* akey, void (*func)(void*,void*), byte
 
 			_mcrypt_block_encrypt(akey, buf->enc_s_register);
 
-			memcpy( &buf->s_register[size], 
-				cipher, buf->s_register_pos);
+			memcpy( buf->s_register, 
+				&cipher[size], buf->s_register_pos);
 
 			memxor( &cipher[size], buf->enc_s_register,
 				buf->s_register_pos);
@@ -232,11 +246,11 @@ void xor_stuff_de( nCFB_BUFFER *buf, void* akey, void (*func)(void*,void*), byte
 			int size = blocksize - buf->s_register_pos;
 			int min_size =  size < xor_size ? size: xor_size;
 
+			memcpy( &buf->s_register[buf->s_register_pos], cipher, min_size);
+
 			memxor( cipher, &buf->enc_s_register[buf->s_register_pos],
 				min_size);
 
-			memcpy( &buf->s_register[buf->s_register_pos], cipher, min_size);
-
 			buf->s_register_pos += min_size;
 
 			if (min_size >= xor_size)
@@ -246,9 +260,9 @@ void xor_stuff_de( nCFB_BUFFER *buf, void* akey, void (*func)(void*,void*), byte
 
 			_mcrypt_block_encrypt(akey, buf->enc_s_register);
 
-			memcpy(buf->s_register, cipher, xor_size - min_size);
+			memcpy(buf->s_register, &cipher[min_size], xor_size - min_size);
 
-			memxor( &cipher[min_size], buf->s_register,
+			memxor( &cipher[min_size], buf->enc_s_register,
 				xor_size - min_size);
 
 			buf->s_register_pos = xor_size - min_size;
@@ -285,6 +299,34 @@ int _mcrypt( nCFB_BUFFER* buf,void *plaintext, int len, int blocksize, void* ake
 }
 
 
+/* On a block boundary the keystream for n whole blocks is the
+ * encryption of the shift register followed by the first n-1
+ * ciphertext blocks, all of which are known up front.
+ */
+static void ncfb_bulk_decrypt( nCFB_BUFFER* buf, byte* cipher, int nblocks, int blocksize, void* akey)
+{
+	word32 tmp[NCFB_BULK_WORDS];
+	byte *ks = (byte *) tmp;
+	int n;
+
+	while (nblocks > 0) {
+		n = sizeof(tmp) / blocksize;
+		if (n > nblocks) n = nblocks;
+
+		memcpy( ks, buf->s_register, blocksize);
+		memcpy( &ks[blocksize], cipher, (n - 1) * blocksize);
+		buf->blocks_encrypt(akey, ks, ks, n);
+
+		/* leave the state as xor_stuff_de() would */
+		memcpy( buf->s_register, &cipher[(n - 1) * blocksize], blocksize);
+		memcpy( buf->enc_s_register, &ks[(n - 1) * blocksize], blocksize);
+
+		memxor( cipher, ks, n * blocksize);
+		cipher += n * blocksize;
+		nblocks -= n;
+	}
+}
+
 int _mdecrypt( nCFB_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
 {				/* plaintext is n*blocksize bytes (nbit cfb) */
 	byte* plain;
@@ -295,7 +337,14 @@ int _mdecrypt( nCFB_BUFFER* buf,void *plaintext, int len, int blocksize, void* a
 	_mcrypt_block_encrypt = func;
 
 	plain = plaintext;
-	for (j = 0; j < len / blocksize; j++) {
+	if (buf->blocks_encrypt != NULL && buf->s_register_pos == 0 &&
+	    len / blocksize >= 2) {
+		j = len / blocksize;
+		ncfb_bulk_decrypt( buf, plain, j, blocksize, akey);
+		plain += j * blocksize;
+	}
+
+	for (; j < len / blocksize; j++) {
 		xor_stuff_de( buf, akey, func, plain, blocksize, blocksize); 
 		
 		plain += blocksize;
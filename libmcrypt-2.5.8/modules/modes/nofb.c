@@ -19,6 +19,7 @@
 
 #include <libdefs.h>
 #include <mcrypt_modules.h>
+#include "mode_buf.h"
 
 #define _init_mcrypt nofb_LTX__init_mcrypt
 #define _mcrypt_set_state nofb_LTX__mcrypt_set_state
@@ -32,29 +33,34 @@
 #define _mcrypt_get_modes_name nofb_LTX__mcrypt_get_modes_name
 #define _mcrypt_mode_get_size nofb_LTX__mcrypt_mode_get_size
 #define _mcrypt_mode_version nofb_LTX__mcrypt_mode_version
+#define _mcrypt_prefetch nofb_LTX__mcrypt_prefetch
 
 typedef struct ncfb_buf {
-	byte*   enc_s_register;
-	byte* s_register;
+	byte enc_s_register[MODE_MAX_BLOCK_SIZE];
+	byte s_register[MODE_MAX_BLOCK_SIZE];
 	int   s_register_pos;
 	int   blocksize;
+	/* Keystream of the blocks after the current one, computed ahead
+	 * of time; only whole blocks, the next one at ks_pos.
+	 */
+	byte  ks[MODE_KEYSTREAM_BYTES];
+	int   ks_pos, ks_len;
+	int   prefetch;		/* refill ks whenever it runs out */
 } nOFB_BUFFER;
 
 /* nOFB MODE */
 
 int _init_mcrypt( nOFB_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
 {
-    buf->enc_s_register = buf->s_register = NULL;
+    if (size > MODE_MAX_BLOCK_SIZE)
+	return -1;
+
     buf->s_register_pos = 0;
 
     buf->blocksize = size;    
+    buf->ks_pos = buf->ks_len = 0;
+    buf->prefetch = 0;
 /* For ofb */
-	buf->enc_s_register=malloc( size);
-    if (buf->enc_s_register==NULL) goto freeall;
-    
-	buf->s_register=malloc( size);
-    if (buf->s_register==NULL) goto freeall;
-
 	if (IV!=NULL) {
 		memcpy(buf->enc_s_register, IV, size);
 		memcpy(buf->s_register, IV, size);
@@ -66,10 +72,6 @@ int _init_mcrypt( nOFB_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
 /* End nofb */
 
 	return 0;
-	freeall:
-		free(buf->enc_s_register);
-		free(buf->s_register);
-		return -1;
 }
 
 int _mcrypt_set_state( nOFB_BUFFER* buf, byte *IV, int size)
@@ -77,6 +79,7 @@ int _mcrypt_set_state( nOFB_BUFFER* buf, byte *IV, int size)
 	buf->s_register_pos = IV[0];
 	memcpy(buf->enc_s_register, &IV[1], size-1);
 	memcpy(buf->s_register, &IV[1], size-1);
+	buf->ks_pos = buf->ks_len = 0;
 
 	return 0;
 }
@@ -97,8 +100,6 @@ int _mcrypt_get_state( nOFB_BUFFER* buf, byte *IV, int *size)
 
 
 void _end_mcrypt( nOFB_BUFFER* buf) {
-	free(buf->s_register);
-	free(buf->enc_s_register);
 }
 
 inline static
@@ -178,16 +179,103 @@ void xor_stuff( nOFB_BUFFER *buf, void* akey, void (*func)(void*,void*), byte* p
 }
 
 
+/* Makes sure at least want bytes (rounded up to whole blocks, and at
+ * most the size of the reservoir) of keystream are waiting in ks. Each
+ * block is the encryption of the one before it.
+ */
+static void nofb_refill( nOFB_BUFFER* buf, int want, int blocksize, void* akey, void (*func)(void*,void*))
+{
+	int cap = sizeof(buf->ks) / blocksize * blocksize;
+	const byte *prev;
+
+	if (want > cap)
+		want = cap;
+	if (buf->ks_len - buf->ks_pos >= want)
+		return;
+
+	memmove( buf->ks, &buf->ks[buf->ks_pos], buf->ks_len - buf->ks_pos);
+	buf->ks_len -= buf->ks_pos;
+	buf->ks_pos = 0;
+
+	prev = buf->ks_len > 0 ? &buf->ks[buf->ks_len - blocksize] :
+		buf->s_register;
+	for (; buf->ks_len < want; buf->ks_len += blocksize) {
+		memcpy( &buf->ks[buf->ks_len], prev, blocksize);
+		func(akey, &buf->ks[buf->ks_len]);
+		prev = &buf->ks[buf->ks_len];
+	}
+}
+
+/* Computes at least len bytes of keystream ahead of time, and from then
+ * on refills the reservoir whenever a call finds it empty. A len of 0
+ * stops the refilling. Returns the number of bytes ready.
+ */
+int _mcrypt_prefetch( nOFB_BUFFER* buf, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	if (len < 0)
+		return -1;
+
+	buf->prefetch = len > 0;
+	if (len > 0)
+		nofb_refill( buf, len, blocksize, akey, func);
+
+	return buf->ks_len - buf->ks_pos;
+}
+
 int _mcrypt( nOFB_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
 {				/* plaintext is n*blocksize bytes (nbit cfb) */
 	byte* plain;
 	int i, j=0;
 	void (*_mcrypt_block_encrypt) (void *, void *);
-	int modlen;
+	int modlen, size, n;
 	
 	_mcrypt_block_encrypt = func;
 
 	plain = plaintext;
+
+	/* Use up what is left of the current block. A position at the
+	 * end of the block is the same as one at its start.
+	 */
+	if (buf->s_register_pos == blocksize)
+		buf->s_register_pos = 0;
+	if (buf->s_register_pos != 0 && len > 0) {
+		size = blocksize - buf->s_register_pos;
+		if (size > len) size = len;
+
+		memxor( plain, &buf->enc_s_register[buf->s_register_pos], size);
+		buf->s_register_pos += size;
+		if (buf->s_register_pos == blocksize)
+			buf->s_register_pos = 0;
+		plain += size;
+		len -= size;
+	}
+
+	/* Then the keystream computed ahead. A short request that finds
+	 * it empty refills all of it when prefetching is on, so that the
+	 * next ones are only an XOR.
+	 */
+	while (len > 0) {
+		if (buf->ks_pos == buf->ks_len) {
+			if (!buf->prefetch || len >= sizeof(buf->ks))
+				break;
+			nofb_refill( buf, sizeof(buf->ks), blocksize, akey, func);
+		}
+
+		size = buf->ks_len - buf->ks_pos;
+		if (size > len) size = len;
+
+		memxor( plain, &buf->ks[buf->ks_pos], size);
+		n = (size + blocksize - 1) / blocksize;
+		buf->ks_pos += n * blocksize;
+		/* the last block used is the register from now on */
+		memcpy( buf->enc_s_register, &buf->ks[buf->ks_pos - blocksize],
+			blocksize);
+		memcpy( buf->s_register, buf->enc_s_register, blocksize);
+		buf->s_register_pos = size % blocksize;
+		plain += size;
+		len -= size;
+	}
+
 	for (j = 0; j < len / blocksize; j++) {
 		xor_stuff( buf, akey, func, plain, blocksize, blocksize); 
 		
@@ -19,6 +19,7 @@
 
 #include <libdefs.h>
 #include <mcrypt_modules.h>
+#include "mode_buf.h"
 
 #define _init_mcrypt ofb_LTX__init_mcrypt
 #define _mcrypt_set_state ofb_LTX__mcrypt_set_state
@@ -32,43 +33,55 @@
 #define _mcrypt_get_modes_name ofb_LTX__mcrypt_get_modes_name
 #define _mcrypt_mode_get_size ofb_LTX__mcrypt_mode_get_size
 #define _mcrypt_mode_version ofb_LTX__mcrypt_mode_version
+#define _mcrypt_prefetch ofb_LTX__mcrypt_prefetch
 
 typedef struct ofb_buf {
-	byte* s_register;
-	byte* enc_s_register;
+	byte s_register[2 * MODE_MAX_BLOCK_SIZE];
+	byte enc_s_register[MODE_MAX_BLOCK_SIZE];
+	int s_register_pos;
 	int blocksize;
+	/* The next keystream bytes, computed ahead of time; the next one
+	 * at ks_pos.
+	 */
+	byte ks[MODE_KEYSTREAM_BYTES];
+	int ks_pos, ks_len;
+	int prefetch;		/* refill ks whenever it runs out */
 } OFB_BUFFER;
 
+/* The shift register is kept in a buffer of twice the block size,
+ * with every byte stored in both halves, and is the block starting at
+ * s_register_pos. Shifting a byte in is then two stores and a step of
+ * the position, and the register is always a contiguous block.
+ */
+#define SHIFT_IN(reg, pos, blocksize, c) \
+	reg[pos] = reg[pos + blocksize] = (c); \
+	if (++pos == blocksize) pos = 0
+
 
 /* OFB MODE */
 
 int _init_mcrypt( OFB_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
 {
 
-    buf->s_register = buf->enc_s_register = NULL;
+    if (size > MODE_MAX_BLOCK_SIZE)
+	return -1;
+
+    buf->s_register_pos = 0;
 
     buf->blocksize = size;
+    buf->ks_pos = buf->ks_len = 0;
+    buf->prefetch = 0;
     
     /* For ofb */
-	buf->s_register=malloc( size);
-    if (buf->s_register==NULL) goto freeall;
-
-	buf->enc_s_register=malloc( size);
-    if (buf->enc_s_register==NULL) goto freeall;
-
 	if (IV!=NULL) {
 		memcpy(buf->s_register, IV, size);
 	} else {
 		memset(buf->s_register, 0, size);
 	}
+	memcpy(&buf->s_register[size], buf->s_register, size);
 /* End ofb */
 
 	return 0;
-
-	freeall:
-		free(buf->s_register);
-		free(buf->enc_s_register);
-		return -1;
 }
 
 int _mcrypt_get_state( OFB_BUFFER* buf, byte *IV, int *size)
@@ -79,7 +92,7 @@ int _mcrypt_get_state( OFB_BUFFER* buf, byte *IV, int *size)
 	}
 	*size = buf->blocksize;
 
-	memcpy( IV, buf->s_register, buf->blocksize);
+	memcpy( IV, &buf->s_register[buf->s_register_pos], buf->blocksize);
 
 	return 0;
 }
@@ -88,70 +101,122 @@ int _mcrypt_set_state( OFB_BUFFER* buf, void *IV, int size)
 {
 	memcpy(buf->enc_s_register, IV, size);
 	memcpy(buf->s_register, IV, size);
+	memcpy(&buf->s_register[size], IV, size);
+	buf->s_register_pos = 0;
+	buf->ks_pos = buf->ks_len = 0;
 
 	return 0;
 }
 
 
 void _end_mcrypt( OFB_BUFFER* buf) {
-	free(buf->s_register);
-	free(buf->enc_s_register);
 }
 
 
+/* Makes sure at least want bytes (at most the size of the reservoir)
+ * of keystream are waiting in ks. The generation goes on from the
+ * register as it will be once the bytes already in ks have been
+ * shifted in.
+ */
+static void ofb_refill( OFB_BUFFER* buf, int want, int blocksize, void* akey, void (*func)(void*,void*))
+{
+	byte reg[2 * MODE_MAX_BLOCK_SIZE];
+	byte *enc = buf->enc_s_register;
+	int pos = 0, k, n;
+
+	if (want > sizeof(buf->ks))
+		want = sizeof(buf->ks);
+	if (buf->ks_len - buf->ks_pos >= want)
+		return;
+
+	memmove( buf->ks, &buf->ks[buf->ks_pos], buf->ks_len - buf->ks_pos);
+	buf->ks_len -= buf->ks_pos;
+	buf->ks_pos = 0;
+
+	n = buf->ks_len < blocksize ? buf->ks_len : blocksize;
+	memcpy( reg, &buf->s_register[buf->s_register_pos + n], blocksize - n);
+	memcpy( &reg[blocksize - n], &buf->ks[buf->ks_len - n], n);
+	memcpy( &reg[blocksize], reg, blocksize);
+
+	for (k = buf->ks_len; k < want; k++) {
+		memcpy(enc, &reg[pos], blocksize);
+		func(akey, enc);
+		SHIFT_IN(reg, pos, blocksize, enc[0]);
+		buf->ks[k] = enc[0];
+	}
+	buf->ks_len = want;
+}
+
+/* Computes at least len bytes of keystream ahead of time, and from then
+ * on refills the reservoir whenever a call finds it empty. A len of 0
+ * stops the refilling. Returns the number of bytes ready.
+ */
+int _mcrypt_prefetch( OFB_BUFFER* buf, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	if (len < 0)
+		return -1;
+
+	buf->prefetch = len > 0;
+	if (len > 0)
+		ofb_refill( buf, len, blocksize, akey, func);
+
+	return buf->ks_len - buf->ks_pos;
+}
+
 int _mcrypt( OFB_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*) )
 {				/* plaintext is 1 byte (8bit ofb) */
-	char *plain = plaintext;
-	int i, j;
+	byte *plain = plaintext;
+	byte *reg = buf->s_register, *enc = buf->enc_s_register;
+	int pos = buf->s_register_pos;
+	int j, size;
 	void (*_mcrypt_block_encrypt) (void *, void *);
 
 	_mcrypt_block_encrypt = func;
 
-	for (j = 0; j < len; j++) {
+	/* First the keystream computed ahead, whose bytes are shifted into
+	 * the register as they are used. A short request that finds it
+	 * empty refills all of it when prefetching is on.
+	 */
+	while (len > 0) {
+		if (buf->ks_pos == buf->ks_len) {
+			if (!buf->prefetch || len >= sizeof(buf->ks))
+				break;
+			ofb_refill( buf, sizeof(buf->ks), blocksize, akey, func);
+		}
+
+		size = buf->ks_len - buf->ks_pos;
+		if (size > len) size = len;
+
+		for (j = 0; j < size; j++) {
+			byte c = buf->ks[buf->ks_pos++];
+
+			SHIFT_IN(reg, pos, blocksize, c);
+			plain[j] ^= c;
+		}
+		buf->s_register_pos = pos;
+		plain += size;
+		len -= size;
+	}
 
-		memcpy(buf->enc_s_register, buf->s_register, blocksize);
+	for (j = 0; j < len; j++) {
 
-		_mcrypt_block_encrypt(akey, buf->enc_s_register);
+		memcpy(enc, &reg[pos], blocksize);
 
-		plain[j] ^= buf->enc_s_register[0];
+		_mcrypt_block_encrypt(akey, enc);
 
-/* Shift the register */
-		for (i = 0; i < (blocksize - 1); i++)
-			buf->s_register[i] = buf->s_register[i + 1];
+		SHIFT_IN(reg, pos, blocksize, enc[0]);
 
-		buf->s_register[blocksize - 1] = buf->enc_s_register[0];
+		plain[j] ^= enc[0];
 	}
+	buf->s_register_pos = pos;
 
 	return 0;
-
 }
 
 
 int _mdecrypt( OFB_BUFFER* buf, void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
 {				/* plaintext is 1 byte (8bit ofb) */
-	char *plain = plaintext;
-	int i, j;
-	void (*_mcrypt_block_encrypt) (void *, void *);
-
-	_mcrypt_block_encrypt = func;
-
-	for (j = 0; j < len; j++) {
-
-		memcpy(buf->enc_s_register, buf->s_register, blocksize);
-
-		_mcrypt_block_encrypt(akey, buf->enc_s_register);
-
-/* Shift the register */
-		for (i = 0; i < (blocksize - 1); i++)
-			buf->s_register[i] = buf->s_register[i + 1];
-
-		buf->s_register[blocksize - 1] = buf->enc_s_register[0];
-
-		plain[j] ^= buf->enc_s_register[0];
-
-	}
-
-	return 0;
+	return _mcrypt( buf, plaintext, len, blocksize, akey, func, func2);
 }
 
 int _is_block_mode() { return 0; }
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2002 Nikos Mavroyanopoulos
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Library General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <libdefs.h>
+#include <mcrypt_modules.h>
+#include "mode_buf.h"
+
+#define _init_mcrypt xts_LTX__init_mcrypt
+#define _mcrypt_set_state xts_LTX__mcrypt_set_state
+#define _mcrypt_get_state xts_LTX__mcrypt_get_state
+#define _end_mcrypt xts_LTX__end_mcrypt
+#define _mcrypt xts_LTX__mcrypt
+#define _mdecrypt xts_LTX__mdecrypt
+#define _has_iv xts_LTX__has_iv
+#define _is_block_mode xts_LTX__is_block_mode
+#define _is_block_algorithm_mode xts_LTX__is_block_algorithm_mode
+#define _mcrypt_get_modes_name xts_LTX__mcrypt_get_modes_name
+#define _mcrypt_mode_get_size xts_LTX__mcrypt_mode_get_size
+#define _mcrypt_mode_version xts_LTX__mcrypt_mode_version
+#define _mcrypt_set_blocks xts_LTX__mcrypt_set_blocks
+#define _mcrypt_set_tweak_key xts_LTX__mcrypt_set_tweak_key
+#define _mcrypt_sectors xts_LTX__mcrypt_sectors
+#define _mdecrypt_sectors xts_LTX__mdecrypt_sectors
+
+/* XTS (IEEE 1619, NIST SP 800-38E) for algorithms with 128 bit blocks.
+ *
+ * Every data unit (sector) is encrypted on its own. Block j of sector
+ * i is encrypted as E1(P xor T) xor T, where T = E2(i) * alpha^j in
+ * GF(2^128); E1 and E2 use the two halves of the key. A sector whose
+ * size is not a multiple of the block size ends with ciphertext
+ * stealing.
+ */
+
+#define XTS_BLOCK_SIZE 16
+
+/* Number of blocks whose tweaks are laid out at a time; together with
+ * the multi-block entry points this keeps several blocks, of one
+ * sector or of consecutive sectors, in flight at once.
+ */
+#define XTS_BULK_BLOCKS 64
+
+typedef struct xts_buf {
+	byte tweak[XTS_BLOCK_SIZE];	/* sector number, little endian */
+	void *tweak_key;
+	void (*blocks_encrypt)(void*,const void*,void*,int);
+	void (*blocks_decrypt)(void*,const void*,void*,int);
+} XTS_BUFFER;
+
+/* XTS MODE */
+
+/* x = x * alpha; the tweak is a little endian number */
+static void xts_mul_alpha( byte *x)
+{
+	int i, carry = x[15] >> 7;
+
+	for (i = 15; i > 0; i--)
+		x[i] = (x[i] << 1) | (x[i - 1] >> 7);
+	x[0] = (x[0] << 1) ^ (carry ? 0x87 : 0);
+}
+
+static void xts_xor( byte *out, const byte *ks, int len)
+{
+	unsigned long long a, b;
+
+	for (; len >= 8; len -= 8, out += 8, ks += 8) {
+		memcpy( &a, out, 8);
+		memcpy( &b, ks, 8);
+		a ^= b;
+		memcpy( out, &a, 8);
+	}
+	for (; len > 0; len--)
+		*out++ ^= *ks++;
+}
+
+/* size holds the size of the IV, the block size. The IV is the number
+ * of the first sector processed by _mcrypt() and _mdecrypt(), as a
+ * little endian number.
+ */
+int _init_mcrypt( XTS_BUFFER* buf, void *key, int lenofkey, void *IV, int size)
+{
+	if (size != XTS_BLOCK_SIZE)
+		return -1;
+
+	if (IV != NULL)
+		memcpy( buf->tweak, IV, size);
+	else
+		memset( buf->tweak, 0, size);
+
+	buf->tweak_key = NULL;
+	buf->blocks_encrypt = NULL;
+	buf->blocks_decrypt = NULL;
+
+	return 0;
+}
+
+int _mcrypt_set_state( XTS_BUFFER* buf, byte *IV, int size)
+{
+	if (size != XTS_BLOCK_SIZE)
+		return -1;
+	memcpy( buf->tweak, IV, size);
+
+	return 0;
+}
+
+int _mcrypt_get_state( XTS_BUFFER* buf, byte *IV, int *size)
+{
+	if (*size < XTS_BLOCK_SIZE) {
+		*size = XTS_BLOCK_SIZE;
+		return -1;
+	}
+	*size = XTS_BLOCK_SIZE;
+
+	memcpy( IV, buf->tweak, XTS_BLOCK_SIZE);
+
+	return 0;
+}
+
+/* Called after _init_mcrypt() with the algorithm's key expanded from
+ * the second half of the user key. It stays owned by the caller.
+ */
+int _mcrypt_set_tweak_key( XTS_BUFFER* buf, void *akey2)
+{
+	buf->tweak_key = akey2;
+	return 0;
+}
+
+/* Called after _init_mcrypt() when the algorithm also exports the
+ * optional multi-block entry points.
+ */
+int _mcrypt_set_blocks( XTS_BUFFER* buf, void (*func)(void*,const void*,void*,int), void (*func2)(void*,const void*,void*,int))
+{
+	buf->blocks_encrypt = func;
+	buf->blocks_decrypt = func2;
+	return 0;
+}
+
+void _end_mcrypt( XTS_BUFFER* buf) {
+}
+
+/* One block: b = F(b xor t) xor t */
+static void xts_block( byte *b, const byte *t, void* akey, void (*func)(void*,void*))
+{
+	xts_xor( b, t, XTS_BLOCK_SIZE);
+	func(akey, b);
+	xts_xor( b, t, XTS_BLOCK_SIZE);
+}
+
+/* Encrypts (decrypt == 0) or decrypts the nsectors sectors of
+ * sector_size bytes in data, the first of which has the (little
+ * endian) number in tweak.
+ */
+static int xts_crypt( XTS_BUFFER* buf, byte *data, int sector_size, int nsectors, const byte *tweak, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*), int decrypt)
+{
+	word32 tmp[XTS_BULK_BLOCKS * XTS_BLOCK_SIZE / sizeof(word32)];
+	byte *tw = (byte *) tmp;
+	byte sector[XTS_BLOCK_SIZE], t[XTS_BLOCK_SIZE], last[XTS_BLOCK_SIZE];
+	void (*block_func)(void*,void*) = decrypt ? func2 : func;
+	void (*blocks_func)(void*,const void*,void*,int) =
+		decrypt ? buf->blocks_decrypt : buf->blocks_encrypt;
+	int nblocks, rest, full, i, j, k, n;
+
+	if (blocksize != XTS_BLOCK_SIZE || buf->tweak_key == NULL ||
+	    sector_size < XTS_BLOCK_SIZE || nsectors < 0)
+		return -1;
+
+	nblocks = sector_size / XTS_BLOCK_SIZE;
+	rest = sector_size % XTS_BLOCK_SIZE;
+	/* with stealing the last whole block is done together with the
+	 * partial one */
+	full = rest ? nblocks - 1 : nblocks;
+
+	memcpy( sector, tweak, XTS_BLOCK_SIZE);
+
+	for (i = 0; i < nsectors; i++, data += sector_size) {
+		memcpy( t, sector, XTS_BLOCK_SIZE);
+		func(buf->tweak_key, t);
+
+		for (j = 0; j < full; j += n) {
+			n = full - j;
+			if (n > XTS_BULK_BLOCKS) n = XTS_BULK_BLOCKS;
+
+			for (k = 0; k < n; k++) {
+				memcpy( &tw[k * XTS_BLOCK_SIZE], t, XTS_BLOCK_SIZE);
+				xts_mul_alpha( t);
+			}
+
+			xts_xor( &data[j * XTS_BLOCK_SIZE], tw, n * XTS_BLOCK_SIZE);
+			if (blocks_func != NULL)
+				blocks_func(akey, &data[j * XTS_BLOCK_SIZE],
+					    &data[j * XTS_BLOCK_SIZE], n);
+			else for (k = 0; k < n; k++)
+				block_func(akey, &data[(j + k) * XTS_BLOCK_SIZE]);
+			xts_xor( &data[j * XTS_BLOCK_SIZE], tw, n * XTS_BLOCK_SIZE);
+		}
+
+		if (rest) {
+			byte *pm = &data[full * XTS_BLOCK_SIZE];
+			byte *pr = &pm[XTS_BLOCK_SIZE];
+
+			/* t is the tweak of block m-1; last that of block m */
+			memcpy( last, t, XTS_BLOCK_SIZE);
+			xts_mul_alpha( last);
+
+			/* Encryption: CC = E(P[m-1]) under t; the partial
+			 * output is the head of CC and block m-1 becomes the
+			 * encryption of P[m] || tail of CC under last.
+			 * Decryption does the same with the tweaks swapped.
+			 */
+			xts_block( pm, decrypt ? last : t, akey, block_func);
+			for (k = 0; k < rest; k++) {
+				byte c = pm[k];
+				pm[k] = pr[k];
+				pr[k] = c;
+			}
+			xts_block( pm, decrypt ? t : last, akey, block_func);
+		}
+
+		/* next sector number */
+		for (k = 0; k < XTS_BLOCK_SIZE && ++sector[k] == 0; k++);
+	}
+
+	memset( t, 0, sizeof(t));
+	memset( last, 0, sizeof(last));
+	return 0;
+}
+
+/* _mcrypt() and _mdecrypt() take one whole sector of len bytes (at
+ * least one block), and move on to the next sector number.
+ */
+int _mcrypt( XTS_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	int k, rc;
+
+	rc = xts_crypt( buf, plaintext, len, 1, buf->tweak, blocksize, akey, func, func2, 0);
+	if (rc == 0)
+		for (k = 0; k < XTS_BLOCK_SIZE && ++buf->tweak[k] == 0; k++);
+	return rc;
+}
+
+int _mdecrypt( XTS_BUFFER* buf,void *plaintext, int len, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	int k, rc;
+
+	rc = xts_crypt( buf, plaintext, len, 1, buf->tweak, blocksize, akey, func, func2, 1);
+	if (rc == 0)
+		for (k = 0; k < XTS_BLOCK_SIZE && ++buf->tweak[k] == 0; k++);
+	return rc;
+}
+
+static void xts_sector_tweak( byte *tweak, unsigned long long sector)
+{
+	int k;
+
+	for (k = 0; k < XTS_BLOCK_SIZE; k++) {
+		tweak[k] = (byte) sector;
+		sector = k < 7 ? sector >> 8 : 0;
+	}
+}
+
+/* nsectors consecutive sectors of sector_size bytes, starting with
+ * sector number sector. The sector number kept in the state is not
+ * used or changed.
+ */
+int _mcrypt_sectors( XTS_BUFFER* buf, void *data, int sector_size, int nsectors, unsigned long long sector, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	byte tweak[XTS_BLOCK_SIZE];
+
+	xts_sector_tweak( tweak, sector);
+	return xts_crypt( buf, data, sector_size, nsectors, tweak, blocksize, akey, func, func2, 0);
+}
+
+int _mdecrypt_sectors( XTS_BUFFER* buf, void *data, int sector_size, int nsectors, unsigned long long sector, int blocksize, void* akey, void (*func)(void*,void*), void (*func2)(void*,void*))
+{
+	byte tweak[XTS_BLOCK_SIZE];
+
+	xts_sector_tweak( tweak, sector);
+	return xts_crypt( buf, data, sector_size, nsectors, tweak, blocksize, akey, func, func2, 1);
+}
+
+int _has_iv() { return 1; }
+int _is_block_mode() { return 0; }
+int _is_block_algorithm_mode() { return 1; }
+const char *_mcrypt_get_modes_name() { return "XTS";}
+int _mcrypt_mode_get_size () {return sizeof(XTS_BUFFER);}
+
+
+word32 _mcrypt_mode_version() {
+	return 20261018;
+}
+
+#ifdef WIN32
+# ifdef USE_LTDL
+WIN32DLL_DEFINE int main (void)
+{
+       /* empty main function to avoid linker error (see cygwin FAQ) */
+}
+# endif
+#endif
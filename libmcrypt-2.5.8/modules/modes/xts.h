@@ -0,0 +1,12 @@
+#ifndef USE_MODULES
+int _xts_init_mcrypt( int td, void* buf, void *key, int lenofkey, void *IV);
+int _mcrypt_xts(int td, void* buf,void *plaintext, int len);
+int _mdecrypt_xts(int td, void* buf, void *plaintext, int len);
+int _xts_is_block_mode();
+int _xts_has_iv();
+int _xts_is_block_algorithm_mode();
+char *_mcrypt_xts_get_modes_name();
+int _mcrypt_xts_mode_get_size ();
+int _mcrypt_xts_get_iv_size(int td);
+word32 _mcrypt_xts_mode_version();
+#endif
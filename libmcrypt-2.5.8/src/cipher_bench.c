@@ -0,0 +1,367 @@
+/*
+ *    Copyright (C) 1998,1999,2000,2002 Nikos Mavroyanopoulos
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "../include/mutils/mcrypt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Measures, for all the algorithms and modes, the time to open a
+ * module and to set up a key, and the throughput of mcrypt_generic()
+ * (or, with -d, mdecrypt_generic()) over buffers of 16 bytes up to
+ * 64 MB. The results are printed as JSON, one object per measurement,
+ * so that runs before and after a change can be compared.
+ *
+ * usage: cipherbench [-d] [-a algorithm] [-m mode] [-s max_bytes]
+ *                    [-t min_seconds]
+ */
+
+#define ALGORITHMS_DIR "../modules/algorithms/.libs"
+#define MODES_DIR "../modules/modes/.libs"
+/* #define ALGORITHMS_DIR NULL
+ * #define MODES_DIR NULL
+ */
+
+#define MIN_SIZE 16
+#define MAX_SIZE (64 * 1024 * 1024)
+
+/* Every measurement is repeated until it has taken this long. The
+ * calls are timed in batches, which grow until a batch takes at least
+ * 1/BATCH_FRACTION of that, so that reading the clock costs next to
+ * nothing even for the smallest buffers.
+ */
+#define MIN_TIME 0.1
+#define BATCH_FRACTION 64
+
+#if defined(__i386__) || defined(__x86_64__)
+# define HAVE_RDTSC 1
+static unsigned long long rdtsc(void)
+{
+	unsigned int lo, hi;
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return ((unsigned long long) hi << 32) | lo;
+}
+#else
+static unsigned long long rdtsc(void)
+{
+	return 0;
+}
+#endif
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* The same kind of key and IV as in cipher_test.c */
+static unsigned char *make_key(int size)
+{
+	unsigned char *key;
+	int t;
+
+	key = calloc(1, size);
+	if (key == NULL)
+		exit(1);
+	for (t=0;t<size;t++)
+		key[t] = (t % 255) + 13;
+	return key;
+}
+
+struct sample {
+	long iterations;
+	double seconds;
+	unsigned long long cycles;
+	long batch;
+};
+
+static void sample_start(struct sample *s)
+{
+	memset(s, 0, sizeof(*s));
+	s->batch = 1;
+}
+
+/* Adds a batch that took seconds and cycles; returns 1 while more are
+ * needed */
+static int sample_add(struct sample *s, double seconds,
+		      unsigned long long cycles, double min_time)
+{
+	s->iterations += s->batch;
+	s->seconds += seconds;
+	s->cycles += cycles;
+	if (seconds * BATCH_FRACTION < min_time)
+		s->batch *= 2;
+	return s->seconds < min_time;
+}
+
+static int first = 1;
+
+static void print_sample(const char *what, const char *algorithm,
+			 const char *mode, long bytes, struct sample *s)
+{
+	double per_op = s->seconds / s->iterations;
+
+	printf("%s\n  {\"test\": \"%s\", \"algorithm\": \"%s\", "
+	       "\"mode\": \"%s\", ", first ? "" : ",", what, algorithm,
+	       mode);
+	first = 0;
+	if (bytes > 0)
+		printf("\"bytes\": %ld, ", bytes);
+	printf("\"iterations\": %ld, \"ns\": %.1f", s->iterations,
+	       per_op * 1e9);
+	if (bytes > 0)
+		printf(", \"mb_per_s\": %.2f",
+		       bytes / per_op / (1024.0 * 1024.0));
+#ifdef HAVE_RDTSC
+	if (bytes > 0)
+		printf(", \"cycles_per_byte\": %.2f",
+		       (double) s->cycles / s->iterations / bytes);
+	else
+		printf(", \"cycles\": %.0f",
+		       (double) s->cycles / s->iterations);
+#endif
+	printf("}");
+	fflush(stdout);
+}
+
+/* The time to open and close the module, and to set up a key with
+ * mcrypt_generic_init() */
+static int bench_setup(char *algorithm, char *mode, double min_time)
+{
+	struct sample open_s, init_s;
+	unsigned char *key, *IV = NULL;
+	int keysize, ivsize;
+	long k;
+	double start;
+	unsigned long long c;
+	MCRYPT td;
+
+	td = mcrypt_module_open(algorithm, ALGORITHMS_DIR, mode, MODES_DIR);
+	if (td == MCRYPT_FAILED)
+		return -1;
+
+	sample_start(&open_s);
+	do {
+		MCRYPT td2;
+
+		start = now();
+		c = rdtsc();
+		for (k = 0; k < open_s.batch; k++) {
+			td2 = mcrypt_module_open(algorithm, ALGORITHMS_DIR,
+						 mode, MODES_DIR);
+			if (td2 == MCRYPT_FAILED)
+				break;
+			mcrypt_module_close(td2);
+		}
+		if (k < open_s.batch)
+			break;
+	} while (sample_add(&open_s, now() - start, rdtsc() - c,
+			    min_time));
+
+	keysize = mcrypt_enc_get_key_size(td);
+	ivsize = mcrypt_enc_get_iv_size(td);
+	key = make_key(keysize);
+	if (ivsize > 0)
+		IV = make_key(ivsize);
+
+	sample_start(&init_s);
+	do {
+		start = now();
+		c = rdtsc();
+		for (k = 0; k < init_s.batch; k++) {
+			if (mcrypt_generic_init(td, key, keysize, IV) < 0)
+				break;
+			mcrypt_generic_deinit(td);
+		}
+		if (k < init_s.batch)
+			break;
+	} while (sample_add(&init_s, now() - start, rdtsc() - c,
+			    min_time));
+
+	if (open_s.iterations > 0)
+		print_sample("module_open", algorithm, mode, 0, &open_s);
+	if (init_s.iterations > 0)
+		print_sample("key_setup", algorithm, mode, 0, &init_s);
+
+	mcrypt_module_close(td);
+	free(key);
+	free(IV);
+	return 0;
+}
+
+/* The throughput over buffers of each size, in one call per buffer */
+static void bench_mode(char *algorithm, char *mode, unsigned char *buf,
+		       long max_size, double min_time, int decrypt)
+{
+	struct sample s;
+	unsigned char *key, *IV = NULL;
+	int keysize, ivsize, blocksize;
+	long size, len, k;
+	double start;
+	unsigned long long c;
+	MCRYPT td;
+
+	td = mcrypt_module_open(algorithm, ALGORITHMS_DIR, mode, MODES_DIR);
+	if (td == MCRYPT_FAILED)
+		return;
+
+	keysize = mcrypt_enc_get_key_size(td);
+	ivsize = mcrypt_enc_get_iv_size(td);
+	blocksize = mcrypt_enc_get_block_size(td);
+	key = make_key(keysize);
+	if (ivsize > 0)
+		IV = make_key(ivsize);
+
+	if (mcrypt_generic_init(td, key, keysize, IV) < 0) {
+		fprintf(stderr, "Failed to Initialize %s in %s mode\n",
+			algorithm, mode);
+		goto close;
+	}
+
+	for (size = MIN_SIZE; size <= max_size; size *= 4) {
+		len = size;
+		/* the block modes take whole blocks */
+		if (mcrypt_enc_is_block_mode(td) != 0 && blocksize > 0)
+			len = (size + blocksize - 1) / blocksize * blocksize;
+		if (len > max_size)
+			break;
+
+		sample_start(&s);
+		do {
+			int rc = 0;
+
+			start = now();
+			c = rdtsc();
+			for (k = 0; k < s.batch && rc == 0; k++) {
+				if (decrypt)
+					rc = mdecrypt_generic(td, buf, len);
+				else
+					rc = mcrypt_generic(td, buf, len);
+			}
+			if (rc != 0)
+				goto out;
+		} while (sample_add(&s, now() - start, rdtsc() - c,
+				    min_time));
+
+		print_sample(decrypt ? "decrypt" : "encrypt", algorithm,
+			     mode, len, &s);
+	}
+
+      out:
+	mcrypt_generic_deinit(td);
+      close:
+	mcrypt_module_close(td);
+	free(key);
+	free(IV);
+}
+
+int main(int argc, char **argv)
+{
+	int i, imax;
+	int j, jmax;
+	int c, decrypt = 0;
+	char **names;
+	char **modes;
+	char *only_algorithm = NULL, *only_mode = NULL;
+	long max_size = MAX_SIZE;
+	double min_time = MIN_TIME;
+	unsigned char *buf;
+
+	while ((c = getopt(argc, argv, "da:m:s:t:")) != -1) {
+		switch (c) {
+		case 'd':
+			decrypt = 1;
+			break;
+		case 'a':
+			only_algorithm = optarg;
+			break;
+		case 'm':
+			only_mode = optarg;
+			break;
+		case 's':
+			max_size = atol(optarg);
+			break;
+		case 't':
+			min_time = atof(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d] [-a algorithm] "
+				"[-m mode] [-s max_bytes] [-t min_seconds]\n",
+				argv[0]);
+			exit(1);
+		}
+	}
+	if (max_size < MIN_SIZE)
+		max_size = MIN_SIZE;
+
+	names = mcrypt_list_algorithms (ALGORITHMS_DIR, &jmax);
+	modes = mcrypt_list_modes (MODES_DIR, &imax);
+
+	if (names==NULL || modes==NULL) {
+		fprintf(stderr, "Error getting algorithms/modes\n");
+		exit(1);
+	}
+
+	/* the largest block size is added so that the block modes can
+	 * round up the largest buffer */
+	buf = calloc(1, max_size + 32);
+	if (buf == NULL) {
+		fprintf(stderr, "Cannot allocate %ld bytes\n", max_size);
+		exit(1);
+	}
+
+	printf("{\"timer\": \"clock_gettime\", \"cycles\": %s, "
+	       "\"min_seconds\": %g, \"results\": [",
+#ifdef HAVE_RDTSC
+	       "\"rdtsc\"",
+#else
+	       "null",
+#endif
+	       min_time);
+
+	for (j=0;j<jmax;j++) {
+		if (only_algorithm != NULL &&
+		    strcmp(only_algorithm, names[j]) != 0)
+			continue;
+
+		/* module open and key setup, in the first mode that
+		 * the algorithm works with */
+		for (i=0;i<imax;i++)
+			if (bench_setup(names[j], modes[i], min_time) == 0)
+				break;
+
+		for (i=0;i<imax;i++) {
+			if (only_mode != NULL &&
+			    strcmp(only_mode, modes[i]) != 0)
+				continue;
+			bench_mode(names[j], modes[i], buf, max_size,
+				   min_time, decrypt);
+		}
+	}
+	printf("\n]}\n");
+
+	free(buf);
+	mcrypt_free_p(names, jmax);
+	mcrypt_free_p(modes, imax);
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ *    Copyright (C) 2002 Nikos Mavroyanopoulos
+ *
+ *    This program is free software; you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation; either version 2 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "../include/mutils/mcrypt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Checks that a descriptor initialized from a saved key schedule
+ * encrypts like one initialized from the key.
+ */
+
+#define ALGORITHMS_DIR "../modules/algorithms/.libs"
+#define MODES_DIR "../modules/modes/.libs"
+/* #define ALGORITHMS_DIR NULL
+ * #define MODES_DIR NULL
+ */
+#define TEXT "a small text, just to test the saved key schedules"
+
+static int test_schedule(char *algorithm)
+{
+	MCRYPT td, td2;
+	unsigned char key[56], IV[8], text[48], text2[48];
+	unsigned char *schedule;
+	int t, size, x = 0;
+
+	td = mcrypt_module_open(algorithm, ALGORITHMS_DIR, "cbc", MODES_DIR);
+	td2 = mcrypt_module_open(algorithm, ALGORITHMS_DIR, "cbc", MODES_DIR);
+	if (td == MCRYPT_FAILED || td2 == MCRYPT_FAILED) {
+		fprintf(stderr, "Failed to open %s.\n", algorithm);
+		return 1;
+	}
+
+	for (t = 0; t < sizeof(key); t++)
+		key[t] = (t % 255) + 13;
+	for (t = 0; t < sizeof(IV); t++)
+		IV[t] = (t * 2 % 255) + 15;
+
+	size = mcrypt_enc_get_schedule_size(td);
+	if (size <= 0) {
+		fprintf(stderr, "%s: no schedule size.\n", algorithm);
+		return 1;
+	}
+	schedule = calloc(1, size);
+	if (schedule == NULL)
+		exit(1);
+
+	if (mcrypt_generic_init(td, key, sizeof(key), IV) < 0
+	    || mcrypt_generic_save_schedule(td, schedule) != 0
+	    || mcrypt_generic_init_schedule(td2, schedule, IV) != 0) {
+		fprintf(stderr, "%s: failed to initialize.\n", algorithm);
+		return 1;
+	}
+
+	memcpy(text, TEXT, sizeof(text));
+	memcpy(text2, TEXT, sizeof(text2));
+	mcrypt_generic(td, text, sizeof(text));
+	mcrypt_generic(td2, text2, sizeof(text2));
+	if (memcmp(text, text2, sizeof(text)) == 0 &&
+	    memcmp(text, TEXT, sizeof(text)) != 0) {
+		printf("   %s: ok\n", algorithm);
+	} else {
+		printf("   %s: failed\n", algorithm);
+		x = 1;
+	}
+
+	mcrypt_generic_deinit(td);
+	mcrypt_generic_deinit(td2);
+	mcrypt_module_close(td);
+	mcrypt_module_close(td2);
+	free(schedule);
+	return x;
+}
+
+int main()
+{
+	MCRYPT td;
+	unsigned char schedule[16], key[16];
+	int x = 0;
+
+	x |= test_schedule("blowfish");
+	x |= test_schedule("blowfish-compat");
+
+	/* the algorithms without saved schedules refuse them */
+	td = mcrypt_module_open("rijndael-128", ALGORITHMS_DIR, "ecb",
+				MODES_DIR);
+	if (td != MCRYPT_FAILED) {
+		memset(key, 0, sizeof(key));
+		if (mcrypt_enc_get_schedule_size(td) >= 0
+		    || mcrypt_generic_init_schedule(td, schedule, NULL) >= 0) {
+			printf("   %s: failed\n", "rijndael-128");
+			x = 1;
+		} else if (mcrypt_generic_init(td, key, sizeof(key), NULL) < 0
+			   || mcrypt_generic_save_schedule(td, schedule) >= 0) {
+			printf("   %s: failed\n", "rijndael-128");
+			x = 1;
+		} else
+			printf("   %s: ok\n", "rijndael-128");
+		mcrypt_generic_deinit(td);
+		mcrypt_module_close(td);
+	}
+
+	return x;
+}
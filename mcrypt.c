@@ -23,6 +23,47 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <mcrypt.h>
 #include "Python.h"
 #include "structmember.h"
+#include <sys/uio.h>
+
+/* Static tracepoints of the python_mcrypt provider, for bpftrace, perf
+ * or SystemTap. With <sys/sdt.h> (setup.py defines HAVE_SYS_SDT_H when
+ * it is installed) each probe is a nop and an ELF note until a tracer
+ * attaches to it; without it they compile to nothing. The algorithm
+ * and mode are the names given to MCRYPT(), lengths are in bytes, and
+ * rc is 0 on success:
+ *
+ *   module__open__start(algorithm, mode)
+ *   module__open__done(algorithm, mode, ok)
+ *   init__start(algorithm, mode, type)
+ *   init__done(algorithm, mode, type, ok)
+ *   key__setup__start(algorithm, mode, key_size)
+ *   key__setup__done(algorithm, mode, rc)
+ *   encrypt__start(algorithm, mode, length)
+ *   encrypt__done(algorithm, mode, length, rc)
+ *   decrypt__start(algorithm, mode, length)
+ *   decrypt__done(algorithm, mode, length, rc)
+ *   encrypt__file__start(algorithm, mode, buffer_size)
+ *   encrypt__file__done(algorithm, mode, length, error)
+ *   decrypt__file__start(algorithm, mode, buffer_size)
+ *   decrypt__file__done(algorithm, mode, length, error)
+ *
+ * init fires on every call that goes through _init_mcrypt(), type
+ * being one of the INIT_* values below; key__setup only when that
+ * actually runs mcrypt_generic_init(). encrypt and decrypt surround
+ * each call into libmcrypt that does the bulk of the work, including
+ * the ones for every buffer of the file functions.
+ */
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define PROBE2(name, a, b) DTRACE_PROBE2(python_mcrypt, name, a, b)
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(python_mcrypt, name, a, b, c)
+#define PROBE4(name, a, b, c, d) \
+	DTRACE_PROBE4(python_mcrypt, name, a, b, c, d)
+#else
+#define PROBE2(name, a, b)
+#define PROBE3(name, a, b, c)
+#define PROBE4(name, a, b, c, d)
+#endif
 
 /* Thread support doesn't seem to be working in mcrypt */
 #undef WITH_THREAD
@@ -60,6 +101,7 @@ typedef struct {
 	void *init_key;
 	int init_key_size;
 	int block_mode;
+	int sector_mode;
 	int block_size;
 	int iv_size;
 } MCRYPTObject;
@@ -155,6 +197,21 @@ check_mode(char *name, char *dir)
 	return 0;
 }
 
+/* The sector modes (xts) take each call as a whole sector, so they
+ * can't be given data in pieces. */
+static int
+check_not_sector_mode(MCRYPTObject *self, const char *method)
+{
+	if (self->sector_mode) {
+		PyErr_Format(MCRYPTError,
+			     "%s can't be used with a sector mode; use "
+			     "encrypt_sectors() and decrypt_sectors()",
+			     method);
+		return 0;
+	}
+	return 1;
+}
+
 static int
 check_key(MCRYPTObject *self, char *key, int key_size)
 {
@@ -195,14 +252,26 @@ check_key(MCRYPTObject *self, char *key, int key_size)
 	return 1;
 }
 
+/* Runs mcrypt_generic_init() between the key__setup probes. */
+static int
+_key_setup(MCRYPTObject *self, void *key, int key_size, void *iv)
+{
+	int rc;
+
+	PROBE3(key__setup__start, self->algorithm, self->mode, key_size);
+	rc = mcrypt_generic_init(self->thread, key, key_size, iv);
+	PROBE3(key__setup__done, self->algorithm, self->mode, rc);
+	return rc;
+}
+
 /* This is where the init magic takes place. It will do its best to
  * be as fast as possible, and try hard to avoid asking the user for
  * another hard init. Note that iv must have the size expected by the
  * algorithm. */
 static int
-_init_mcrypt(MCRYPTObject *self, int type,
-	    void *key, int key_size,
-            void *iv)
+_do_init_mcrypt(MCRYPTObject *self, int type,
+		void *key, int key_size,
+		void *iv)
 {
 	register int action = INIT_NONE;
 	register int curtype = self->init;
@@ -244,6 +313,15 @@ _init_mcrypt(MCRYPTObject *self, int type,
 						"previous init");
 				return 0;
 			}
+			/* An authenticated mode must never encrypt two
+			 * messages with the same iv. */
+			if (strcmp("gcm", self->mode) == 0) {
+				PyErr_SetString(MCRYPTError,
+						"reinit can't be used with "
+						"an authenticated mode; run "
+						"init() with a new iv");
+				return 0;
+			}
 			action = INIT_REINIT;
 			break;
 
@@ -263,10 +341,9 @@ _init_mcrypt(MCRYPTObject *self, int type,
 			int rc = mcrypt_generic_deinit(self->thread);
 			if (catch_mcrypt_error(rc))
 				return 0;
-			rc = mcrypt_generic_init(self->thread,
-						 self->init_key,
-						 self->init_key_size,
-						 self->init_iv);	
+			rc = _key_setup(self, self->init_key,
+					self->init_key_size,
+					self->init_iv);
 			if (catch_mcrypt_error(rc)) {
 				self->init = INIT_NONE;
 				PyMem_Free(self->init_iv);
@@ -310,8 +387,7 @@ _init_mcrypt(MCRYPTObject *self, int type,
 			} else {
 				memset(self->init_iv, 0, self->iv_size);
 			}
-			rc = mcrypt_generic_init(self->thread, key, key_size,
-						 iv);	
+			rc = _key_setup(self, key, key_size, iv);
 			if (catch_mcrypt_error(rc)) {
 				PyMem_Free(self->init_iv);
 				PyMem_Free(self->init_key);
@@ -326,6 +402,19 @@ _init_mcrypt(MCRYPTObject *self, int type,
 	return 1;
 }
 
+static int
+_init_mcrypt(MCRYPTObject *self, int type,
+	    void *key, int key_size,
+            void *iv)
+{
+	int ok;
+
+	PROBE3(init__start, self->algorithm, self->mode, type);
+	ok = _do_init_mcrypt(self, type, key, key_size, iv);
+	PROBE4(init__done, self->algorithm, self->mode, type, ok);
+	return ok;
+}
+
 static void
 MCRYPT_dealloc(MCRYPTObject *self)
 {
@@ -408,7 +497,10 @@ MCRYPT__init__(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		return -1;
 	}
 
+	PROBE2(module__open__start, algorithm, mode);
 	self->thread = mcrypt_module_open(algorithm, adir, mode, mdir);
+	PROBE3(module__open__done, algorithm, mode,
+	       self->thread != MCRYPT_FAILED);
 
 	if (self->thread == MCRYPT_FAILED) {
 		PyErr_SetString(MCRYPTError, "unknown mcrypt error");
@@ -420,6 +512,7 @@ MCRYPT__init__(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		mcrypt_module_close(self->thread);
 		return -1;
 	}
+	self->sector_mode = mcrypt_enc_is_sector_mode(self->thread);
 	self->block_size = mcrypt_enc_get_block_size(self->thread);
 	if (catch_mcrypt_error(self->block_size)) {
 		mcrypt_module_close(self->thread);
@@ -485,7 +578,8 @@ If you have encrypted or decrypted something and want to encrypt\n\
 or decrypt something else with the same key and iv, you may use\n\
 this method as a faster alternative to using init() with the same\n\
 parameters as before. Note that you can't call this method in an\n\
-uninitialized instance.\n\
+uninitialized instance, nor with an authenticated mode (eg. gcm),\n\
+which must get a new iv from init() for every message.\n\
 ";
 
 static PyObject *
@@ -535,11 +629,11 @@ to enable it for encrypt, and not for decrypt).\n\
 static PyObject *
 MCRYPT_encrypt(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 {
-	void *blockbuffer, *data;
-	int blockbuffer_size, data_size;
+	char *blockbuffer, *data;
+	int blockbuffer_size, data_size, full_size;
 	int numblocks, left_size, block_size;
 	int fixlength = 0;
-	int rc;
+	int rc = 0;
 	PyObject *ret;
 
 	static char *kwlist[] = {"data", "fixlength", 0};
@@ -568,11 +662,22 @@ MCRYPT_encrypt(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		PyErr_NoMemory();
 		return NULL;
 	}
-	memset(blockbuffer, 0, blockbuffer_size);
+	/* The whole blocks are encrypted straight out of data, and only
+	 * the padded last block is put together in place. */
+	full_size = data_size-left_size;
+	memset(blockbuffer+full_size, 0, blockbuffer_size-full_size);
 	if (fixlength)
-		((char *)blockbuffer)[blockbuffer_size-1] = left_size;
-	memcpy(blockbuffer, data, data_size);
-	rc = mcrypt_generic(self->thread, blockbuffer, blockbuffer_size);
+		blockbuffer[blockbuffer_size-1] = left_size;
+	memcpy(blockbuffer+full_size, data+full_size, left_size);
+	PROBE3(encrypt__start, self->algorithm, self->mode, blockbuffer_size);
+	if (full_size > 0)
+		rc = mcrypt_generic_out(self->thread, data, blockbuffer,
+					full_size);
+	if (rc == 0 && blockbuffer_size > full_size)
+		rc = mcrypt_generic(self->thread, blockbuffer+full_size,
+				    blockbuffer_size-full_size);
+	PROBE4(encrypt__done, self->algorithm, self->mode, blockbuffer_size,
+	       rc);
 	if (catch_mcrypt_error(rc))
 		ret = NULL;
 	else
@@ -601,7 +706,7 @@ MCRYPT_decrypt(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 	int blockbuffer_size, data_size;
 	int numblocks, left_size, block_size;
 	int fixlength = 0;
-	int rc;
+	int rc = 0;
 	PyObject *ret;
 	
 	static char *kwlist[] = {"data", "fixlength", 0};
@@ -628,9 +733,12 @@ MCRYPT_decrypt(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		PyErr_NoMemory();
 		return NULL;
 	}
-	memcpy(blockbuffer, data, data_size);
-	rc = mdecrypt_generic(self->thread, blockbuffer,
-			      blockbuffer_size);
+	PROBE3(decrypt__start, self->algorithm, self->mode, blockbuffer_size);
+	if (blockbuffer_size > 0)
+		rc = mdecrypt_generic_out(self->thread, data, blockbuffer,
+					  blockbuffer_size);
+	PROBE4(decrypt__done, self->algorithm, self->mode, blockbuffer_size,
+	       rc);
 	if (fixlength) {
 		left_size = ((char *)blockbuffer)[blockbuffer_size-1];
 		if (left_size > block_size)
@@ -648,6 +756,386 @@ MCRYPT_decrypt(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 	return ret;
 }
 
+/* Run mcrypt_generic_iov() or mdecrypt_generic_iov() over the writable
+ * buffers in a sequence, without joining them. */
+static PyObject *
+_iov_mcrypt(MCRYPTObject *self, PyObject *buffers, int type)
+{
+	PyObject *seq, *item;
+	struct iovec *iov;
+	void *base;
+	Py_ssize_t len, total = 0;
+	int iovcnt, i;
+	int rc;
+
+	if (!check_not_sector_mode(self, type == INIT_ENCRYPT ?
+				   "encrypt_iov" : "decrypt_iov"))
+		return NULL;
+	if (!_init_mcrypt(self, type, NULL, 0, NULL))
+		return NULL;
+
+	seq = PySequence_Fast(buffers, "buffers must be a sequence");
+	if (seq == NULL)
+		return NULL;
+	iovcnt = PySequence_Fast_GET_SIZE(seq);
+	iov = PyMem_Malloc((iovcnt > 0 ? iovcnt : 1) * sizeof(struct iovec));
+	if (iov == NULL) {
+		Py_DECREF(seq);
+		PyErr_NoMemory();
+		return NULL;
+	}
+	for (i = 0; i != iovcnt; i++) {
+		item = PySequence_Fast_GET_ITEM(seq, i);
+		if (PyObject_AsWriteBuffer(item, &base, &len) == -1) {
+			PyErr_SetString(PyExc_TypeError,
+					"buffers must be writable "
+					"(eg. bytearray)");
+			goto error;
+		}
+		iov[i].iov_base = base;
+		iov[i].iov_len = len;
+		total += len;
+	}
+	if (self->block_mode && total%self->block_size != 0) {
+		PyErr_Format(PyExc_ValueError,
+			     "data size must be a multiple of %d",
+			     self->block_size);
+		goto error;
+	}
+
+	if (type == INIT_ENCRYPT) {
+		PROBE3(encrypt__start, self->algorithm, self->mode, total);
+		rc = mcrypt_generic_iov(self->thread, iov, iovcnt);
+		PROBE4(encrypt__done, self->algorithm, self->mode, total, rc);
+	} else {
+		PROBE3(decrypt__start, self->algorithm, self->mode, total);
+		rc = mdecrypt_generic_iov(self->thread, iov, iovcnt);
+		PROBE4(decrypt__done, self->algorithm, self->mode, total, rc);
+	}
+	if (catch_mcrypt_error(rc))
+		goto error;
+
+	PyMem_Free(iov);
+	Py_DECREF(seq);
+	Py_INCREF(Py_None);
+	return Py_None;
+
+error:
+	PyMem_Free(iov);
+	Py_DECREF(seq);
+	return NULL;
+}
+
+static char MCRYPT_encrypt_iov__doc__[] =
+"encrypt_iov(buffers) -> None\n\
+\n\
+Encrypts, in place, a sequence of writable buffers (eg. bytearray\n\
+objects) as if they were one contiguous string, so that fragmented\n\
+data doesn't have to be joined first. No padding is done; when using\n\
+a block mode the total size must be a multiple of the block size,\n\
+but a block may be split between buffers. As with encrypt(), the\n\
+next call will continue where this one stopped. Sector modes (eg. xts)\n\
+are refused; use encrypt_sectors() with them.\n\
+";
+
+static PyObject *
+MCRYPT_encrypt_iov(MCRYPTObject *self, PyObject *args)
+{
+	PyObject *buffers;
+	if (!PyArg_ParseTuple(args, "O:encrypt_iov", &buffers))
+		return NULL;
+	return _iov_mcrypt(self, buffers, INIT_ENCRYPT);
+}
+
+static char MCRYPT_decrypt_iov__doc__[] =
+"decrypt_iov(buffers) -> None\n\
+\n\
+Decrypts, in place, a sequence of writable buffers. This is the\n\
+counterpart of encrypt_iov().\n\
+";
+
+static PyObject *
+MCRYPT_decrypt_iov(MCRYPTObject *self, PyObject *args)
+{
+	PyObject *buffers;
+	if (!PyArg_ParseTuple(args, "O:decrypt_iov", &buffers))
+		return NULL;
+	return _iov_mcrypt(self, buffers, INIT_DECRYPT);
+}
+
+static char MCRYPT_add_aad__doc__[] =
+"add_aad(data) -> None\n\
+\n\
+Adds data that must be authenticated but not encrypted (eg. a packet\n\
+header) to the current message of an authenticated mode (eg. gcm).\n\
+It may be called several times, but only before the first encrypt()\n\
+or decrypt() of the message.\n\
+";
+
+static PyObject *
+MCRYPT_add_aad(MCRYPTObject *self, PyObject *args)
+{
+	char *data;
+	int data_size;
+	int rc;
+	if (!PyArg_ParseTuple(args, "s#:add_aad", &data, &data_size))
+		return NULL;
+	if (self->init == INIT_NONE) {
+		PyErr_SetString(MCRYPTError, "init method not run");
+		return NULL;
+	}
+	rc = mcrypt_generic_aad(self->thread, data, data_size);
+	if (catch_mcrypt_error(rc))
+		return NULL;
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+static char MCRYPT_get_tag__doc__[] =
+"get_tag([size=16]) -> tag\n\
+\n\
+Ends the message encrypted with an authenticated mode (eg. gcm) and\n\
+returns its tag, which is to be sent along with the ciphertext. size\n\
+may be between 4 and 16. Run init() with a new iv before encrypting\n\
+the next message; reinit() is refused, as it would use the same iv\n\
+again.\n\
+";
+
+static PyObject *
+MCRYPT_get_tag(MCRYPTObject *self, PyObject *args)
+{
+	char tag[16];
+	int size = 16;
+	int rc;
+	if (!PyArg_ParseTuple(args, "|i:get_tag", &size))
+		return NULL;
+	if (size < 4 || size > 16) {
+		PyErr_SetString(PyExc_ValueError,
+				"tag size must be between 4 and 16");
+		return NULL;
+	}
+	if (!_init_mcrypt(self, INIT_ENCRYPT, NULL, 0, NULL))
+		return NULL;
+	rc = mcrypt_generic_get_tag(self->thread, tag, size);
+	if (catch_mcrypt_error(rc))
+		return NULL;
+	return PyString_FromStringAndSize(tag, size);
+}
+
+static char MCRYPT_verify_tag__doc__[] =
+"verify_tag(tag) -> None\n\
+\n\
+Ends the message decrypted with an authenticated mode (eg. gcm), or\n\
+authenticated with a MAC mode (eg. cmac), and checks it against the\n\
+tag received with it. MCRYPTError is raised if they don't match, in\n\
+which case the data must be thrown away.\n\
+";
+
+static PyObject *
+MCRYPT_verify_tag(MCRYPTObject *self, PyObject *args)
+{
+	char *tag;
+	int tag_size;
+	int rc;
+	if (!PyArg_ParseTuple(args, "s#:verify_tag", &tag, &tag_size))
+		return NULL;
+	if (tag_size < 4 || tag_size > self->block_size) {
+		PyErr_SetString(PyExc_ValueError,
+				"tag size must be between 4 and the "
+				"block size");
+		return NULL;
+	}
+	if (!_init_mcrypt(self, INIT_DECRYPT, NULL, 0, NULL))
+		return NULL;
+	rc = mdecrypt_generic_verify_tag(self->thread, tag, tag_size);
+	if (rc != 0) {
+		PyErr_SetString(MCRYPTError, "tag mismatch");
+		return NULL;
+	}
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+static char MCRYPT_update__doc__[] =
+"update(data) -> None\n\
+\n\
+Adds data to the message authenticated with a MAC mode (cmac or\n\
+cbcmac). It may be called any number of times; the data is not\n\
+copied or changed.\n\
+";
+
+static PyObject *
+MCRYPT_update(MCRYPTObject *self, PyObject *args)
+{
+	char *data;
+	int data_size;
+	int rc;
+	if (!PyArg_ParseTuple(args, "s#:update", &data, &data_size))
+		return NULL;
+	if (self->init == INIT_NONE) {
+		PyErr_SetString(MCRYPTError, "init method not run");
+		return NULL;
+	}
+	rc = mcrypt_generic_mac_update(self->thread, data, data_size);
+	if (catch_mcrypt_error(rc))
+		return NULL;
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+static char MCRYPT_final__doc__[] =
+"final([size]) -> tag\n\
+\n\
+Ends the message authenticated with a MAC mode (cmac or cbcmac) and\n\
+returns its tag. size may be between 4 and the block size, which is\n\
+the default. The next update() starts a new message with the same\n\
+key. To check a received tag, end the message with verify_tag()\n\
+instead.\n\
+";
+
+static PyObject *
+MCRYPT_final(MCRYPTObject *self, PyObject *args)
+{
+	char tag[32];
+	int size = self->block_size;
+	int rc;
+	if (!PyArg_ParseTuple(args, "|i:final", &size))
+		return NULL;
+	if (size < 4 || size > self->block_size || size > sizeof(tag)) {
+		PyErr_SetString(PyExc_ValueError,
+				"tag size must be between 4 and the "
+				"block size");
+		return NULL;
+	}
+	if (self->init == INIT_NONE) {
+		PyErr_SetString(MCRYPTError, "init method not run");
+		return NULL;
+	}
+	rc = mcrypt_generic_mac_final(self->thread, tag, size);
+	if (catch_mcrypt_error(rc))
+		return NULL;
+	return PyString_FromStringAndSize(tag, size);
+}
+
+static char MCRYPT_prefetch__doc__[] =
+"prefetch(size) -> ready\n\
+\n\
+Computes at least size bytes (at most 512) of keystream ahead of time\n\
+with the ofb, nofb or ctr modes, so that encrypting or decrypting the\n\
+next size bytes is only an XOR. From then on, a short encrypt() or\n\
+decrypt() that finds the keystream used up computes a whole new batch\n\
+of it; prefetch(0) stops this. Returns the number of bytes ready.\n\
+";
+
+static PyObject *
+MCRYPT_prefetch(MCRYPTObject *self, PyObject *args)
+{
+	int size;
+	int rc;
+	if (!PyArg_ParseTuple(args, "i:prefetch", &size))
+		return NULL;
+	if (size < 0) {
+		PyErr_SetString(PyExc_ValueError, "size must not be negative");
+		return NULL;
+	}
+	if (self->init == INIT_NONE) {
+		PyErr_SetString(MCRYPTError, "init method not run");
+		return NULL;
+	}
+	rc = mcrypt_generic_prefetch(self->thread, size);
+	if (catch_mcrypt_error(rc))
+		return NULL;
+	return PyInt_FromLong(rc);
+}
+
+static PyObject *
+_sectors_mcrypt(MCRYPTObject *self, PyObject *args, PyObject *kwargs,
+		char *format, int type)
+{
+	char *data, *blockbuffer;
+	int data_size;
+	unsigned PY_LONG_LONG sector;
+	int sector_size;
+	int rc;
+	PyObject *ret;
+
+	static char *kwlist[] = {"data", "sector", "sector_size", 0};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kwargs, format, kwlist,
+					 &data, &data_size, &sector,
+					 &sector_size))
+		return NULL;
+
+	if (sector_size <= 0 || data_size%sector_size != 0) {
+		PyErr_SetString(PyExc_ValueError,
+				"data size must be a multiple of the "
+				"sector size");
+		return NULL;
+	}
+
+	if (!_init_mcrypt(self, type, NULL, 0, NULL))
+		return NULL;
+
+	blockbuffer = PyMem_Malloc(data_size > 0 ? data_size : 1);
+	if (blockbuffer == NULL) {
+		PyErr_NoMemory();
+		return NULL;
+	}
+	memcpy(blockbuffer, data, data_size);
+	if (type == INIT_ENCRYPT) {
+		PROBE3(encrypt__start, self->algorithm, self->mode, data_size);
+		rc = mcrypt_generic_sectors(self->thread, sector, blockbuffer,
+					    sector_size,
+					    data_size/sector_size);
+		PROBE4(encrypt__done, self->algorithm, self->mode, data_size,
+		       rc);
+	} else {
+		PROBE3(decrypt__start, self->algorithm, self->mode, data_size);
+		rc = mdecrypt_generic_sectors(self->thread, sector,
+					      blockbuffer, sector_size,
+					      data_size/sector_size);
+		PROBE4(decrypt__done, self->algorithm, self->mode, data_size,
+		       rc);
+	}
+	if (catch_mcrypt_error(rc))
+		ret = NULL;
+	else
+		ret = PyString_FromStringAndSize(blockbuffer, data_size);
+	PyMem_Free(blockbuffer);
+	return ret;
+}
+
+static char MCRYPT_encrypt_sectors__doc__[] =
+"encrypt_sectors(data, sector, sector_size) -> encrypted_data\n\
+\n\
+Encrypts consecutive sectors of sector_size bytes with a sector mode\n\
+(eg. xts), the first of which has the number sector. Each sector is\n\
+encrypted on its own, so any of them may later be decrypted alone.\n\
+The data size must be a multiple of sector_size, which must be at\n\
+least the block size. The iv given to init() is not used.\n\
+";
+
+static PyObject *
+MCRYPT_encrypt_sectors(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
+{
+	return _sectors_mcrypt(self, args, kwargs, "s#Ki:encrypt_sectors",
+			       INIT_ENCRYPT);
+}
+
+static char MCRYPT_decrypt_sectors__doc__[] =
+"decrypt_sectors(data, sector, sector_size) -> decrypted_data\n\
+\n\
+Decrypts consecutive sectors encrypted with encrypt_sectors(). Any\n\
+run of sectors may be decrypted, given the number of its first one.\n\
+";
+
+static PyObject *
+MCRYPT_decrypt_sectors(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
+{
+	return _sectors_mcrypt(self, args, kwargs, "s#Ki:decrypt_sectors",
+			       INIT_DECRYPT);
+}
+
 static char MCRYPT_encrypt_file__doc__[] =
 "encrypt_file(filein, fileout\n\
 	      [, fixlength=1, bufferblocks=1024]) -> encrypted_data\n\
@@ -663,13 +1151,14 @@ enable it in decryption as well (to understand the trick, you may want\n\
 to enable it for encrypt, and not for decrypt). The bufferblocks\n\
 parameter allows you to set the buffer size that will be used to\n\
 transfer data between the files (buffer_size = bufferblocks*block_size).\n\
+Sector modes (eg. xts) are refused.\n\
 ";
 
 static PyObject *
 MCRYPT_encrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 {
-	void *blockbuffer, *data;
-	int blockbuffer_size, datablock_size, data_size;
+	char *blockbuffer, *data;
+	int blockbuffer_size, datablock_size, data_size, full_size;
 	int numblocks;
 	int fixlength = 1;
 	int bufferblocks = 1024;
@@ -677,6 +1166,7 @@ MCRYPT_encrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 	PyObject *fileout;
 	PyObject *readmeth;
 	PyObject *writemeth;
+	Py_ssize_t total = 0;
 	int error = 0;
 
 	static char *kwlist[] = {"filein", "fileout", "fixlength",
@@ -687,6 +1177,8 @@ MCRYPT_encrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 					 &fixlength, &bufferblocks))
 		return NULL;
 
+	if (!check_not_sector_mode(self, "encrypt_file"))
+		return NULL;
 	if (!_init_mcrypt(self, INIT_ENCRYPT, NULL, 0, NULL))
 		return NULL;
 
@@ -703,11 +1195,13 @@ MCRYPT_encrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		PyErr_NoMemory();
 		return NULL;
 	}
+	PROBE3(encrypt__file__start, self->algorithm, self->mode,
+	       blockbuffer_size);
 
 	while (1) {
 		PyObject *result;
 		int left_size = 0;
-		int rc;
+		int rc = 0;
 
 		result = PyEval_CallFunction(readmeth, "(i)", blockbuffer_size);
 		if (result == NULL) {
@@ -740,22 +1234,33 @@ MCRYPT_encrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		
 		/* If data_size is 0, it means we're adding an
 		 * empty block just to save the left_size byte. */
+		full_size = data_size-left_size;
 		if (left_size || data_size == 0) {
 			numblocks++;
 			datablock_size = numblocks*self->block_size;
-			memset(blockbuffer, 0, datablock_size);
+			memset(blockbuffer+full_size, 0,
+			       datablock_size-full_size);
 			if (fixlength)
-				((char *)blockbuffer)[datablock_size-1]
-					= left_size;
+				blockbuffer[datablock_size-1] = left_size;
+			memcpy(blockbuffer+full_size, data+full_size,
+			       left_size);
 		} else {
 			datablock_size = numblocks*self->block_size;
 		}
 		
-		memcpy(blockbuffer, data, data_size);
+		PROBE3(encrypt__start, self->algorithm, self->mode,
+		       datablock_size);
+		if (full_size > 0)
+			rc = mcrypt_generic_out(self->thread, data,
+						blockbuffer, full_size);
 		Py_DECREF(result);
 
-		rc = mcrypt_generic(self->thread, blockbuffer,
-				    datablock_size);
+		if (rc == 0 && datablock_size > full_size)
+			rc = mcrypt_generic(self->thread,
+					    blockbuffer+full_size,
+					    datablock_size-full_size);
+		PROBE4(encrypt__done, self->algorithm, self->mode,
+		       datablock_size, rc);
 		if (catch_mcrypt_error(rc)) {
 			error = 1;
 			break;
@@ -769,6 +1274,7 @@ MCRYPT_encrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 			error = 1;
 			break;
 		}
+		total += datablock_size;
 
 		/* The data_size variable will only be 0 here if we
 		 * have just inserted a blank block to save the
@@ -776,6 +1282,8 @@ MCRYPT_encrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		if (left_size != 0 || data_size == 0)
 			break;
 	}
+	PROBE4(encrypt__file__done, self->algorithm, self->mode, total,
+	       error);
 	
 	Py_DECREF(readmeth);
 	Py_DECREF(writemeth);
@@ -801,6 +1309,7 @@ enable it in encryption as well (to understand the trick, you may want\n\
 to enable it for encrypt, and not for decrypt). The bufferblocks\n\
 parameter allows you to set the buffer size that will be used to\n\
 transfer data between the files (buffer_size = bufferblocks*block_size).\n\
+Sector modes (eg. xts) are refused.\n\
 ";
 
 static PyObject *
@@ -817,6 +1326,7 @@ MCRYPT_decrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 	PyObject *readmeth;
 	PyObject *writemeth;
 	PyObject *nextresult = NULL;
+	Py_ssize_t total = 0;
 
 	int error = 0;
 
@@ -828,6 +1338,8 @@ MCRYPT_decrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 					 &fixlength, &bufferblocks))
 		return NULL;
 
+	if (!check_not_sector_mode(self, "decrypt_file"))
+		return NULL;
 	if (!_init_mcrypt(self, INIT_DECRYPT, NULL, 0, NULL))
 		return NULL;
 
@@ -844,6 +1356,8 @@ MCRYPT_decrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		PyErr_NoMemory();
 		return NULL;
 	}
+	PROBE3(decrypt__file__start, self->algorithm, self->mode,
+	       blockbuffer_size);
 	
 	/* We have to keep the next result to be able to
 	 * know when we are processing the last exact blockbuffer,
@@ -887,11 +1401,14 @@ MCRYPT_decrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 		numblocks = data_size/self->block_size;
 		datablock_size = numblocks*self->block_size;
 		
-		memcpy(blockbuffer, data, datablock_size);
+		PROBE3(decrypt__start, self->algorithm, self->mode,
+		       datablock_size);
+		rc = mdecrypt_generic_out(self->thread, data, blockbuffer,
+					  datablock_size);
+		PROBE4(decrypt__done, self->algorithm, self->mode,
+		       datablock_size, rc);
 		Py_DECREF(result);
 
-		rc = mdecrypt_generic(self->thread, blockbuffer,
-				      datablock_size);
 		if (catch_mcrypt_error(rc)) {
 			error = 1;
 			break;
@@ -916,9 +1433,12 @@ MCRYPT_decrypt_file(MCRYPTObject *self, PyObject *args, PyObject *kwargs)
 			error = 1;
 			break;
 		}
+		total += datablock_size-self->block_size+left_size;
 		if (left_size != self->block_size)
 			break;
 	}
+	PROBE4(decrypt__file__done, self->algorithm, self->mode, total,
+	       error);
 	Py_XDECREF(nextresult);
 	Py_DECREF(readmeth);
 	Py_DECREF(writemeth);
@@ -1087,6 +1607,26 @@ static PyMethodDef MCRYPT_methods[] = {
 		METH_VARARGS|METH_KEYWORDS,	MCRYPT_encrypt__doc__},
 	{"decrypt",		(PyCFunction)MCRYPT_decrypt,
 		METH_VARARGS|METH_KEYWORDS,	MCRYPT_decrypt__doc__},
+	{"encrypt_iov",		(PyCFunction)MCRYPT_encrypt_iov,
+		METH_VARARGS,			MCRYPT_encrypt_iov__doc__},
+	{"decrypt_iov",		(PyCFunction)MCRYPT_decrypt_iov,
+		METH_VARARGS,			MCRYPT_decrypt_iov__doc__},
+	{"add_aad",		(PyCFunction)MCRYPT_add_aad,
+		METH_VARARGS,			MCRYPT_add_aad__doc__},
+	{"get_tag",		(PyCFunction)MCRYPT_get_tag,
+		METH_VARARGS,			MCRYPT_get_tag__doc__},
+	{"verify_tag",		(PyCFunction)MCRYPT_verify_tag,
+		METH_VARARGS,			MCRYPT_verify_tag__doc__},
+	{"update",		(PyCFunction)MCRYPT_update,
+		METH_VARARGS,			MCRYPT_update__doc__},
+	{"final",		(PyCFunction)MCRYPT_final,
+		METH_VARARGS,			MCRYPT_final__doc__},
+	{"prefetch",		(PyCFunction)MCRYPT_prefetch,
+		METH_VARARGS,			MCRYPT_prefetch__doc__},
+	{"encrypt_sectors",	(PyCFunction)MCRYPT_encrypt_sectors,
+		METH_VARARGS|METH_KEYWORDS,	MCRYPT_encrypt_sectors__doc__},
+	{"decrypt_sectors",	(PyCFunction)MCRYPT_decrypt_sectors,
+		METH_VARARGS|METH_KEYWORDS,	MCRYPT_decrypt_sectors__doc__},
 	{"encrypt_file",	(PyCFunction)MCRYPT_encrypt_file,
 		METH_VARARGS|METH_KEYWORDS,	MCRYPT_encrypt_file__doc__},
 	{"decrypt_file",	(PyCFunction)MCRYPT_decrypt_file,
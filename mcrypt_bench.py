@@ -0,0 +1,199 @@
+#!/usr/bin/python
+"""Microbenchmarks of the cost of the mcrypt binding itself.
+
+Run it as "python -m mcrypt_bench" from the source directory (after
+"setup.py build", like test.py) or with the module installed. It
+prints one JSON document with the time per call of the MCRYPT
+methods, in nanoseconds.
+
+Every time is the best of a few runs, and is split in three parts:
+
+  interpreter_ns  the loop and a call of an empty Python function,
+                  which every measurement pays for
+  binding_ns      looking up and calling the method, parsing its
+                  arguments, and building the result
+  cipher_ns       the work of libmcrypt on the data
+
+The binding part of encrypt() and decrypt() is the time they take on
+an empty string, less the interpreter part; the cipher part is what
+the data adds on top of that. For the file functions, the cipher part
+is the time of encrypt()/decrypt() on data of the same size, and the
+binding part also covers the reads and writes of the file objects.
+Calls that do all of their work in libmcrypt (construction, init,
+reinit) only have a binding part.
+"""
+
+import os
+import sys
+import json
+import tempfile
+import timeit
+from optparse import OptionParser
+from cStringIO import StringIO
+
+# Add build directory to search path, as test.py does
+if os.path.exists("build"):
+	from distutils.util import get_platform
+	s = "build/lib.%s-%.3s" % (get_platform(), sys.version)
+	s = os.path.join(os.getcwd(), s)
+	sys.path.insert(0,s)
+
+import mcrypt
+from mcrypt import MCRYPT
+
+SMALL = 16
+LARGE = 64*1024
+FILE_SIZE = 1024*1024
+
+class Bench:
+	"Times callables and keeps the results."
+
+	def __init__(self, repeat, min_time):
+		self.repeat = repeat
+		self.min_time = min_time
+		self.results = []
+		self.interpreter = self.time(lambda: None)
+
+	def time(self, func):
+		"Best time of one call of func, in seconds."
+		timer = timeit.Timer(func)
+		number = 1
+		# Grow the number of calls until a run takes long enough
+		while True:
+			t = timer.timeit(number)
+			if t >= self.min_time or number >= 1<<30:
+				break
+			if t > 0:
+				number = max(number*2,
+					     int(number*self.min_time/t*1.2))
+			else:
+				number *= 10
+		best = min([t] + timer.repeat(self.repeat-1, number))
+		return best/number
+
+	def add(self, name, total, size=None, cipher=0.0):
+		"Records total seconds per call, of which cipher in libmcrypt."
+		result = {
+			"name": name,
+			"ns": total*1e9,
+			"interpreter_ns": self.interpreter*1e9,
+			"binding_ns": max(total-self.interpreter-cipher, 0)*1e9,
+			"cipher_ns": cipher*1e9,
+		}
+		if size is not None:
+			result["bytes"] = size
+			if size > 0 and total > 0:
+				result["mb_per_s"] = size/total/(1024.0*1024.0)
+		self.results.append(result)
+		return total
+
+def run(algorithm, mode, repeat, min_time):
+	b = Bench(repeat, min_time)
+
+	m = MCRYPT(algorithm, mode)
+	key = "k"*m.get_key_size()
+	iv = None
+	if m.has_iv():
+		iv = "i"*m.get_iv_size()
+	block_size = m.get_block_size()
+
+	def sized(n):
+		# Whole blocks keep the block modes from padding
+		if m.is_block_mode():
+			n = (n+block_size-1)/block_size*block_size
+		return "x"*n
+
+	b.add("method_call", b.time(lambda: m.get_block_size()))
+	b.add("MCRYPT", b.time(lambda: MCRYPT(algorithm, mode)))
+	b.add("init", b.time(lambda: m.init(key, iv)))
+	m.init(key, iv)
+	# gcm refuses reinit(), which would use the same iv again
+	if mode != "gcm":
+		b.add("reinit", b.time(lambda: m.reinit()))
+
+	# encrypt() and decrypt() each need an object of their own, as
+	# one can't switch between them without reinit()
+	enc = MCRYPT(algorithm, mode)
+	enc.init(key, iv)
+	dec = MCRYPT(algorithm, mode)
+	dec.init(key, iv)
+	cipher_time = {}
+	for name, obj in (("encrypt", enc), ("decrypt", dec)):
+		func = getattr(obj, name)
+		empty = b.time(lambda: func(""))
+		b.add(name, empty, 0)
+		for size in (SMALL, LARGE, FILE_SIZE):
+			data = sized(size)
+			t = b.time(lambda: func(data))
+			cipher_time[name, len(data)] = max(t-empty, 0)
+			if size != FILE_SIZE:
+				b.add(name, t, len(data), cipher_time[name, len(data)])
+
+	# xts takes each call as a sector, so it has no file functions
+	if mode == "xts":
+		return b.results
+
+	# The file functions, on a file in memory and on disk. Rewinding
+	# the files is timed on its own and taken out.
+	data = sized(FILE_SIZE)
+	tmpdir = tempfile.mkdtemp()
+	try:
+		for name in ("encrypt_file", "decrypt_file"):
+			obj = MCRYPT(algorithm, mode)
+			obj.init(key, iv)
+			func = getattr(obj, name)
+			cipher = cipher_time[name[:7], len(data)]
+			path = os.path.join(tmpdir, "in")
+			f = open(path, "wb")
+			f.write(data)
+			f.close()
+			for where, filein, fileout in (
+			    ("memory", StringIO(data), StringIO()),
+			    ("disk", open(path, "rb"),
+			     open(os.path.join(tmpdir, "out"), "w+b"))):
+				def rewind():
+					filein.seek(0)
+					fileout.seek(0)
+					fileout.truncate()
+				def call():
+					rewind()
+					func(filein, fileout, fixlength=0)
+				t = b.time(call)-b.time(rewind)+b.interpreter
+				b.add("%s_%s" % (name, where), t, len(data),
+				      cipher)
+				filein.close()
+				fileout.close()
+	finally:
+		for name in os.listdir(tmpdir):
+			os.unlink(os.path.join(tmpdir, name))
+		os.rmdir(tmpdir)
+
+	return b.results
+
+def main(args=None):
+	parser = OptionParser(usage="python -m mcrypt_bench [options]")
+	parser.add_option("-a", "--algorithm", default="rijndael-128",
+			  help="algorithm to use [%default]")
+	parser.add_option("-m", "--mode", default="cbc",
+			  help="mode to use [%default]")
+	parser.add_option("-r", "--repeat", type="int", default=5,
+			  help="runs of each measurement, of which the "
+			       "best counts [%default]")
+	parser.add_option("-t", "--min-time", type="float", default=0.1,
+			  help="least seconds per run [%default]")
+	options, args = parser.parse_args(args)
+
+	results = run(options.algorithm, options.mode,
+		      max(options.repeat, 1), options.min_time)
+	json.dump({
+		"python": sys.version.split()[0],
+		"mcrypt": mcrypt.__version__,
+		"algorithm": options.algorithm,
+		"mode": options.mode,
+		"results": results,
+	}, sys.stdout, indent=1, separators=(",", ": "),
+	   sort_keys=True)
+	sys.stdout.write("\n")
+
+if __name__ == "__main__":
+	main()
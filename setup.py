@@ -24,11 +24,19 @@ libmcrypt_dist_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), 'li
 libmcrypt_include = os.path.join(libmcrypt_dist_dir, 'include')
 libmcrypt_lib_dir = os.path.join(libmcrypt_dist_dir, 'lib')
 
+define_macros = [("VERSION", '"%s"'%VERSION)]
+
+# Static tracepoints, when systemtap's <sys/sdt.h> is around
+for include_dir in ['/usr/include', '/usr/local/include']:
+    if os.path.exists(os.path.join(include_dir, 'sys', 'sdt.h')):
+        define_macros.append(("HAVE_SYS_SDT_H", "1"))
+        break
+
 mcrypt_module = Extension("mcrypt",
                           ["mcrypt.c"],
                           extra_objects=[os.path.join(libmcrypt_lib_dir, 'libmcrypt.a')],
                           include_dirs=[libmcrypt_include],
-                          define_macros=[("VERSION", '"%s"'%VERSION)])
+                          define_macros=define_macros)
 
 class build_ext_with_libmcrypt(build_ext):
     def run(self):
@@ -150,6 +150,26 @@ class BaseTestCase(unittest.TestCase):
 						"is_block_algorithm_mode":0,
 						"has_iv":0,
 					},
+					"gcm":{
+						"is_block_mode":0,
+						"is_block_algorithm_mode":1,
+						"has_iv":1,
+					},
+					"xts":{
+						"is_block_mode":0,
+						"is_block_algorithm_mode":1,
+						"has_iv":1,
+					},
+					"cmac":{
+						"is_block_mode":0,
+						"is_block_algorithm_mode":1,
+						"has_iv":0,
+					},
+					"cbcmac":{
+						"is_block_mode":0,
+						"is_block_algorithm_mode":1,
+						"has_iv":0,
+					},
 			}
 
 class MCRYPTMisc(BaseTestCase):
@@ -315,6 +335,133 @@ class MCRYPTCrypto(BaseTestCase):
 				data = m.decrypt(data)
 				self.assertEqual(data, self.TEXT[:block_size*10])
 
+	def testEncryptIov(self):
+		"Test encryption of fragmented data with encrypt_iov"
+		for algorithm, mode in self.PAIRS:
+			m = MCRYPT(algorithm, mode)
+			text = self.TEXT
+			if m.is_block_mode():
+				block_size = m.get_block_size()
+				text = text[:len(text)-len(text)%block_size]
+			m.init("x"*m.get_key_size())
+			data = m.encrypt(text)
+			m.init("x"*m.get_key_size())
+			cuts = [0, 1, 2, 7, 7, 20, 33, len(text)]
+			buffers = [bytearray(text[a:b])
+				   for a, b in zip(cuts, cuts[1:])]
+			m.encrypt_iov(buffers)
+			self.assertEqual("".join(map(str, buffers)), data)
+			m.init("x"*m.get_key_size())
+			m.decrypt_iov(buffers)
+			self.assertEqual("".join(map(str, buffers)), text)
+
+	def testGcmTag(self):
+		"Test gcm tags, and that changed data is detected"
+		for algorithm in ("rijndael-128", "twofish", "serpent"):
+			m = MCRYPT(algorithm, "gcm")
+			key = "x"*m.get_key_size()
+			iv = "i"*m.get_iv_size()
+			m.init(key, iv)
+			m.add_aad("header")
+			data = m.encrypt(self.TEXT)
+			tag = m.get_tag()
+			self.assertEqual(len(tag), 16)
+			self.assertRaises(MCRYPTError, m.reinit)
+			m.init(key, iv)
+			m.add_aad("header")
+			self.assertEqual(m.decrypt(data), self.TEXT)
+			m.verify_tag(tag)
+			m.init(key, iv)
+			m.add_aad("header")
+			m.decrypt(data[:-1]+chr(ord(data[-1])^1))
+			self.assertRaises(MCRYPTError, m.verify_tag, tag)
+			m.init(key, iv)
+			m.add_aad("Header")
+			m.decrypt(data)
+			self.assertRaises(MCRYPTError, m.verify_tag, tag)
+
+	def testCmac(self):
+		"Test cmac against RFC 4493, and incremental updates"
+		m = MCRYPT("rijndael-128", "cmac")
+		m.init("2b7e151628aed2a6abf7158809cf4f3c".decode("hex"))
+		self.assertEqual(m.final().encode("hex"),
+				 "bb1d6929e95937287fa37d129b756746")
+		msg = ("6bc1bee22e409f96e93d7e117393172a"
+		       "ae2d8a571e03ac9c9eb76fac45af8e51"
+		       "30c81c46a35ce411").decode("hex")
+		m.update(msg[:16])
+		self.assertEqual(m.final().encode("hex"),
+				 "070a16b46b4d4144f79bdd9dd04a287c")
+		for i in range(len(msg)):
+			m.update(msg[i])
+		self.assertEqual(m.final(8).encode("hex"), "dfa66747de9ae630")
+		m.update(msg[:20])
+		m.update(msg[20:])
+		m.verify_tag("dfa66747de9ae63030ca32611497c827".decode("hex"))
+		m.update(msg[1:])
+		self.assertRaises(MCRYPTError, m.verify_tag,
+				  "dfa66747de9ae63030ca32611497c827".decode("hex"))
+		self.assertRaises(ValueError, m.final, 17)
+
+	def testCbcMac(self):
+		"Test that cbcmac is the last block of cbc"
+		for algorithm in ("rijndael-128", "twofish", "des"):
+			m = MCRYPT(algorithm, "cbcmac")
+			c = MCRYPT(algorithm, "cbc")
+			key = "k"*m.get_key_size()
+			m.init(key)
+			c.init(key, "\0"*c.get_iv_size())
+			text = self.TEXT[:c.get_block_size()*5]
+			m.update(text[:7])
+			m.update(text[7:])
+			self.assertEqual(m.final(),
+					 c.encrypt(text)[-c.get_block_size():])
+
+	def testPrefetch(self):
+		"Test that prefetched keystream gives the same result"
+		for mode in ("ofb", "nofb", "ctr"):
+			m = MCRYPT("twofish", mode)
+			p = MCRYPT("twofish", mode)
+			key = "k"*m.get_key_size()
+			iv = "i"*m.get_iv_size()
+			m.init(key, iv)
+			p.init(key, iv)
+			self.assertTrue(p.prefetch(100) >= 100)
+			for i in range(0, len(self.TEXT), 37):
+				frame = self.TEXT[i:i+37]
+				self.assertEqual(p.encrypt(frame),
+						 m.encrypt(frame))
+			p.prefetch(0)
+			self.assertEqual(p.encrypt(self.TEXT),
+					 m.encrypt(self.TEXT))
+		m = MCRYPT("twofish", "cbc")
+		m.init("k"*m.get_key_size(), "i"*m.get_iv_size())
+		self.assertRaises(MCRYPTError, m.prefetch, 100)
+
+	def testXtsSectors(self):
+		"Test that xts sectors can be decrypted on their own"
+		for algorithm in ("rijndael-128", "twofish", "serpent"):
+			m = MCRYPT(algorithm, "xts")
+			m.init("k"*m.get_key_size())
+			text = self.TEXT[:300]
+			data = m.encrypt_sectors(text, 5, 100)
+			self.assertNotEqual(data, text)
+			self.assertEqual(m.encrypt_sectors(text[100:200], 6, 100),
+					 data[100:200])
+			m.reinit()
+			self.assertEqual(m.decrypt_sectors(data[200:], 7, 100),
+					 text[200:])
+			self.assertEqual(m.decrypt_sectors(data, 5, 100), text)
+			self.assertRaises(ValueError, m.decrypt_sectors,
+					  data[:150], 5, 100)
+			self.assertRaises(MCRYPTError, m.encrypt_file,
+					  StringIO(text), StringIO())
+			self.assertRaises(MCRYPTError, m.decrypt_iov,
+					  [bytearray(data)])
+			# like encrypt(), decrypt() has no sector for ""
+			m.reinit()
+			self.assertEqual(m.decrypt(""), "")
+
 	def testFileFixlength(self):
 		"Check if fixlength byte is what we expected with file encrypt"
 		for algorithm, mode in self.PAIRS: